@@ -0,0 +1,583 @@
+#include "BlurBench.h"
+
+#include "nodes/BlurModes.h"
+#include "nodes/FilterChain.h"
+#include "nodes/base/PixelLayout.h"
+#include "kernels/CpuDispatch.h"
+#include "server/FrameRingServer.h"
+#include "shm/FrameRingClient.h"
+#include "utils/BufferPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <thread>
+
+namespace media_proc {
+
+    std::string BenchCase::formatName() const {
+        const char* name = av_get_pix_fmt_name(format);
+        return name ? name : "unknown";
+    }
+
+    std::string BenchCase::key() const {
+        return mode + "/" + resolution() + "/" + formatName() + "/" + std::to_string(threads);
+    }
+
+    double median(std::vector<double> samples) {
+        if (samples.empty()) return 0.0;
+        std::sort(samples.begin(), samples.end());
+        size_t middle = samples.size() / 2;
+        return samples.size() % 2 ? samples[middle] : (samples[middle - 1] + samples[middle]) / 2.0;
+    }
+
+    double percentile(std::vector<double> samples, double fraction) {
+        if (samples.empty()) return 0.0;
+        std::sort(samples.begin(), samples.end());
+        size_t rank = (size_t)std::ceil(fraction * samples.size());
+        return samples[std::min(std::max<size_t>(rank, 1), samples.size()) - 1];
+    }
+
+    namespace {
+
+        struct FrameDeleter {
+            void operator()(AVFrame* frame) const { av_frame_free(&frame); }
+        };
+        using FramePtr = std::unique_ptr<AVFrame, FrameDeleter>;
+
+        // Noise in the value range of every plane: half and float samples stay finite in [0, 1),
+        // 16-bit ones within their depth, so no kernel runs into NaNs or denormals
+        FramePtr createFrame(const BenchCase &benchCase, PixelLayout &layout) {
+            FramePtr frame(av_frame_alloc());
+            if (!frame) throw std::runtime_error("Failed to allocate frame");
+            frame->format = benchCase.format;
+            frame->width = benchCase.width;
+            frame->height = benchCase.height;
+            if (av_frame_get_buffer(frame.get(), 64) < 0) throw std::runtime_error("Failed to allocate a " + benchCase.formatName() + " frame");
+
+            const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(benchCase.format);
+            int depth = desc ? desc->comp[0].depth : 8;
+
+            std::mt19937 random(benchCase.width * 31 + benchCase.height);
+            for (int index = 0; index < layout.planeCount(); ++index) {
+                PlaneView plane = layout.plane(frame.get(), index);
+                if (!plane.data) continue;
+
+                for (int y = 0; y < plane.height; ++y) {
+                    uint8_t* row = plane.data + (size_t)y * plane.stride;
+                    for (int x = 0; x < plane.width; ++x) {
+                        uint32_t value = random();
+                        switch (plane.type) {
+                            case kernels::SampleType::U8:
+                                row[x] = (uint8_t)value;
+                                break;
+                            case kernels::SampleType::U16:
+                                reinterpret_cast<uint16_t*>(row)[x] = (uint16_t)((value & ((1u << depth) - 1)) << plane.shift);
+                                break;
+                            case kernels::SampleType::Half:
+                                reinterpret_cast<uint16_t*>(row)[x] = (uint16_t)(((value % 15) << 10) | ((value >> 16) & 0x3ff));
+                                break;
+                            case kernels::SampleType::Float:
+                                reinterpret_cast<float*>(row)[x] = (value >> 8) * (1.0f / 16777216.0f);
+                                break;
+                        }
+                    }
+                }
+            }
+            return frame;
+        }
+
+        size_t frameBytes(const AVFrame* frame, const PixelLayout &layout) {
+            size_t bytes = 0;
+            for (int index = 0; index < layout.planeCount(); ++index) {
+                PlaneView plane = layout.plane(frame, index);
+                if (plane.data) bytes += (size_t)plane.width * kernels::sampleSize(plane.type) * plane.height;
+            }
+            return bytes;
+        }
+
+        std::string formatBytes(size_t bytes) {
+            std::ostringstream out;
+            out << std::fixed << std::setprecision(1);
+            if (bytes >= (1u << 20)) out << bytes / 1048576.0 << " MiB";
+            else if (bytes >= (1u << 10)) out << bytes / 1024.0 << " KiB";
+            else out << bytes << " B";
+            return out.str();
+        }
+
+        std::string jsonString(const std::string &value) {
+            std::string out = "\"";
+            for (char c : value) {
+                if (c == '"' || c == '\\') out += '\\';
+                if ((unsigned char)c < 0x20) out += ' ';
+                else out += c;
+            }
+            return out + "\"";
+        }
+
+        // Just enough JSON for reading back writeJson(): objects, arrays, strings, numbers and literals
+        struct JsonValue {
+            enum class Type { Null, Bool, Number, String, Array, Object } type = Type::Null;
+            bool boolean = false;
+            double number = 0.0;
+            std::string string;
+            std::vector<JsonValue> items;
+            std::vector<std::pair<std::string, JsonValue>> members;
+
+            const JsonValue* find(const std::string &key) const {
+                for (const auto &member : members) if (member.first == key) return &member.second;
+                return nullptr;
+            }
+            double numberOr(const std::string &key, double fallback) const {
+                const JsonValue* value = find(key);
+                return value && value->type == Type::Number ? value->number : fallback;
+            }
+            std::string stringOr(const std::string &key, const std::string &fallback) const {
+                const JsonValue* value = find(key);
+                return value && value->type == Type::String ? value->string : fallback;
+            }
+        };
+
+        class JsonParser {
+        public:
+            explicit JsonParser(const std::string &text) : m_Text(text) { }
+
+            JsonValue parse() {
+                JsonValue value = parseValue();
+                skipSpace();
+                if (m_Pos != m_Text.size()) fail("trailing characters");
+                return value;
+            }
+
+        private:
+            [[noreturn]] void fail(const std::string &what) const {
+                throw std::runtime_error("Invalid benchmark JSON at offset " + std::to_string(m_Pos) + ": " + what);
+            }
+
+            void skipSpace() {
+                while (m_Pos < m_Text.size() && std::isspace((unsigned char)m_Text[m_Pos])) ++m_Pos;
+            }
+
+            bool consume(char c) {
+                skipSpace();
+                if (m_Pos < m_Text.size() && m_Text[m_Pos] == c) { ++m_Pos; return true; }
+                return false;
+            }
+
+            void expect(char c) {
+                if (!consume(c)) fail(std::string("expected '") + c + "'");
+            }
+
+            JsonValue parseValue() {
+                skipSpace();
+                if (m_Pos >= m_Text.size()) fail("unexpected end");
+
+                JsonValue value;
+                char c = m_Text[m_Pos];
+                if (c == '{') {
+                    value.type = JsonValue::Type::Object;
+                    ++m_Pos;
+                    if (consume('}')) return value;
+                    do {
+                        skipSpace();
+                        std::string key = parseString();
+                        expect(':');
+                        value.members.emplace_back(key, parseValue());
+                    } while (consume(','));
+                    expect('}');
+                }
+                else if (c == '[') {
+                    value.type = JsonValue::Type::Array;
+                    ++m_Pos;
+                    if (consume(']')) return value;
+                    do value.items.push_back(parseValue()); while (consume(','));
+                    expect(']');
+                }
+                else if (c == '"') {
+                    value.type = JsonValue::Type::String;
+                    value.string = parseString();
+                }
+                else if (m_Text.compare(m_Pos, 4, "true") == 0 || m_Text.compare(m_Pos, 5, "false") == 0) {
+                    value.type = JsonValue::Type::Bool;
+                    value.boolean = c == 't';
+                    m_Pos += value.boolean ? 4 : 5;
+                }
+                else if (m_Text.compare(m_Pos, 4, "null") == 0) m_Pos += 4;
+                else {
+                    const char* begin = m_Text.c_str() + m_Pos;
+                    char* end = nullptr;
+                    value.type = JsonValue::Type::Number;
+                    value.number = std::strtod(begin, &end);
+                    if (end == begin) fail("unexpected character");
+                    m_Pos += end - begin;
+                }
+                return value;
+            }
+
+            std::string parseString() {
+                if (m_Pos >= m_Text.size() || m_Text[m_Pos] != '"') fail("expected a string");
+                std::string out;
+                for (++m_Pos; m_Pos < m_Text.size() && m_Text[m_Pos] != '"'; ++m_Pos) {
+                    if (m_Text[m_Pos] == '\\' && ++m_Pos < m_Text.size()) {
+                        char escaped = m_Text[m_Pos];
+                        if (escaped == 'n') out += '\n';
+                        else if (escaped == 't') out += '\t';
+                        else if (escaped == 'u') { out += '?'; m_Pos += 4; } // Not written by writeJson()
+                        else out += escaped;
+                    }
+                    else out += m_Text[m_Pos];
+                }
+                if (m_Pos >= m_Text.size()) fail("unterminated string");
+                ++m_Pos;
+                return out;
+            }
+
+        private:
+            const std::string &m_Text;
+            size_t m_Pos = 0;
+        };
+    }
+
+    BlurBench::BlurBench(const BenchOptions &options) : m_Options(options) { }
+
+    std::vector<BenchCase> BlurBench::cases() const {
+        unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+        std::vector<unsigned int> threadCounts;
+        for (unsigned int threads : m_Options.threads) {
+            if (threads == 0) threads = cores;
+            if (std::find(threadCounts.begin(), threadCounts.end(), threads) == threadCounts.end()) threadCounts.push_back(threads);
+        }
+        if (threadCounts.empty()) threadCounts.push_back(cores);
+
+        std::vector<BenchCase> cases;
+        for (const std::string &mode : m_Options.modes) {
+            bool multiThreaded = singleThreadedMode(mode) != mode;
+            for (const auto &[width, height] : m_Options.resolutions) {
+                for (AVPixelFormat format : m_Options.formats) {
+                    for (unsigned int threads : multiThreaded ? threadCounts : std::vector<unsigned int>{ 1 }) {
+                        BenchCase benchCase;
+                        benchCase.mode = mode;
+                        benchCase.width = width;
+                        benchCase.height = height;
+                        benchCase.format = format;
+                        benchCase.threads = threads;
+                        cases.push_back(benchCase);
+                    }
+                }
+            }
+        }
+        return cases;
+    }
+
+    BenchResult BlurBench::run(const BenchCase &benchCase) const {
+        if (m_Options.shmSlots) return runShm(benchCase);
+
+        BenchResult result;
+        result.benchCase = benchCase;
+
+        try {
+            BlurOptions blur = m_Options.blur;
+            blur.threads = benchCase.threads;
+            if (blur.separable() && !supportsGaussian(benchCase.mode)) throw std::runtime_error("no Gaussian blur in this mode");
+            if (!blur.filters.empty() && !supportsFilterChain(benchCase.mode)) throw std::runtime_error("no filter chains in this mode");
+            std::unique_ptr<PipelineNode> processor = createBlurProcessor(benchCase.mode, blur);
+            if (!processor) throw std::runtime_error("unknown mode " + benchCase.mode);
+
+            PixelLayout layout;
+            layout.init(benchCase.format);
+            FramePtr source = createFrame(benchCase, layout);
+
+            std::vector<int> linesizes(source->linesize, source->linesize + layout.planeCount());
+            auto context = std::make_shared<const PipelineContext>(linesizes, benchCase.width, benchCase.height, benchCase.format,
+                                                                   AVRational{ 1, 25 }, AVRational{ 25, 1 });
+
+            // Every run blurs the same planes through a new reference, which the packet gives back to
+            // the frame pool. The pool is reset before the clock starts, so only scratch is counted.
+            auto blurOnce = [&]() {
+                AVFrame* frame = FramePool::global().acquireFrame();
+                if (av_frame_ref(frame, source.get()) < 0) {
+                    FramePool::global().releaseFrame(frame);
+                    throw std::runtime_error("Failed to reference frame");
+                }
+                auto packet = std::make_unique<PipelinePacket>(frame, context);
+
+                BufferPool &pool = BufferPool::global();
+                size_t baseline = pool.inUse();
+                pool.resetPeak();
+
+                auto start = std::chrono::steady_clock::now();
+                packet = processor->processChain(std::move(packet));
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+                result.peakScratchBytes = std::max(result.peakScratchBytes, pool.peakInUse() - std::min(baseline, pool.peakInUse()));
+                return ms;
+            };
+
+            for (int i = 0; i < m_Options.warmup; ++i) blurOnce();
+            result.peakScratchBytes = 0; // First runs fill the pools; steady state is what matters
+
+            for (int i = 0; i < m_Options.runs; ++i) result.samplesMs.push_back(blurOnce());
+
+            result.medianMs = median(result.samplesMs);
+            result.p95Ms = percentile(result.samplesMs, 0.95);
+            if (result.medianMs > 0.0) {
+                double seconds = result.medianMs / 1000.0;
+                result.mpixPerSecond = (double)benchCase.width * benchCase.height / seconds / 1e6;
+                result.gbPerSecond = 2.0 * frameBytes(source.get(), layout) / seconds / 1e9;
+            }
+        }
+        catch (const std::exception &e) {
+            result.error = e.what();
+        }
+        return result;
+    }
+
+    BenchResult BlurBench::runShm(const BenchCase &benchCase) const {
+        BenchResult result;
+        result.benchCase = benchCase;
+
+        try {
+            BlurOptions blur = m_Options.blur;
+            blur.threads = benchCase.threads;
+            if (blur.separable() && !supportsGaussian(benchCase.mode)) throw std::runtime_error("no Gaussian blur in this mode");
+            if (!blur.filters.empty() && !supportsFilterChain(benchCase.mode)) throw std::runtime_error("no filter chains in this mode");
+
+            PixelLayout layout;
+            layout.init(benchCase.format);
+            FramePtr source = createFrame(benchCase, layout);
+            size_t slotBytes = FrameRing::frameBytes(benchCase.width, benchCase.height, benchCase.format);
+            if (slotBytes == 0) throw std::runtime_error("no shared-memory layout for " + benchCase.formatName());
+
+            FrameRingServerOptions serverOptions;
+            serverOptions.socketPath = "/tmp/img_blur_bench-" + std::to_string(std::random_device{}()) + ".sock";
+            serverOptions.mode = benchCase.mode;
+            FrameRingServer server(serverOptions, [blur](const std::string &mode) { return createBlurProcessor(mode, blur); });
+            server.listen();
+
+            std::atomic<bool> stop{false};
+            std::thread serving([&]() {
+                try { server.run(stop); }
+                catch (const std::exception&) { }
+            });
+
+            try {
+                FrameRingClient client;
+                client.connect(serverOptions.socketPath, m_Options.shmSlots, slotBytes);
+
+                // Every slot starts out with the source frame and is blurred over and over, like the
+                // direct runs do with their frame
+                std::vector<uint32_t> slots(m_Options.shmSlots);
+                for (uint32_t &slot : slots) {
+                    client.acquire(slot);
+                    client.ring().prepare(slot, benchCase.width, benchCase.height, benchCase.format);
+                    for (int i = 0; i < layout.planeCount(); ++i) {
+                        PlaneView plane = layout.plane(source.get(), i);
+                        av_image_copy_plane(client.ring().plane(slot, i), client.ring().linesize(slot, i), plane.data, plane.stride,
+                                            av_image_get_linesize(benchCase.format, benchCase.width, i), plane.height);
+                    }
+                }
+                for (uint32_t slot : slots) client.release(slot);
+
+                std::vector<std::chrono::steady_clock::time_point> submitted(m_Options.shmSlots);
+                auto pump = [&](int frames, bool timed) {
+                    int sent = 0, done = 0;
+                    while (done < frames) {
+                        uint32_t slot;
+                        if (sent < frames && client.acquire(slot)) {
+                            submitted[slot] = std::chrono::steady_clock::now();
+                            client.submit(slot);
+                            ++sent;
+                            continue;
+                        }
+                        slot = client.wait();
+                        if (client.ring().slot(slot).state.load() == (uint32_t)SlotState::Failed) throw std::runtime_error(client.ring().slot(slot).error);
+                        if (timed) result.samplesMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - submitted[slot]).count());
+                        client.release(slot);
+                        ++done;
+                    }
+                };
+
+                pump(m_Options.warmup, false);
+
+                BufferPool &pool = BufferPool::global();
+                size_t baseline = pool.inUse();
+                pool.resetPeak();
+                auto start = std::chrono::steady_clock::now();
+                pump(m_Options.runs, true);
+                double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                result.peakScratchBytes = pool.peakInUse() - std::min(baseline, pool.peakInUse());
+
+                result.medianMs = median(result.samplesMs);
+                result.p95Ms = percentile(result.samplesMs, 0.95);
+                if (seconds > 0.0) {
+                    result.mpixPerSecond = (double)benchCase.width * benchCase.height * m_Options.runs / seconds / 1e6;
+                    result.gbPerSecond = 2.0 * frameBytes(source.get(), layout) * m_Options.runs / seconds / 1e9;
+                }
+            }
+            catch (const std::exception &e) {
+                result.error = e.what();
+            }
+            stop.store(true);
+            serving.join();
+        }
+        catch (const std::exception &e) {
+            result.error = e.what();
+        }
+        return result;
+    }
+
+    std::vector<BenchResult> BlurBench::runAll(const std::function<void(const BenchResult&)> &progress) const {
+        return runAll(cases(), progress);
+    }
+
+    std::vector<BenchResult> BlurBench::runAll(const std::vector<BenchCase> &cases, const std::function<void(const BenchResult&)> &progress) const {
+        std::vector<BenchResult> results;
+        for (const BenchCase &benchCase : cases) {
+            results.push_back(run(benchCase));
+            if (progress) progress(results.back());
+        }
+        return results;
+    }
+
+    void BlurBench::printTable(std::ostream &out, const std::vector<BenchResult> &results) {
+        std::ios state(nullptr);
+        state.copyfmt(out);
+
+        out << std::left << std::setw(14) << "mode" << std::setw(12) << "resolution" << std::setw(12) << "format"
+            << std::right << std::setw(8) << "threads" << std::setw(12) << "median ms" << std::setw(10) << "p95 ms"
+            << std::setw(10) << "Mpix/s" << std::setw(9) << "GB/s" << std::setw(12) << "scratch" << "\n";
+
+        out << std::fixed;
+        for (const BenchResult &result : results) {
+            const BenchCase &c = result.benchCase;
+            out << std::left << std::setw(14) << c.mode << std::setw(12) << c.resolution() << std::setw(12) << c.formatName()
+                << std::right << std::setw(8) << c.threads;
+            if (!result.ok()) {
+                out << "  failed: " << result.error << "\n";
+                continue;
+            }
+            out << std::setprecision(3) << std::setw(12) << result.medianMs << std::setw(10) << result.p95Ms
+                << std::setprecision(1) << std::setw(10) << result.mpixPerSecond
+                << std::setprecision(2) << std::setw(9) << result.gbPerSecond
+                << std::setw(12) << formatBytes(result.peakScratchBytes) << "\n";
+        }
+        out.copyfmt(state);
+    }
+
+    void BlurBench::writeJson(std::ostream &out, const std::vector<BenchResult> &results) const {
+        std::ios state(nullptr);
+        state.copyfmt(out);
+        out << std::setprecision(6);
+
+        out << "{\n";
+        out << "  \"tool\": \"img_blur_bench\",\n";
+        out << "  \"isa\": " << jsonString(kernels::isaName(kernels::activeKernels().isa)) << ",\n";
+        out << "  \"precision\": " << jsonString(kernels::precisionName(m_Options.blur.precision)) << ",\n";
+        out << "  \"inplace\": " << (m_Options.blur.inPlace ? "true" : "false") << ",\n";
+        out << "  \"sigma\": " << m_Options.blur.sigma << ",\n";
+        out << "  \"radius\": " << m_Options.blur.radius << ",\n";
+        out << "  \"transport\": " << jsonString(m_Options.shmSlots ? "shm" : "direct") << ",\n";
+        out << "  \"shm_slots\": " << m_Options.shmSlots << ",\n";
+        out << "  \"filter\": " << jsonString(filterText()) << ",\n";
+        out << "  \"fuse\": " << (m_Options.blur.fuse ? "true" : "false") << ",\n";
+        out << "  \"warmup\": " << m_Options.warmup << ",\n";
+        out << "  \"runs\": " << m_Options.runs << ",\n";
+        out << "  \"results\": [";
+
+        for (size_t i = 0; i < results.size(); ++i) {
+            const BenchResult &result = results[i];
+            const BenchCase &c = result.benchCase;
+            out << (i ? ",\n" : "\n") << "    { ";
+            out << "\"mode\": " << jsonString(c.mode) << ", \"width\": " << c.width << ", \"height\": " << c.height
+                << ", \"format\": " << jsonString(c.formatName()) << ", \"threads\": " << c.threads;
+            if (!result.ok()) {
+                out << ", \"error\": " << jsonString(result.error) << " }";
+                continue;
+            }
+            out << ", \"median_ms\": " << result.medianMs << ", \"p95_ms\": " << result.p95Ms
+                << ", \"mpix_per_s\": " << result.mpixPerSecond << ", \"gb_per_s\": " << result.gbPerSecond
+                << ", \"peak_scratch_bytes\": " << result.peakScratchBytes << ", \"samples_ms\": [";
+            for (size_t s = 0; s < result.samplesMs.size(); ++s) out << (s ? ", " : "") << result.samplesMs[s];
+            out << "] }";
+        }
+        out << "\n  ]\n}\n";
+        out.copyfmt(state);
+    }
+
+    std::string BlurBench::filterText() const {
+        std::string text;
+        for (const FilterStage &filter : m_Options.blur.filters) text += (text.empty() ? "" : ",") + filter.name;
+        return text;
+    }
+
+    BenchReport BlurBench::report(const std::vector<BenchResult> &results) const {
+        BenchReport report;
+        report.isa = kernels::isaName(kernels::activeKernels().isa);
+        report.precision = kernels::precisionName(m_Options.blur.precision);
+        report.inPlace = m_Options.blur.inPlace;
+        report.sigma = m_Options.blur.sigma;
+        report.radius = m_Options.blur.radius;
+        report.transport = m_Options.shmSlots ? "shm" : "direct";
+        report.shmSlots = m_Options.shmSlots;
+        report.filter = filterText();
+        report.fuse = m_Options.blur.fuse;
+        report.warmup = m_Options.warmup;
+        report.runs = m_Options.runs;
+        report.results = results;
+        return report;
+    }
+
+    BenchReport BlurBench::readJson(std::istream &in) {
+        std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        JsonValue root = JsonParser(text).parse();
+        const JsonValue* results = root.find("results");
+        if (root.type != JsonValue::Type::Object || !results || results->type != JsonValue::Type::Array) {
+            throw std::runtime_error("Invalid benchmark JSON: no results array");
+        }
+
+        BenchReport report;
+        report.isa = root.stringOr("isa", "");
+        report.precision = root.stringOr("precision", "");
+        const JsonValue* inPlace = root.find("inplace");
+        report.inPlace = inPlace && inPlace->boolean;
+        report.sigma = root.numberOr("sigma", 0.0);
+        report.radius = (int)root.numberOr("radius", 0);
+        report.transport = root.stringOr("transport", "direct");
+        report.shmSlots = (unsigned int)root.numberOr("shm_slots", report.transport == "shm" ? 4 : 0);
+        report.filter = root.stringOr("filter", "");
+        const JsonValue* fuse = root.find("fuse");
+        report.fuse = !fuse || fuse->boolean;
+        report.warmup = (int)root.numberOr("warmup", 0);
+        report.runs = (int)root.numberOr("runs", 0);
+
+        for (const JsonValue &item : results->items) {
+            BenchResult result;
+            BenchCase &c = result.benchCase;
+            c.mode = item.stringOr("mode", "");
+            c.width = (int)item.numberOr("width", 0);
+            c.height = (int)item.numberOr("height", 0);
+            c.format = av_get_pix_fmt(item.stringOr("format", "").c_str());
+            c.threads = (unsigned int)item.numberOr("threads", 1);
+            if (c.mode.empty() || c.width <= 0 || c.height <= 0) throw std::runtime_error("Invalid benchmark JSON: result without mode or size");
+
+            result.error = item.stringOr("error", "");
+            result.medianMs = item.numberOr("median_ms", 0.0);
+            result.p95Ms = item.numberOr("p95_ms", 0.0);
+            result.mpixPerSecond = item.numberOr("mpix_per_s", 0.0);
+            result.gbPerSecond = item.numberOr("gb_per_s", 0.0);
+            result.peakScratchBytes = (size_t)item.numberOr("peak_scratch_bytes", 0.0);
+            if (const JsonValue* samples = item.find("samples_ms")) {
+                for (const JsonValue &sample : samples->items) result.samplesMs.push_back(sample.number);
+            }
+            report.results.push_back(result);
+        }
+        return report;
+    }
+}
@@ -0,0 +1,119 @@
+/*
+ * Blur Benchmark
+ * ==============
+ *
+ * Runs the processor node of every blur mode on synthetic frames over a
+ * matrix of resolutions, pixel formats and thread counts. Each case gets
+ * warm-up runs, then repeated timed runs whose median, p95, throughput and
+ * peak scratch memory are reported as a table and as JSON. With a shared-memory
+ * ring the frames take the --serve-shm path instead: a FrameRingServer in the same
+ * process, a memfd ring and its control socket, several frames in flight.
+ *
+ * Author: Finoshkin Aleksei
+ * License: MIT
+ */
+
+#ifndef IMG_DEINT_BLUR_BENCH_H
+#define IMG_DEINT_BLUR_BENCH_H
+
+
+#include <StdAfx.h>
+#include "nodes/BlurOptions.h"
+
+#include <functional>
+#include <ostream>
+
+namespace media_proc {
+
+    struct BenchCase {
+        std::string mode;
+        int width = 0, height = 0;
+        AVPixelFormat format = AV_PIX_FMT_NONE;
+        unsigned int threads = 1;  // Worker threads; 1 for the single-threaded modes
+
+        std::string resolution() const { return std::to_string(width) + "x" + std::to_string(height); }
+        std::string formatName() const;
+        std::string key() const;   // mode/resolution/format/threads, unique within a run
+    };
+
+    struct BenchResult {
+        BenchCase benchCase;
+        std::vector<double> samplesMs;  // Timed runs in run order
+        double medianMs = 0.0, p95Ms = 0.0;
+        double mpixPerSecond = 0.0;     // Frame pixels per second at the median time
+        double gbPerSecond = 0.0;       // Plane bytes read and written per second at the median time
+        size_t peakScratchBytes = 0;    // Highest BufferPool usage above the baseline during one run
+        std::string error;              // Set when the case could not run, e.g. no GPU
+
+        bool ok() const { return error.empty(); }
+    };
+
+    // A whole run as written by writeJson(): settings plus one result per case. Files written before
+    // a setting was recorded read back with its default.
+    struct BenchReport {
+        std::string isa, precision;
+        bool inPlace = false;
+        double sigma = 0.0;
+        int radius = 0;
+        std::string transport = "direct";  // direct or shm
+        unsigned int shmSlots = 0;         // Ring slots of the shm transport
+        std::string filter;                // -f chain, empty for the modes' own blur
+        bool fuse = true;
+        int warmup = 0, runs = 0;
+        std::vector<BenchResult> results;
+    };
+
+    struct BenchOptions {
+        std::vector<std::string> modes;
+        std::vector<std::pair<int, int>> resolutions;
+        std::vector<AVPixelFormat> formats;
+        std::vector<unsigned int> threads;  // Thread counts of the multi-threaded modes
+        int warmup = 3;
+        int runs = 15;
+        BlurOptions blur;
+        // Slots of a shared-memory ring the frames go through, 0 to call the processor directly.
+        // Samples are then round trips from submit to completion, and Mpix/s and GB/s the
+        // throughput over all timed frames, as the ring keeps several of them in flight.
+        unsigned int shmSlots = 0;
+    };
+
+    double median(std::vector<double> samples);
+
+    // Nearest-rank percentile, `fraction` in (0, 1]
+    double percentile(std::vector<double> samples, double fraction);
+
+    class BlurBench {
+    public:
+        explicit BlurBench(const BenchOptions &options);
+
+        // Cases in matrix order: mode, resolution, format, thread count
+        std::vector<BenchCase> cases() const;
+
+        BenchResult run(const BenchCase &benchCase) const;
+
+        // Runs every case; `progress` is called after each one
+        std::vector<BenchResult> runAll(const std::function<void(const BenchResult&)> &progress = {}) const;
+        std::vector<BenchResult> runAll(const std::vector<BenchCase> &cases, const std::function<void(const BenchResult&)> &progress = {}) const;
+
+        static void printTable(std::ostream &out, const std::vector<BenchResult> &results);
+        void writeJson(std::ostream &out, const std::vector<BenchResult> &results) const;
+
+        // Reads back what writeJson() wrote. Throws std::runtime_error on malformed input.
+        static BenchReport readJson(std::istream &in);
+
+        // The settings of this benchmark in the form readJson() returns them
+        BenchReport report(const std::vector<BenchResult> &results) const;
+
+    private:
+        BenchResult runShm(const BenchCase &benchCase) const;
+
+        // The -f chain as given, filters joined by commas
+        std::string filterText() const;
+
+    private:
+        BenchOptions m_Options;
+    };
+}
+
+
+#endif //!IMG_DEINT_BLUR_BENCH_H
@@ -0,0 +1,150 @@
+#include "RegressionGate.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <map>
+#include <random>
+#include <sstream>
+
+namespace media_proc {
+
+    const char* verdictName(Verdict verdict) {
+        switch (verdict) {
+            case Verdict::Unchanged:     return "ok";
+            case Verdict::Faster:        return "faster";
+            case Verdict::Slower:        return "SLOWER";
+            case Verdict::Failed:        return "FAILED";
+            case Verdict::TooFewSamples: return "too few samples";
+            case Verdict::NotRun:        return "not run";
+            case Verdict::New:           return "new";
+        }
+        return "unknown";
+    }
+
+    RegressionGate::RegressionGate(const GateOptions &options) : m_Options(options) { }
+
+    std::vector<Comparison> RegressionGate::compare(const BenchReport &baseline, const BenchReport &current) const {
+        std::map<std::string, const BenchResult*> currentByKey;
+        for (const BenchResult &result : current.results) currentByKey[result.benchCase.key()] = &result;
+
+        std::vector<Comparison> comparisons;
+        for (const BenchResult &base : baseline.results) {
+            auto it = currentByKey.find(base.benchCase.key());
+            if (it == currentByKey.end()) {
+                Comparison comparison;
+                comparison.benchCase = base.benchCase;
+                comparison.verdict = Verdict::NotRun;
+                comparison.baselineMs = base.medianMs;
+                comparisons.push_back(comparison);
+                continue;
+            }
+            comparisons.push_back(compareCase(base, *it->second));
+            currentByKey.erase(it);
+        }
+
+        for (const BenchResult &result : current.results) {
+            if (!currentByKey.count(result.benchCase.key())) continue;
+            Comparison comparison;
+            comparison.benchCase = result.benchCase;
+            comparison.verdict = Verdict::New;
+            comparison.currentMs = result.medianMs;
+            comparisons.push_back(comparison);
+        }
+        return comparisons;
+    }
+
+    Comparison RegressionGate::compareCase(const BenchResult &baseline, const BenchResult &current) const {
+        Comparison comparison;
+        comparison.benchCase = current.benchCase;
+        comparison.baselineMs = median(baseline.samplesMs);
+        comparison.currentMs = median(current.samplesMs);
+
+        if (!baseline.ok()) { comparison.verdict = Verdict::New; return comparison; }
+        if (!current.ok()) { comparison.verdict = Verdict::Failed; return comparison; }
+        if (baseline.samplesMs.size() < m_Options.minSamples || current.samplesMs.size() < m_Options.minSamples
+            || comparison.baselineMs <= 0.0) {
+            comparison.verdict = Verdict::TooFewSamples;
+            return comparison;
+        }
+        comparison.ratio = comparison.currentMs / comparison.baselineMs;
+
+        // Percentile bootstrap of the median ratio. Timings are skewed by preemption and frequency
+        // changes, which a resampled median handles without assuming any distribution. The fixed
+        // seed keeps the verdict of a given pair of runs reproducible.
+        std::mt19937 random(12345);
+        std::vector<double> ratios(m_Options.resamples);
+        std::vector<double> baseSample(baseline.samplesMs.size()), currentSample(current.samplesMs.size());
+        std::uniform_int_distribution<size_t> pickBase(0, baseSample.size() - 1), pickCurrent(0, currentSample.size() - 1);
+
+        for (double &ratio : ratios) {
+            for (double &sample : baseSample) sample = baseline.samplesMs[pickBase(random)];
+            for (double &sample : currentSample) sample = current.samplesMs[pickCurrent(random)];
+            double baseMedian = median(baseSample);
+            ratio = baseMedian > 0.0 ? median(currentSample) / baseMedian : comparison.ratio;
+        }
+
+        double alpha = (1.0 - m_Options.confidence) / 2.0;
+        comparison.low = percentile(ratios, std::max(alpha, 1e-9));
+        comparison.high = percentile(ratios, 1.0 - alpha);
+
+        if (comparison.low > 1.0 + m_Options.tolerance) comparison.verdict = Verdict::Slower;
+        else if (comparison.high < 1.0 / (1.0 + m_Options.tolerance)) comparison.verdict = Verdict::Faster;
+        else comparison.verdict = Verdict::Unchanged;
+        return comparison;
+    }
+
+    std::vector<std::string> RegressionGate::settingsMismatch(const BenchReport &baseline, const BenchReport &current) {
+        std::vector<std::string> mismatches;
+        if (baseline.isa != current.isa) mismatches.push_back("isa " + baseline.isa + " vs " + current.isa);
+        if (baseline.precision != current.precision) mismatches.push_back("precision " + baseline.precision + " vs " + current.precision);
+        if (baseline.inPlace != current.inPlace) mismatches.push_back(std::string("inplace ") + (baseline.inPlace ? "on" : "off") + " vs " + (current.inPlace ? "on" : "off"));
+        // The JSON keeps six significant digits of sigma
+        if (std::fabs(baseline.sigma - current.sigma) > 1e-5 * std::max(1.0, std::fabs(baseline.sigma))) {
+            std::ostringstream sigma;
+            sigma << "sigma " << baseline.sigma << " vs " << current.sigma;
+            mismatches.push_back(sigma.str());
+        }
+        if (baseline.radius != current.radius) mismatches.push_back("radius " + std::to_string(baseline.radius) + " vs " + std::to_string(current.radius));
+        if (baseline.transport != current.transport) mismatches.push_back("transport " + baseline.transport + " vs " + current.transport);
+        else if (baseline.shmSlots != current.shmSlots) mismatches.push_back("shm slots " + std::to_string(baseline.shmSlots) + " vs " + std::to_string(current.shmSlots));
+        if (baseline.filter != current.filter) mismatches.push_back("filter \"" + baseline.filter + "\" vs \"" + current.filter + "\"");
+        if (baseline.fuse != current.fuse) mismatches.push_back(std::string("fuse ") + (baseline.fuse ? "on" : "off") + " vs " + (current.fuse ? "on" : "off"));
+        return mismatches;
+    }
+
+    bool RegressionGate::passed(const std::vector<Comparison> &comparisons) {
+        return std::none_of(comparisons.begin(), comparisons.end(), [](const Comparison &comparison) {
+            return comparison.verdict == Verdict::Slower || comparison.verdict == Verdict::Failed
+                || comparison.verdict == Verdict::TooFewSamples || comparison.verdict == Verdict::NotRun;
+        });
+    }
+
+    void RegressionGate::printTable(std::ostream &out, const std::vector<Comparison> &comparisons) const {
+        std::ios state(nullptr);
+        state.copyfmt(out);
+
+        out << std::left << std::setw(40) << "case" << std::right << std::setw(12) << "base ms" << std::setw(12) << "now ms"
+            << std::setw(10) << "change" << "  " << std::left << std::setw(22)
+            << (std::to_string((int)std::lround(m_Options.confidence * 100)) + "% interval") << "verdict\n";
+
+        out << std::fixed;
+        for (const Comparison &comparison : comparisons) {
+            out << std::left << std::setw(40) << comparison.benchCase.key() << std::right << std::setprecision(3);
+            bool judged = comparison.verdict == Verdict::Unchanged || comparison.verdict == Verdict::Faster || comparison.verdict == Verdict::Slower;
+            if (judged) {
+                std::ostringstream interval;
+                interval << std::fixed << std::setprecision(1) << std::showpos << "[" << (comparison.low - 1.0) * 100.0 << "%, "
+                         << (comparison.high - 1.0) * 100.0 << "%]";
+                out << std::setw(12) << comparison.baselineMs << std::setw(12) << comparison.currentMs << std::setprecision(1)
+                    << std::setw(9) << std::showpos << (comparison.ratio - 1.0) * 100.0 << std::noshowpos << "%  "
+                    << std::left << std::setw(22) << interval.str();
+            }
+            else {
+                out << std::setw(12) << "-" << std::setw(12) << "-" << std::setw(10) << "-" << "  " << std::left << std::setw(22) << "-";
+            }
+            out << verdictName(comparison.verdict) << "\n";
+        }
+        out.copyfmt(state);
+    }
+}
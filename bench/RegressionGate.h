@@ -0,0 +1,76 @@
+/*
+ * Regression Gate
+ * ===============
+ *
+ * Compares a benchmark run to a stored baseline case by case. The change of
+ * each case is the ratio of the median run times, with a bootstrap
+ * confidence interval drawn from the repeated samples of both runs. A case
+ * only counts as slower when the whole interval lies above the tolerance, so
+ * noise of single timings cannot fail the gate and real slowdowns cannot
+ * hide behind a lucky median.
+ *
+ * Author: Finoshkin Aleksei
+ * License: MIT
+ */
+
+#ifndef IMG_DEINT_REGRESSION_GATE_H
+#define IMG_DEINT_REGRESSION_GATE_H
+
+
+#include "BlurBench.h"
+
+namespace media_proc {
+
+    struct GateOptions {
+        double confidence = 0.95;    // Two-sided level of the interval
+        double tolerance = 0.05;     // Slowdown accepted as noise, 0.05 = 5 %
+        int resamples = 2000;        // Bootstrap resamples per case
+        size_t minSamples = 5;       // Fewer samples on either side and the case is not judged
+    };
+
+    enum class Verdict {
+        Unchanged,      // Interval overlaps the tolerance band
+        Faster,         // Whole interval below it
+        Slower,         // Whole interval above it, fails the gate
+        Failed,         // Ran in the baseline but fails now, fails the gate
+        TooFewSamples,  // Not judged, fails the gate
+        NotRun,         // In the baseline only, fails the gate
+        New             // In this run only, or failed in the baseline
+    };
+
+    const char* verdictName(Verdict verdict);
+
+    struct Comparison {
+        BenchCase benchCase;
+        Verdict verdict = Verdict::Unchanged;
+        double baselineMs = 0.0, currentMs = 0.0;  // Medians
+        double ratio = 1.0;                        // currentMs / baselineMs, above 1 is slower
+        double low = 1.0, high = 1.0;              // Confidence interval of the ratio
+    };
+
+    class RegressionGate {
+    public:
+        explicit RegressionGate(const GateOptions &options = {});
+
+        // One comparison per case of either run, baseline order first
+        std::vector<Comparison> compare(const BenchReport &baseline, const BenchReport &current) const;
+
+        // Settings that differ between the runs (isa, precision, blur, transport, filters), which make
+        // the comparison moot; the gate fails on any of them
+        static std::vector<std::string> settingsMismatch(const BenchReport &baseline, const BenchReport &current);
+
+        // False when any case is slower, fails, did not run or could not be judged: a gate that checked
+        // nothing must not pass
+        static bool passed(const std::vector<Comparison> &comparisons);
+        void printTable(std::ostream &out, const std::vector<Comparison> &comparisons) const;
+
+    private:
+        Comparison compareCase(const BenchResult &baseline, const BenchResult &current) const;
+
+    private:
+        GateOptions m_Options;
+    };
+}
+
+
+#endif //!IMG_DEINT_REGRESSION_GATE_H
@@ -0,0 +1,309 @@
+/*
+ * Image Blur Benchmark
+ * ====================
+ *
+ * Entry point of img_blur_bench: times the blur modes over a matrix of
+ * resolutions, pixel formats and thread counts on synthetic frames, then
+ * prints a table and optionally writes the results as JSON.
+ *
+ * Author: Finoshkin Aleksei
+ * License: MIT
+ */
+
+#include "StdAfx.h"
+#include "parser/CommandLineParser.h"
+
+#include "BlurBench.h"
+#include "RegressionGate.h"
+#include "nodes/BlurModes.h"
+#include "nodes/FilterChain.h"
+#include "kernels/CpuDispatch.h"
+#include "shm/FrameRing.h"
+
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+void printHelp() {
+    std::cout << R"(Image Blur Benchmark
+
+Usage:
+  img_blur_bench [--modes <list>] [--sizes <list>] [--formats <list>] [--threads <list>]
+                 [--warmup <n>] [--runs <n>] [--json <file>] [--shm <slots>] [-f <filters>]
+  img_blur_bench --baseline <file> [--current <file>] [--tolerance <percent>] [--confidence <level>]
+
+Description:
+  Blurs synthetic frames with every requested mode, resolution, pixel format and
+  thread count. Each case gets warm-up runs, then timed runs whose median, p95,
+  throughput and peak scratch memory are reported.
+
+Options:
+  --modes         Comma-separated modes. (Optional, default: all CPU modes)
+                  Available modes: default, async, threads, gpu, simd, simd-threads, tiled
+  --sizes         Comma-separated resolutions as <width>x<height>.
+                  (Optional, default: 640x480,1920x1080,3840x2160)
+  --formats       Comma-separated FFmpeg pixel format names. (Optional, default: yuv420p,nv12,rgba)
+  --threads       Comma-separated thread counts of the multi-threaded modes, 0 = one per core.
+                  Single-threaded modes always run once with 1. (Optional, default: 1,0)
+  --warmup        Untimed runs per case. (Optional, default: 3)
+  --runs          Timed runs per case. (Optional, default: 15)
+  --json          Write the results as JSON to this file. (Optional)
+  --inplace       Benchmark the in-place variants.
+  --precision     Kernel precision: exact, fixed or approx. (Optional, default: exact)
+  --isa           Vector kernels: scalar, sse4.1, avx2 or avx512. (Optional, default: best one)
+  --sigma         Benchmark the Gaussian blur with this sigma.
+  --radius        Gaussian radius in pixels. (Optional, default: ceil(3 * sigma))
+  --filter, -f    Benchmark a filter chain as img_blur -f runs it, e.g. "blur=sigma=2,sharpen=0.5,blur"
+                  (default, threads, simd, simd-threads and tiled modes).
+  --no-fuse       Run every filter of the chain as its own sweep instead of fusing them.
+  --shm           Send the frames through the shared-memory transport of --serve-shm, with
+                  this many ring slots in flight. Times are then round trips from submit to
+                  completion, Mpix/s and GB/s the throughput over all timed frames.
+                  (Optional, default with a bare --shm: 4)
+  --baseline      Regression gate: compare the run to this JSON file written by --json. Without
+                  --modes, --sizes, --formats and --threads the baseline's cases are run again,
+                  and every setting not given here is taken from the baseline. Exits with 2
+                  when a case got significantly slower, fails, is missing or has fewer than 5
+                  samples, or when the settings differ from the baseline's.
+  --current       Regression gate: compare this JSON file instead of running the benchmark.
+  --tolerance     Slowdown in percent that still passes the gate. (Optional, default: 5)
+  --confidence    Level of the bootstrap interval of each slowdown. (Optional, default: 0.95)
+  --help, -h      Show this help message and exit.
+
+Example:
+  img_blur_bench
+  img_blur_bench --modes simd,simd-threads,tiled --sizes 3840x2160 --threads 1,2,4,8
+  img_blur_bench --formats yuv420p10le,gbrpf32le --runs 30 --json results.json
+  img_blur_bench --baseline results.json --json candidate.json
+  img_blur_bench --modes simd,simd-threads --sizes 1920x1080 --formats yuv420p --shm 4 --runs 200
+  img_blur_bench --modes simd,simd-threads --formats yuv420p -f "blur=sigma=2,sharpen=0.5,blur" --no-fuse
+)";
+}
+
+std::vector<std::string> splitList(const std::string &list) {
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+
+bool readReport(const std::string &path, media_proc::BenchReport &report) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cerr << "Error: cannot read " << path << "\n";
+        return false;
+    }
+    try { report = media_proc::BlurBench::readJson(in); }
+    catch (const std::exception &e) {
+        std::cerr << "Error: " << path << ": " << e.what() << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Settings not given on the command line are the baseline's, so a plain --baseline run repeats it
+bool adoptBaselineSettings(const media_proc::CommandLineParser &parser, const media_proc::BenchReport &baseline, media_proc::BenchOptions &options) {
+    if (!parser.hasOption("--isa") && !baseline.isa.empty()) {
+        media_proc::kernels::Isa isa;
+        if (!media_proc::kernels::parseIsa(baseline.isa, isa)) {
+            std::cerr << "Error: baseline was run with unknown kernels " << baseline.isa << "\n";
+            return false;
+        }
+        try { media_proc::kernels::selectIsa(isa); }
+        catch (const std::exception &e) {
+            std::cerr << "Error: baseline was run with " << baseline.isa << " kernels: " << e.what() << "\n";
+            return false;
+        }
+    }
+    if (!parser.hasOption("--precision") && !baseline.precision.empty()
+        && !media_proc::kernels::parsePrecision(baseline.precision, options.blur.precision)) {
+        std::cerr << "Error: baseline was run with unknown precision " << baseline.precision << "\n";
+        return false;
+    }
+    if (!parser.hasOption("--inplace")) options.blur.inPlace = baseline.inPlace;
+    if (!parser.hasOption("--sigma")) options.blur.sigma = (float)baseline.sigma;
+    if (!parser.hasOption("--radius")) options.blur.radius = baseline.radius;
+    if (!parser.hasOption("--no-fuse")) options.blur.fuse = baseline.fuse;
+    if (!parser.hasOption("--filter") && !parser.hasOption("-f")) {
+        try { options.blur.filters = baseline.filter.empty() ? std::vector<media_proc::FilterStage>() : media_proc::parseFilterChain(baseline.filter); }
+        catch (const std::exception &e) {
+            std::cerr << "Error: baseline filter chain: " << e.what() << "\n";
+            return false;
+        }
+    }
+    if (!parser.hasOption("--shm")) options.shmSlots = baseline.transport == "shm" ? baseline.shmSlots : 0;
+    if (!parser.hasOption("--warmup") && baseline.warmup > 0) options.warmup = baseline.warmup;
+    if (!parser.hasOption("--runs") && baseline.runs > 0) options.runs = baseline.runs;
+    return true;
+}
+
+int runGate(const media_proc::CommandLineParser &parser, const media_proc::BenchReport &baseline, const media_proc::BenchReport &current) {
+    media_proc::GateOptions options;
+    options.tolerance = std::strtod(parser.getOption("--tolerance", "5").c_str(), nullptr) / 100.0;
+    options.confidence = std::strtod(parser.getOption("--confidence", "0.95").c_str(), nullptr);
+    if (options.tolerance < 0.0 || options.confidence <= 0.0 || options.confidence >= 1.0) {
+        std::cerr << "Error: --tolerance should not be negative and --confidence should be between 0 and 1\n";
+        return 1;
+    }
+
+    std::vector<std::string> mismatches = media_proc::RegressionGate::settingsMismatch(baseline, current);
+    for (const std::string &mismatch : mismatches) {
+        std::cerr << "Error: baseline was run with different settings: " << mismatch << "\n";
+    }
+    if (!mismatches.empty()) {
+        std::cout << "[Gate] FAILED: the runs used different settings\n";
+        return 2;
+    }
+
+    media_proc::RegressionGate gate(options);
+    std::vector<media_proc::Comparison> comparisons = gate.compare(baseline, current);
+    std::cout << "\n";
+    gate.printTable(std::cout, comparisons);
+
+    bool passed = media_proc::RegressionGate::passed(comparisons);
+    std::cout << "[Gate] " << (passed ? "passed" : "FAILED: significant slowdown, or a failing, missing or unjudged case") << "\n";
+    return passed ? 0 : 2;
+}
+
+int main(int argc, char* argv[]) {
+    media_proc::CommandLineParser parser(argc, argv);
+    if (parser.hasOption("--help") || parser.hasOption("-h")) { printHelp(); return 0; }
+
+    media_proc::BenchOptions options;
+    options.warmup = parser.getIntOption("--warmup", options.warmup);
+    options.runs = parser.getIntOption("--runs", options.runs);
+    if (options.warmup < 0 || options.runs <= 0) {
+        std::cerr << "Error: --warmup should not be negative and --runs should be positive\n";
+        return 1;
+    }
+
+    for (const std::string &mode : splitList(parser.getOption("--modes", "default,async,threads,simd,simd-threads,tiled"))) {
+        if (!media_proc::isSupportedMode(mode)) {
+            std::cerr << "Error: unknown mode " << mode << ", --modes takes [default, async, threads, gpu, simd, simd-threads, tiled]\n";
+            return 1;
+        }
+        options.modes.push_back(mode);
+    }
+
+    for (const std::string &size : splitList(parser.getOption("--sizes", "640x480,1920x1080,3840x2160"))) {
+        int width = 0, height = 0;
+        if (std::sscanf(size.c_str(), "%dx%d", &width, &height) != 2 || width < 3 || height < 3) {
+            std::cerr << "Error: --sizes entries should look like 1920x1080, got " << size << "\n";
+            return 1;
+        }
+        options.resolutions.emplace_back(width, height);
+    }
+
+    for (const std::string &name : splitList(parser.getOption("--formats", "yuv420p,nv12,rgba"))) {
+        AVPixelFormat format = av_get_pix_fmt(name.c_str());
+        if (format == AV_PIX_FMT_NONE) {
+            std::cerr << "Error: unknown pixel format " << name << "\n";
+            return 1;
+        }
+        options.formats.push_back(format);
+    }
+
+    for (const std::string &threads : splitList(parser.getOption("--threads", "1,0"))) {
+        int count = std::atoi(threads.c_str());
+        if (count < 0) {
+            std::cerr << "Error: --threads entries should not be negative\n";
+            return 1;
+        }
+        options.threads.push_back((unsigned int)count);
+    }
+
+    if (parser.hasOption("--isa")) {
+        media_proc::kernels::Isa isa;
+        if (!media_proc::kernels::parseIsa(parser.getOption("--isa"), isa)) {
+            std::cerr << "Error: --isa should be one of: [scalar, sse4.1, avx2, avx512]\n";
+            return 1;
+        }
+        try { media_proc::kernels::selectIsa(isa); }
+        catch (const std::exception &e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    options.blur.inPlace = parser.getBoolOption("--inplace");
+    options.blur.sigma = std::strtof(parser.getOption("--sigma", "0").c_str(), nullptr);
+    options.blur.radius = parser.getIntOption("--radius", 0);
+    options.blur.fuse = !parser.getBoolOption("--no-fuse");
+    if (parser.hasOption("--filter") || parser.hasOption("-f")) {
+        try { options.blur.filters = media_proc::parseFilterChain(parser.getOption("--filter", parser.getOption("-f"))); }
+        catch (const std::exception &e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+    }
+    if (parser.hasOption("--shm")) {
+        // A bare --shm keeps four frames in flight
+        std::string value = parser.getOption("--shm");
+        int slots = value == "true" ? 4 : std::atoi(value.c_str());
+        if (slots < 1 || slots > (int)media_proc::FrameRing::MaxSlots) {
+            std::cerr << "Error: --shm should be between 1 and " << media_proc::FrameRing::MaxSlots << " slots\n";
+            return 1;
+        }
+        options.shmSlots = (unsigned int)slots;
+    }
+    if (parser.hasOption("--precision") && !media_proc::kernels::parsePrecision(parser.getOption("--precision"), options.blur.precision)) {
+        std::cerr << "Error: --precision should be one of: [exact, fixed, approx]\n";
+        return 1;
+    }
+
+    media_proc::BenchReport baseline;
+    bool gate = parser.hasOption("--baseline");
+    if (gate && !readReport(parser.getOption("--baseline"), baseline)) return 1;
+
+    if (parser.hasOption("--current")) {
+        media_proc::BenchReport current;
+        if (!gate) {
+            std::cerr << "Error: --current needs a --baseline to compare with\n";
+            return 1;
+        }
+        if (!readReport(parser.getOption("--current"), current)) return 1;
+        return runGate(parser, baseline, current);
+    }
+
+    if (gate && !adoptBaselineSettings(parser, baseline, options)) return 1;
+    if (gate && options.runs < (int)media_proc::GateOptions().minSamples) {
+        std::cerr << "Error: the regression gate needs --runs of at least " << media_proc::GateOptions().minSamples << "\n";
+        return 1;
+    }
+
+    media_proc::BlurBench bench(options);
+    std::vector<media_proc::BenchCase> cases = bench.cases();
+    bool matrixGiven = parser.hasOption("--modes") || parser.hasOption("--sizes") || parser.hasOption("--formats") || parser.hasOption("--threads");
+    if (gate && !matrixGiven) {
+        cases.clear();
+        for (const media_proc::BenchResult &result : baseline.results) {
+            if (result.benchCase.format != AV_PIX_FMT_NONE) cases.push_back(result.benchCase);
+        }
+    }
+
+    std::cout << "[Bench] " << cases.size() << " cases, " << options.warmup << " warm-up and " << options.runs
+              << " timed runs each, " << media_proc::kernels::isaName(media_proc::kernels::activeKernels().isa) << " kernels"
+              << (options.shmSlots ? ", through a shared-memory ring of " + std::to_string(options.shmSlots) + " slots" : std::string()) << "\n";
+
+    std::vector<media_proc::BenchResult> results = bench.runAll(cases, [](const media_proc::BenchResult &result) {
+        std::cout << "[Bench] " << result.benchCase.key() << ": ";
+        if (result.ok()) std::cout << result.medianMs << " ms\n";
+        else std::cout << "failed: " << result.error << "\n";
+    });
+
+    std::cout << "\n";
+    media_proc::BlurBench::printTable(std::cout, results);
+
+    if (parser.hasOption("--json")) {
+        std::ofstream json(parser.getOption("--json"));
+        if (!json) {
+            std::cerr << "Error: cannot write " << parser.getOption("--json") << "\n";
+            return 1;
+        }
+        bench.writeJson(json, results);
+    }
+    return gate ? runGate(parser, baseline, bench.report(results)) : 0;
+}
@@ -0,0 +1,52 @@
+#!/bin/bash
+# =============================================================================
+#
+# Startup Measurement Script for Image Blur Tool
+# ==============================================
+#
+# Prints the file size, the mapped shared objects, the dynamic loader's time
+# and the median wall time of `--help` for each binary given, e.g. a default
+# build against a --cpu-only one.
+#
+# Usage:
+#   bench/startup.sh <binary>... [runs]
+#   - Binaries: img_blur builds to compare
+#   - Last argument, when a number: --help runs per binary (default: 200)
+#
+# Author: Finoshkin Aleksei
+# License: MIT
+#
+# =============================================================================
+
+RUNS=200
+if [[ "${@: -1}" =~ ^[0-9]+$ ]]; then
+    RUNS=${@: -1}
+    set -- "${@:1:$#-1}"
+fi
+
+if [ $# -eq 0 ]; then
+    echo "Usage: $0 <binary>... [runs]"
+    exit 1
+fi
+
+for BINARY in "$@"; do
+    echo "== $BINARY"
+    echo "file size:      $(stat -c %s "$BINARY") bytes"
+    size "$BINARY" | tail -n 1 | awk '{ print "text/data/bss:  " $1 " / " $2 " / " $3 " bytes" }'
+    echo "shared objects: $(ldd "$BINARY" | wc -l)"
+    ldd "$BINARY" | grep -E "libGL|libX|glfw" | awk '{ print "                " $1 }'
+
+    # First run warms the page cache, the loader's own count is the median of the rest
+    "$BINARY" --help > /dev/null
+    for i in 1 2 3 4 5; do
+        LD_DEBUG=statistics "$BINARY" --help 2>&1 > /dev/null | grep "total startup time" | awk '{ print $(NF-1) }'
+    done | sort -n | sed -n 3p | awk '{ print "loader:         " $1 " cycles" }'
+
+    TIMES=""
+    for ((i = 0; i < RUNS; i++)); do
+        START=$(date +%s%N)
+        "$BINARY" --help > /dev/null
+        TIMES="$TIMES $(( $(date +%s%N) - START ))"
+    done
+    echo $TIMES | tr ' ' '\n' | sort -n | awk -v runs="$RUNS" '{ t[NR] = $1 } END { printf "--help:         %.2f ms median of %d runs\n", t[int((NR + 1) / 2)] / 1e6, runs }'
+done
@@ -8,9 +8,10 @@
 # systems. Handles FFmpeg compilation and project building.
 # 
 # Usage:
-#   ./build_linux.sh [debug|release] [clean]
+#   ./build_linux.sh [debug|release] [clean] [cpu-only]
 #   - First argument: build type (default: release)
 #   - Second argument: 'clean' to force a clean FFmpeg build
+#   - Third argument: 'cpu-only' to build without gpu mode, GL and GLFW
 # 
 # Author: Finoshkin Aleksei
 # License: MIT
@@ -23,20 +24,25 @@ git submodule update --init --recursive
 # Accept build configuration as an argument (default: release)
 BUILD_TYPE=${1:-release}
 CLEAN_FFMPEG=${2:-}
+CPU_ONLY=${3:-}
 
 # FFmpeg
 apt-get update
 
 apt-get install -y \
     build-essential \
-    libtbb-dev \
-    libgl1-mesa-dev \
-    libxxf86vm-dev \
-    libx11-dev \
-    libxcursor-dev \
-    libxrandr-dev \
-    libxinerama-dev \
-    libxi-dev
+    libtbb-dev
+
+if [ "$CPU_ONLY" != "cpu-only" ]; then
+    apt-get install -y \
+        libgl1-mesa-dev \
+        libxxf86vm-dev \
+        libx11-dev \
+        libxcursor-dev \
+        libxrandr-dev \
+        libxinerama-dev \
+        libxi-dev
+fi
 
 apt-get install -y nasm yasm pkg-config \
                 libx264-dev libx265-dev libvpx-dev libfdk-aac-dev \
@@ -95,5 +101,9 @@ make install
 cd ../../
 
 # img-deinterlace
-vendor/premake5/premake5a15 gmake2
+if [ "$CPU_ONLY" == "cpu-only" ]; then
+    vendor/premake5/premake5a15 gmake2 --cpu-only
+else
+    vendor/premake5/premake5a15 gmake2
+fi
 make config=$BUILD_TYPE
\ No newline at end of file
@@ -0,0 +1,175 @@
+/*
+ * Shared-Memory Blur Client
+ * =========================
+ *
+ * Entry point of img_blur_shm_client, the reference client of img_blur --serve-shm:
+ * reads raw frames, blurs them through a shared-memory frame ring and writes them
+ * back out as raw frames. Frames are read straight into ring slots and written
+ * straight out of them, and several are in flight at once.
+ *
+ * Author: Finoshkin Aleksei
+ * License: MIT
+ */
+
+#include "StdAfx.h"
+#include "parser/CommandLineParser.h"
+#include "shm/FrameRingClient.h"
+
+#include <chrono>
+#include <cstdio>
+
+void printHelp() {
+    std::cout << R"(Shared-Memory Blur Client
+
+Usage:
+  img_blur_shm_client --socket <socket_path> --size <width>x<height> --pix-fmt <format>
+                      [-i <input>] [-o <output>] [--slots <n>] [--mode <mode>]
+
+Description:
+  Sends raw frames to an img_blur --serve-shm server through a shared-memory ring and
+  writes the blurred frames in the same raw layout. Pixels never go through the socket.
+
+Options:
+  --socket        Unix socket of the server. (Required)
+  --size          Frame size as <width>x<height>. (Required)
+  --pix-fmt       FFmpeg pixel format of the frames, e.g. yuv420p, nv12, rgba. (Required)
+  --input, -i     Raw frames back to back, or - for stdin. (Optional, default: -)
+  --output, -o    Where the blurred frames go, or - for stdout. (Optional, default: -)
+  --slots         Frames in flight at once. (Optional, default: 4)
+  --mode, -m      Processing mode of this client's frames. (Optional, default: the server's)
+  --help, -h      Show this help message and exit.
+
+Example:
+  img_blur --serve-shm /tmp/img_blur-shm.sock --mode simd &
+  ffmpeg -i clip.mp4 -f rawvideo -pix_fmt yuv420p - \
+    | img_blur_shm_client --socket /tmp/img_blur-shm.sock --size 1920x1080 --pix-fmt yuv420p \
+    | ffplay -f rawvideo -pixel_format yuv420p -video_size 1920x1080 -
+)";
+}
+
+// Rows of every plane as rawvideo packs them: no padding, one plane after the other
+struct RawLayout {
+    int planes = 0;
+    int rowBytes[4] = {};
+    int rows[4] = {};
+};
+
+bool rawLayout(int width, int height, AVPixelFormat format, RawLayout &layout) {
+    if(av_image_fill_linesizes(layout.rowBytes, format, width) < 0) return false;
+    ptrdiff_t strides[4] = {};
+    for(int i = 0; i < 4; ++i) strides[i] = layout.rowBytes[i];
+    size_t sizes[4] = {};
+    if(av_image_fill_plane_sizes(sizes, format, height, strides) < 0) return false;
+    for(layout.planes = 0; layout.planes < 4 && sizes[layout.planes] > 0; ++layout.planes) {
+        layout.rows[layout.planes] = (int)(sizes[layout.planes] / layout.rowBytes[layout.planes]);
+    }
+    return layout.planes > 0;
+}
+
+// False at the end of the input; a frame cut short counts as the end
+bool readFrame(FILE* input, const RawLayout &layout, media_proc::FrameRing &ring, uint32_t slot) {
+    for(int plane = 0; plane < layout.planes; ++plane) {
+        uint8_t* row = ring.plane(slot, plane);
+        for(int y = 0; y < layout.rows[plane]; ++y, row += ring.linesize(slot, plane)) {
+            if(std::fread(row, 1, layout.rowBytes[plane], input) != (size_t)layout.rowBytes[plane]) return false;
+        }
+    }
+    return true;
+}
+
+bool writeFrame(FILE* output, const RawLayout &layout, media_proc::FrameRing &ring, uint32_t slot) {
+    for(int plane = 0; plane < layout.planes; ++plane) {
+        const uint8_t* row = ring.plane(slot, plane);
+        for(int y = 0; y < layout.rows[plane]; ++y, row += ring.linesize(slot, plane)) {
+            if(std::fwrite(row, 1, layout.rowBytes[plane], output) != (size_t)layout.rowBytes[plane]) return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    media_proc::CommandLineParser parser(argc, argv);
+    if(parser.getOptCount() == 0 || parser.hasOption("--help") || parser.hasOption("-h")) { printHelp(); return 0; }
+
+    std::string socketPath = parser.getOption("--socket");
+    int width = 0, height = 0;
+    AVPixelFormat format = av_get_pix_fmt(parser.getOption("--pix-fmt").c_str());
+    if(socketPath.empty() || std::sscanf(parser.getOption("--size").c_str(), "%dx%d", &width, &height) != 2 || format == AV_PIX_FMT_NONE) {
+        std::cerr << "Error: --socket, --size <width>x<height> and --pix-fmt are required (use --help/-h for more info)\n";
+        return 1;
+    }
+
+    RawLayout raw;
+    size_t slotBytes = media_proc::FrameRing::frameBytes(width, height, format);
+    if(slotBytes == 0 || !rawLayout(width, height, format, raw)) {
+        std::cerr << "Error: cannot lay out " << width << "x" << height << " " << parser.getOption("--pix-fmt") << " frames in shared memory\n";
+        return 1;
+    }
+
+    std::string inputName = parser.getOption("--input", parser.getOption("-i", "-"));
+    std::string outputName = parser.getOption("--output", parser.getOption("-o", "-"));
+    std::string mode = parser.getOption("--mode", parser.getOption("-m"));
+    int slots = parser.getIntOption("--slots", 4);
+    if(slots < 1 || slots > (int)media_proc::FrameRing::MaxSlots) {
+        std::cerr << "Error: --slots should be between 1 and " << media_proc::FrameRing::MaxSlots << "\n";
+        return 1;
+    }
+
+    FILE* input = inputName == "-" ? stdin : std::fopen(inputName.c_str(), "rb");
+    FILE* output = outputName == "-" ? stdout : std::fopen(outputName.c_str(), "wb");
+    if(!input || !output) {
+        std::cerr << "Error: cannot open " << (!input ? inputName : outputName) << "\n";
+        return 1;
+    }
+
+    media_proc::FrameRingClient client;
+    try { client.connect(socketPath, (uint32_t)slots, slotBytes, mode); }
+    catch(const std::exception &e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t frames = 0, failed = 0;
+    double processMs = 0.0;
+    bool inputDone = false;
+    try {
+        while(true) {
+            // Keeps every slot busy: fill a free one while there is input, otherwise take the oldest back
+            uint32_t slot;
+            if(!inputDone && client.acquire(slot)) {
+                client.ring().prepare(slot, width, height, format);
+                if(readFrame(input, raw, client.ring(), slot)) client.submit(slot);
+                else {
+                    client.release(slot);
+                    inputDone = true;
+                }
+                continue;
+            }
+            if(client.inFlight() == 0) break;
+
+            slot = client.wait();
+            media_proc::FrameSlot &result = client.ring().slot(slot);
+            if(result.state.load() == (uint32_t)media_proc::SlotState::Failed) {
+                std::cerr << "Error: frame " << frames << ": " << result.error << "\n";
+                ++failed;
+            }
+            processMs += result.processMs;
+            if(!writeFrame(output, raw, client.ring(), slot)) throw std::runtime_error("cannot write " + outputName);
+            client.release(slot);
+            ++frames;
+        }
+    }
+    catch(const std::exception &e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    std::fflush(output);
+    if(input != stdin) std::fclose(input);
+    if(output != stdout) std::fclose(output);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << "[Client] " << frames << " frames in " << seconds << " s: " << (seconds > 0.0 ? frames / seconds : 0.0) << " frames/s, "
+              << (frames ? processMs / frames : 0.0) << " ms blur per frame on the server\n";
+    return failed ? 1 : 0;
+}
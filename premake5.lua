@@ -10,11 +10,6 @@
  * License: MIT
 --]]
 
-newoption {
-    trigger = "simd",
-    description = "Enable SIMD (AVX2) support for image processing"
-}
-
 workspace "img_blur"
     configurations { "Debug", "Release" }
     architecture "x86_64"
@@ -22,9 +17,193 @@ workspace "img_blur"
 
 outputdir = "%{cfg.buildcfg}-%{cfg.system}-%{cfg.architecture}"
 
-dofile("external/glfw-premake5.lua")
+newoption {
+    trigger = "cpu-only",
+    description = "Leave out the GPU plugin (img_blur_gpu) and GLFW; gpu mode reports it is unavailable"
+}
+
+if not _OPTIONS["cpu-only"] then
+    dofile("external/glfw-premake5.lua")
+end
+
+newoption {
+    trigger = "no-tracing",
+    description = "Compile out the trace spans behind --trace (utils/Trace.h)"
+}
+
+newoption {
+    trigger = "track-memory",
+    description = "Count heap bytes per subsystem for --memory-report (utils/MemoryProfiler.h)"
+}
+
+-- FFmpeg allocations reach the profiler through the linker, FFmpeg has no allocator hook
+ffmpegAllocators = { "av_malloc", "av_mallocz", "av_calloc", "av_malloc_array", "av_realloc", "av_realloc_array",
+                     "av_realloc_f", "av_reallocp", "av_fast_realloc", "av_fast_malloc", "av_fast_mallocz",
+                     "av_strdup", "av_strndup", "av_memdup", "av_dynarray_add", "av_dynarray_add_nofree",
+                     "av_dynarray2_add", "av_free", "av_freep" }
+
+-- Settings shared by the tool and its benchmark, both build every node and kernel in src/
+function blurProject(name)
+    project(name)
+        kind "ConsoleApp"
+        language "C++"
+        cppdialect "C++17"
+        targetdir ("bin/" .. outputdir .. "/%{prj.name}")
+        objdir ("bin-int/" .. outputdir .. "/%{prj.name}")
+        staticruntime "On"
+        dependson { "ffmpeg" }
+
+        -- Global defines for the entire project
+        defines { "NOMINMAX" }
+
+        filter { "options:cpu-only" }
+            defines { "DISABLE_GPU" }
+        filter { "options:no-tracing" }
+            defines { "DISABLE_TRACING" }
+        filter { "options:track-memory" }
+            defines { "TRACK_MEMORY" }
+        filter { "options:track-memory", "system:linux" }
+            linkoptions { "-Wl,--wrap=" .. table.concat(ffmpegAllocators, ",--wrap=") }
+        filter {}
+
+        -- The GL node is built into the img_blur_gpu plugin (Linux) and only compiled in on Windows
+        files { "src/**.h", "src/**.cpp" }
+        removefiles { "src/gpu/**" }
+        includedirs {
+            "src",
+            "external/ffmpeg/build/include"
+        }
+        libdirs { 
+            "external/ffmpeg/build/lib" 
+        }
+
+        filter { "configurations:Debug" }
+            defines { "DEBUG" }
+            runtime "Debug"
+            symbols "On"
+
+        filter { "configurations:Release" }
+            defines { "NDEBUG" }
+            runtime "Release"
+            optimize "On"
+
+        filter { "configurations:Debug", "system:windows" }
+            buildoptions { "/MTd" }
+        filter { "configurations:Release", "system:windows" }
+            buildoptions { "/MT" }
+
+        filter { "configurations:Debug", "system:linux"}
+            buildoptions { "-static-libgcc", "-static-libstdc++", "-g" }
+        filter { "configurations:Release", "system:linux"}
+            buildoptions { "-static-libgcc", "-static-libstdc++" }
+
+        -- Vector kernels: each ISA level gets its own flags, the rest of the binary stays baseline x86-64
+        -- and kernels/CpuDispatch picks a level at runtime
+        filter { "files:src/kernels/*SSE41.cpp", "system:linux" }
+            buildoptions { "-msse4.1" }
+        filter { "files:src/kernels/*AVX2.cpp", "system:linux" }
+            buildoptions { "-mavx2", "-mf16c" }
+        filter { "files:src/kernels/*AVX512.cpp", "system:linux" }
+            buildoptions { "-mavx512f", "-mavx512bw" }
+        filter { "files:src/kernels/*AVX2.cpp", "system:windows" }
+            buildoptions { "/arch:AVX2" }
+        filter { "files:src/kernels/*AVX512.cpp", "system:windows" }
+            buildoptions { "/arch:AVX512" }
 
-project "img_blur"
+        filter { "system:windows" }
+            defines { "WINDOWS" }
+            links {
+                "avutil",
+                "avcodec",
+                "avdevice",
+                "avformat",
+                "swscale",
+                "swresample",
+                "avfilter"
+            }
+        filter { "system:windows", "options:not cpu-only" }
+            defines { "GPU_BUILTIN" }
+            dependson { "glfw" }
+            files { "src/gpu/**.h", "src/gpu/**.cpp", "external/glad/src/glad.c", "external/glad/src/glad_wgl.c" }
+            includedirs { "external/glfw/include", "external/glad/include" }
+            links { "glfw", "opengl32" }
+
+        filter { "system:linux" }
+            defines { "LINUX" }
+            links {
+                "avfilter",
+                "avformat",
+                "avcodec",
+                "swresample",
+                "swscale",
+                "avutil",
+                "m",
+                "z", 
+                "pthread",
+                "dl",
+                "tbb",
+                "ssl",
+                "crypto"
+            }
+        -- The GPU plugin takes FFmpeg, the pools and the metrics registry from the executable
+        filter { "system:linux", "options:not cpu-only" }
+            linkoptions { "-Wl,--export-dynamic" }
+
+    filter {}
+end
+
+blurProject "img_blur"
+
+-- OpenGL blur as a plugin dlopen()ed by nodes/GpuBackend for gpu mode, so only that mode loads GL, X11 and GLFW.
+-- Its undefined symbols (FFmpeg, pools, metrics) resolve against the executable that loads it.
+if not _OPTIONS["cpu-only"] and os.istarget("linux") then
+    project "img_blur_gpu"
+        kind "SharedLib"
+        language "C++"
+        cppdialect "C++17"
+        targetdir ("bin/" .. outputdir .. "/%{prj.name}")
+        objdir ("bin-int/" .. outputdir .. "/%{prj.name}")
+        pic "On"
+        dependson { "ffmpeg" }
+        dependson { "glfw" }
+        defines { "NOMINMAX", "LINUX" }
+
+        filter { "options:no-tracing" }
+            defines { "DISABLE_TRACING" }
+        filter { "options:track-memory" }
+            defines { "TRACK_MEMORY" }
+        filter {}
+
+        files { "src/gpu/**.h", "src/gpu/**.cpp", "external/glad/src/glad.c", "external/glad/src/glad_glx.c" }
+        includedirs {
+            "src",
+            "external/ffmpeg/build/include",
+            "external/glfw/include",
+            "external/glad/include"
+        }
+        links { "glfw", "GL", "X11", "Xrandr", "Xi", "Xxf86vm", "Xcursor", "dl", "pthread" }
+
+        filter { "configurations:Debug" }
+            defines { "DEBUG" }
+            runtime "Debug"
+            symbols "On"
+
+        filter { "configurations:Release" }
+            defines { "NDEBUG" }
+            runtime "Release"
+            optimize "On"
+
+        filter {}
+end
+
+-- Benchmark: the same nodes and kernels, driven by bench/main.cpp instead of the tool's entry point
+blurProject "img_blur_bench"
+    files { "bench/**.h", "bench/**.cpp" }
+    removefiles { "src/main.cpp" }
+    includedirs { "bench" }
+
+-- Reference client of --serve-shm: the frame ring and libavutil only, no codecs or kernels
+project "img_blur_shm_client"
     kind "ConsoleApp"
     language "C++"
     cppdialect "C++17"
@@ -32,21 +211,14 @@ project "img_blur"
     objdir ("bin-int/" .. outputdir .. "/%{prj.name}")
     staticruntime "On"
     dependson { "ffmpeg" }
-    dependson { "glfw" }
-
-    -- Global defines for the entire project
     defines { "NOMINMAX" }
 
-    files { "src/**.h", "src/**.cpp", "external/glad/src/glad.c" }
+    files { "client/**.cpp", "src/shm/**.h", "src/shm/**.cpp", "src/parser/**.h", "src/parser/**.cpp" }
     includedirs {
         "src",
-        "external/ffmpeg/build/include",
-        "external/glfw/include",
-        "external/glad/include"
-    }
-    libdirs { 
-        "external/ffmpeg/build/lib" 
+        "external/ffmpeg/build/include"
     }
+    libdirs { "external/ffmpeg/build/lib" }
 
     filter { "configurations:Debug" }
         defines { "DEBUG" }
@@ -58,63 +230,12 @@ project "img_blur"
         runtime "Release"
         optimize "On"
 
-    filter { "configurations:Debug", "system:windows" }
-        buildoptions { "/MTd" }
-    filter { "configurations:Release", "system:windows" }
-        buildoptions { "/MT" }
-
-    filter { "configurations:Debug", "system:linux"}
-        buildoptions { "-static-libgcc", "-static-libstdc++", "-g" }
-    filter { "configurations:Release", "system:linux"}
-        buildoptions { "-static-libgcc", "-static-libstdc++" }
-
--- Enable SIMD (AVX2) 
-if _OPTIONS["simd"] then
-    defines { "USE_SIMD" }
-    filter { "system:linux" }
-        buildoptions { "-mavx2" }
-    filter { "system:windows" }
-        buildoptions { "/arch:AVX2" }
-    filter {} 
-end
-
     filter { "system:windows" }
         defines { "WINDOWS" }
-        files { "external/glad/src/glad_wgl.c" }
-        links {
-            "avutil",
-            "avcodec",
-            "avdevice",
-            "avformat",
-            "swscale",
-            "swresample",
-            "avfilter",
-            "glfw",
-            "opengl32"
-        }
+        links { "avutil" }
 
     filter { "system:linux" }
         defines { "LINUX" }
-        files { "external/glad/src/glad_glx.c" }
-        links {
-            "avfilter",
-            "avformat",
-            "avcodec",
-            "swresample",
-            "swscale",
-            "avutil",
-            "m",
-            "z", 
-            "pthread",
-            "dl",
-            "GL",
-            "tbb",
-            "ssl",
-            "crypto",
-            "X11",
-            "Xrandr",
-            "Xi",
-            "Xxf86vm",
-            "Xcursor",
-            "glfw"
-        }
\ No newline at end of file
+        links { "avutil", "m", "pthread" }
+
+    filter {}
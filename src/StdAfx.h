@@ -27,13 +27,8 @@ extern "C" {
 #include <libswscale/swscale.h>
 }
 
-#define GLAD_GLX 0
-extern "C" {
-#include <glad/glad.h>
-}
-#include <GLFW/glfw3.h>
-
 #include "utils/Timer.h"
+#include "utils/Trace.h"
 #include "utils/MemoryProfiler.h"
 
 #endif //!STD_AFX_H
\ No newline at end of file
@@ -0,0 +1,198 @@
+#include "BatchRunner.h"
+
+#include "nodes/FFmpegDecNode.h"
+#include "nodes/FFmpegEncNode.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <unordered_map>
+
+#ifdef LINUX
+#include <glob.h>
+#endif
+
+namespace fs = std::filesystem;
+
+static std::string lowerExtension(const fs::path &path) {
+    std::string ext = path.extension().string();
+    if (!ext.empty()) ext.erase(0, 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext;
+}
+
+static bool isImageExtension(const std::string &ext) {
+    static const std::vector<std::string> extensions = { "bmp", "jpg", "jpeg", "png", "tif", "tiff", "webp", "pgm", "ppm", "exr" };
+    return std::find(extensions.begin(), extensions.end(), ext) != extensions.end();
+}
+
+namespace media_proc {
+
+    // One decoder -> processor -> encoder chain that is retargeted for every job
+    class BatchLane {
+    public:
+        BatchLane(std::unique_ptr<PipelineNode> processor, const CodecOptions &codecs) : m_Processor(std::move(processor)), m_Codecs(codecs) { }
+
+        void process(const BatchJob &job, bool concurrent, int queueDepth) {
+            if (!m_Root) {
+                auto decoder = std::make_unique<FFmpegDecNode>(job.input, m_Codecs.decoder);
+                auto encoder = std::make_unique<FFmpegEncNode>(job.output, m_Codecs.encoder);
+                m_Decoder = decoder.get();
+                m_Encoder = encoder.get();
+
+                m_Processor->tail().setNext(std::move(encoder));
+                decoder->setNext(std::move(m_Processor));
+                m_Root = std::move(decoder);
+            }
+            else {
+                m_Decoder->setInput(job.input);
+                m_Encoder->setOutput(job.output);
+            }
+
+            if (concurrent) m_Root->executeConcurrent(queueDepth);
+            else m_Root->execute();
+        }
+
+    private:
+        std::unique_ptr<PipelineNode> m_Processor;
+        CodecOptions m_Codecs;
+        std::unique_ptr<PipelineNode> m_Root;
+        FFmpegDecNode* m_Decoder = nullptr;
+        FFmpegEncNode* m_Encoder = nullptr;
+    };
+
+    BatchRunner::BatchRunner(const BatchOptions &options, ProcessorFactory factory) : m_Options(options), m_Factory(std::move(factory)) { }
+
+    std::vector<std::string> BatchRunner::collectInputs(const std::string &spec) {
+        std::vector<std::string> inputs;
+
+        bool listFile = spec.rfind("@", 0) == 0;
+        std::string path = listFile ? spec.substr(1) : spec;
+        if (!listFile && fs::is_regular_file(path)) {
+            std::string ext = lowerExtension(path);
+            listFile = (ext == "txt" || ext == "lst");
+        }
+
+        if (listFile) {
+            std::ifstream list(path);
+            if (!list) throw std::runtime_error("Failed to open list file: " + path);
+            for (std::string line; std::getline(list, line);) {
+                line.erase(line.find_last_not_of(" \t\r") + 1);
+                if (!line.empty() && line[0] != '#') inputs.push_back(line);
+            }
+        }
+        else if (fs::is_directory(path)) {
+            for (const auto &entry : fs::directory_iterator(path)) {
+                if (entry.is_regular_file() && isImageExtension(lowerExtension(entry.path()))) inputs.push_back(entry.path().string());
+            }
+        }
+        else if (path.find_first_of("*?[") != std::string::npos) {
+        #ifdef LINUX
+            glob_t matches;
+            if (glob(path.c_str(), 0, nullptr, &matches) == 0) {
+                for (size_t i = 0; i < matches.gl_pathc; ++i) inputs.push_back(matches.gl_pathv[i]);
+            }
+            globfree(&matches);
+        #else
+            throw std::runtime_error("Glob patterns are not supported on this platform: " + path);
+        #endif
+        }
+        else if (fs::is_regular_file(path)) inputs.push_back(path);
+        else throw std::runtime_error("Batch input not found: " + path);
+
+        std::sort(inputs.begin(), inputs.end());
+        return inputs;
+    }
+
+    std::vector<BatchJob> BatchRunner::createJobs(const std::vector<std::string> &inputs) const {
+        std::vector<BatchJob> jobs;
+        jobs.reserve(inputs.size());
+
+        // Outputs keep the input's file name, so two inputs named alike would overwrite each other
+        std::unordered_map<std::string, const std::string*> outputs;
+        for (const auto &input : inputs) {
+            BatchJob job;
+            job.input = input;
+            job.output = (fs::path(m_Options.outputDir) / fs::path(input).filename()).string();
+
+            auto inserted = outputs.emplace(job.output, &input);
+            if (!inserted.second) throw std::runtime_error("Batch inputs " + *inserted.first->second + " and " + input + " would both write " + job.output);
+
+            std::error_code error;
+            job.size = fs::file_size(input, error);
+            if (error) job.size = 0;
+            jobs.push_back(std::move(job));
+        }
+
+        // Same extension next to each other, then by size, so consecutive jobs on a lane
+        // tend to share codec and geometry and keep their contexts open
+        std::sort(jobs.begin(), jobs.end(), [](const BatchJob &a, const BatchJob &b) {
+            std::string extA = lowerExtension(a.input), extB = lowerExtension(b.input);
+            if (extA != extB) return extA < extB;
+            return a.size < b.size;
+        });
+        return jobs;
+    }
+
+    BatchStats BatchRunner::run(const std::vector<std::string> &inputs) {
+        std::vector<BatchJob> jobs = createJobs(inputs);
+        fs::create_directories(m_Options.outputDir);
+
+        std::vector<BatchJob> smallJobs, largeJobs;
+        for (auto &job : jobs) {
+            if (job.size >= m_Options.largeInputBytes) largeJobs.push_back(std::move(job));
+            else smallJobs.push_back(std::move(job));
+        }
+
+        BatchStats stats;
+        stats.smallJobs = smallJobs.size();
+        stats.largeJobs = largeJobs.size();
+        stats.lanes = m_Options.lanes ? m_Options.lanes : std::max(1u, std::thread::hardware_concurrency());
+        stats.lanes = (unsigned int)std::min<size_t>(stats.lanes, std::max<size_t>(smallJobs.size(), 1));
+
+        std::atomic<size_t> processed{0}, failed{0};
+        std::mutex logMutex;
+        // The lane is built on its first job, so a processor that fails to construct fails that job
+        // and the next job tries again, instead of the exception leaving the lane thread
+        auto runJob = [&](std::unique_ptr<BatchLane> &lane, const std::string &mode, const CodecOptions &codecs, const BatchJob &job) {
+            try {
+                if (!lane) lane = std::make_unique<BatchLane>(m_Factory(mode), codecs);
+                lane->process(job, m_Options.concurrent, m_Options.queueDepth);
+                processed.fetch_add(1, std::memory_order_relaxed);
+            } catch (const std::exception &e) {
+                failed.fetch_add(1, std::memory_order_relaxed);
+                std::lock_guard<std::mutex> lock(logMutex);
+                std::cerr << "[Batch] " << job.input << " failed: " << e.what() << "\n";
+            }
+        };
+
+        auto start = std::chrono::steady_clock::now();
+
+        // Small inputs: single-threaded chains side by side, one per lane
+        if (!smallJobs.empty()) {
+            std::atomic<size_t> nextJob{0};
+            std::vector<std::thread> lanes;
+            for (unsigned int i = 0; i < stats.lanes; ++i) {
+                lanes.emplace_back([&]() {
+                    std::unique_ptr<BatchLane> lane;
+                    for (size_t index = nextJob++; index < smallJobs.size(); index = nextJob++) runJob(lane, m_Options.smallMode, m_Options.smallCodecs, smallJobs[index]);
+                });
+            }
+            for (auto &lane : lanes) lane.join();
+        }
+
+        // Large inputs: one at a time, the processor splits each image across all cores
+        if (!largeJobs.empty()) {
+            std::unique_ptr<BatchLane> lane;
+            for (const auto &job : largeJobs) runJob(lane, m_Options.largeMode, m_Options.largeCodecs, job);
+        }
+
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        stats.processed = processed.load();
+        stats.failed = failed.load();
+        return stats;
+    }
+}
@@ -0,0 +1,72 @@
+/*
+ * Batch Runner
+ * ============
+ *
+ * Processes many images in one process. Each lane owns a decoder -> processor -> encoder
+ * chain that stays alive across inputs, so codec contexts, processor state and thread
+ * pools are created once per lane instead of once per file.
+ *
+ * Author: Finoshkin Aleksei
+ * License: MIT
+ */
+
+#ifndef IMG_DEINT_BATCH_RUNNER_H
+#define IMG_DEINT_BATCH_RUNNER_H
+
+
+#include "nodes/base/Pipeline.h"
+#include "nodes/CodecOptions.h"
+
+#include <functional>
+
+namespace media_proc {
+
+    using ProcessorFactory = std::function<std::unique_ptr<PipelineNode>(const std::string &mode)>;
+
+    struct BatchOptions {
+        std::string outputDir = "blurred";
+        std::string largeMode = "threads";   // processor spreading one image across all cores
+        std::string smallMode = "default";   // single-threaded processor, one per lane
+        uintmax_t largeInputBytes = 2 << 20;
+        unsigned int lanes = 0;              // 0 = std::thread::hardware_concurrency()
+        bool concurrent = false;
+        int queueDepth = 4;
+        CodecOptions smallCodecs;            // codec threads of the lanes, one each by default
+        CodecOptions largeCodecs;            // codec threads while a large input has the machine
+    };
+
+    struct BatchJob {
+        std::string input;
+        std::string output;
+        uintmax_t size = 0;
+    };
+
+    struct BatchStats {
+        size_t processed = 0, failed = 0;
+        size_t smallJobs = 0, largeJobs = 0;
+        unsigned int lanes = 0;
+        double seconds = 0.0;
+
+        double imagesPerSecond() const { return seconds > 0.0 ? processed / seconds : 0.0; }
+    };
+
+    class BatchRunner {
+    public:
+        BatchRunner(const BatchOptions &options, ProcessorFactory factory);
+
+        // Expands a directory, a glob pattern or a list file (@list.txt, *.txt, *.lst) into input paths
+        static std::vector<std::string> collectInputs(const std::string &spec);
+
+        BatchStats run(const std::vector<std::string> &inputs);
+
+    private:
+        std::vector<BatchJob> createJobs(const std::vector<std::string> &inputs) const;
+
+    private:
+        BatchOptions m_Options;
+        ProcessorFactory m_Factory;
+    };
+}
+
+
+#endif //!IMG_DEINT_BATCH_RUNNER_H
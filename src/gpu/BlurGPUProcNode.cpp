@@ -63,8 +63,7 @@ const char* blurShaderSource = R"(
     BlurGPUProcNode::BlurGPUProcNode() { }
     BlurGPUProcNode::~BlurGPUProcNode() { 
         if (m_ShaderProgram) glDeleteProgram(m_ShaderProgram);
-        for (auto &[key, texture] : m_InputTextures) glDeleteTextures(1, &texture);
-        for (auto &[key, texture] : m_OutputTextures) glDeleteTextures(1, &texture);
+        releaseTextures();
 
         if (m_GLFWInstance) {
             glfwDestroyWindow(m_GLFWInstance);
@@ -112,7 +111,7 @@ const char* blurShaderSource = R"(
     }
 
     void BlurGPUProcNode::blend(AVFrame* frame) {
-        media_proc::Timer timer("Running blend with mode: GPU");
+        TRACE_SPAN("blur gpu");
 
         if (!frame || !frame->data[0]) {
             throw std::runtime_error("Invalid frame data");
@@ -165,8 +164,7 @@ const char* blurShaderSource = R"(
         }
     }
 
-    void BlurGPUProcNode::init(std::shared_ptr<const PipelineContext> context) {
-
+    void BlurGPUProcNode::createContext() {
         if (!glfwInit()) { throw std::runtime_error("GLFW initialization failed!"); }
 
         glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
@@ -196,11 +194,26 @@ const char* blurShaderSource = R"(
         } catch (const std::exception& e) {
             throw std::runtime_error("Failed to parse OpenGL Shading Language version: " + std::string(glslVersionStr));
         }
+    }
+
+    void BlurGPUProcNode::releaseTextures() {
+        for (auto &[key, texture] : m_InputTextures) glDeleteTextures(1, &texture);
+        for (auto &[key, texture] : m_OutputTextures) glDeleteTextures(1, &texture);
+        m_InputTextures.clear();
+        m_OutputTextures.clear();
+    }
+
+    void BlurGPUProcNode::init(std::shared_ptr<const PipelineContext> context) {
+        // The GL context and shader survive re-init with a new geometry, only the textures are rebuilt
+        if (!m_GLFWInstance) {
+            createContext();
+            compileShader();
+        }
 
         m_PixelFormatDesc = av_pix_fmt_desc_get(context->pixelFormat);
         if (!m_PixelFormatDesc) throw std::runtime_error("Pixel Format Descriptor not found");
 
-        compileShader();
+        releaseTextures();
         createTextures(m_PixelFormatDesc, context->linesizes, context->height);
     }
 
@@ -4,6 +4,7 @@
  * 
  * GPU-accelerated deinterlacing implementation using OpenGL compute shaders.
  * Provides high-performance parallel processing on graphics hardware.
+ * Built into the img_blur_gpu plugin, nodes/GpuBackend loads it for gpu mode.
  * 
  * Author: Finoshkin Aleksei
  * License: MIT
@@ -12,7 +13,13 @@
 #ifndef IMG_DEINT_GPU_PROCESSOR_NODE_H
 #define IMG_DEINT_GPU_PROCESSOR_NODE_H
 
-#include "base/Processor.h"
+#include "nodes/base/Processor.h"
+
+#define GLAD_GLX 0
+extern "C" {
+#include <glad/glad.h>
+}
+#include <GLFW/glfw3.h>
 
 #include <unordered_map>
 
@@ -33,7 +40,9 @@ namespace media_proc {
         ~BlurGPUProcNode();
     
     private:
+        void createContext();
         void compileShader();
+        void releaseTextures();
         void createTextures(const AVPixFmtDescriptor *desc, const std::vector<int> &linesizes, int h);
         void blend(AVFrame* frame);
 
@@ -42,7 +51,7 @@ namespace media_proc {
         virtual std::unique_ptr<PipelinePacket> updatePacket(std::unique_ptr<PipelinePacket> packet) override;
                 
     private:
-        GLuint m_ShaderProgram;
+        GLuint m_ShaderProgram = 0;
         std::unordered_map<std::pair<int, int>, GLuint, PairHash> m_InputTextures, m_OutputTextures;
 
         GLFWwindow* m_GLFWInstance = nullptr;
@@ -0,0 +1,15 @@
+#include "BlurGPUProcNode.h"
+#include "nodes/GpuBackend.h"
+
+// Entry points of the img_blur_gpu plugin, looked up by nodes/GpuBackend.cpp
+extern "C" {
+
+GPU_PLUGIN_EXPORT int img_blur_gpu_plugin_version() {
+    return media_proc::GpuPluginVersion;
+}
+
+GPU_PLUGIN_EXPORT media_proc::PipelineNode* img_blur_create_gpu_processor() {
+    return new media_proc::BlurGPUProcNode();
+}
+
+}
@@ -0,0 +1,436 @@
+#include "AsyncFileWriter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#ifdef LINUX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/version.h>
+// IORING_OP_WRITE first appeared in the Linux 5.6 uapi headers; older ones (Ubuntu 20.04 ships 5.4)
+// build with the thread backend only
+#if __has_include(<linux/io_uring.h>) && LINUX_VERSION_CODE >= KERNEL_VERSION(5, 6, 0)
+#include <linux/io_uring.h>
+#define HAVE_IO_URING 1
+#endif
+#endif
+
+namespace media_proc {
+
+    struct WriteRequest {
+        PooledBuffer buffer;
+        size_t size = 0;
+        uint64_t offset = 0;
+    };
+
+#ifdef LINUX
+    // Writes `size` bytes at `offset`, resuming after short writes; 0 or an AVERROR code
+    static int writeFully(int file, const uint8_t* data, size_t size, uint64_t offset) {
+        while (size > 0) {
+            ssize_t written = pwrite(file, data, size, (off_t)offset);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                return AVERROR(errno);
+            }
+            data += written;
+            size -= (size_t)written;
+            offset += (uint64_t)written;
+        }
+        return 0;
+    }
+#endif
+
+    // Writes batches in the background. Used by one thread at a time, the one running the muxer.
+    class AsyncWriteBackend {
+    public:
+        virtual ~AsyncWriteBackend() = default;
+
+        virtual void submit(WriteRequest request) = 0;
+        // Blocks until at most `inFlight` batches are pending; returns the first write error
+        virtual int wait(size_t inFlight) = 0;
+    };
+
+#ifdef LINUX
+    // Batches on a writer thread, for kernels and sandboxes without io_uring
+    class ThreadWriteBackend : public AsyncWriteBackend {
+    public:
+        explicit ThreadWriteBackend(int file) : m_File(file), m_Thread([this]() { run(); }) { }
+
+        ~ThreadWriteBackend() override {
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Stop = true;
+            }
+            m_WakeUp.notify_all();
+            m_Thread.join();
+        }
+
+        void submit(WriteRequest request) override {
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Queue.push_back(std::move(request));
+                ++m_InFlight;
+            }
+            m_WakeUp.notify_all();
+        }
+
+        int wait(size_t inFlight) override {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_Done.wait(lock, [&]() { return m_InFlight <= inFlight; });
+            return m_Error;
+        }
+
+    private:
+        void run() {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            while (true) {
+                m_WakeUp.wait(lock, [this]() { return m_Stop || !m_Queue.empty(); });
+                if (m_Queue.empty()) return;
+
+                WriteRequest request = std::move(m_Queue.front());
+                m_Queue.pop_front();
+                lock.unlock();
+                int error = writeFully(m_File, request.buffer.data(), request.size, request.offset);
+                request.buffer.reset();
+                lock.lock();
+
+                if (error < 0 && m_Error == 0) m_Error = error;
+                --m_InFlight;
+                m_Done.notify_all();
+            }
+        }
+
+    private:
+        int m_File;
+        std::mutex m_Mutex;
+        std::condition_variable m_WakeUp, m_Done;
+        std::deque<WriteRequest> m_Queue;
+        size_t m_InFlight = 0;
+        int m_Error = 0;
+        bool m_Stop = false;
+        std::thread m_Thread;
+    };
+#endif
+
+#ifdef HAVE_IO_URING
+    // A small io_uring driven through the raw syscalls, so the build needs no liburing.
+    // Requests complete in any order, the writer drains the ring before it overwrites a range.
+    class UringWriteBackend : public AsyncWriteBackend {
+    public:
+        // Nullptr when the kernel has no io_uring or it is disabled (seccomp, io_uring_disabled)
+        static std::unique_ptr<UringWriteBackend> create(int file) {
+            std::unique_ptr<UringWriteBackend> backend(new UringWriteBackend(file));
+            if (!backend->setup()) return nullptr;
+            return backend;
+        }
+
+        ~UringWriteBackend() override {
+            if (m_Ring < 0) return;
+            wait(0);
+            if (m_Sqes) munmap(m_Sqes, m_SqesBytes);
+            if (m_CqRing && m_CqRing != m_SqRing) munmap(m_CqRing, m_CqRingBytes);
+            if (m_SqRing) munmap(m_SqRing, m_SqRingBytes);
+            ::close(m_Ring);
+        }
+
+        void submit(WriteRequest request) override {
+            size_t slot = std::find_if(m_Slots.begin(), m_Slots.end(), [](const WriteRequest &pending) { return !pending.buffer.data(); }) - m_Slots.begin();
+            if (slot == m_Slots.size()) {
+                wait(m_Slots.size() - 1);
+                slot = std::find_if(m_Slots.begin(), m_Slots.end(), [](const WriteRequest &pending) { return !pending.buffer.data(); }) - m_Slots.begin();
+            }
+
+            unsigned tail = *m_SqTail;
+            unsigned index = tail & *m_SqMask;
+            io_uring_sqe* sqe = &m_Sqes[index];
+            std::memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = IORING_OP_WRITE;
+            sqe->fd = m_File;
+            sqe->addr = (uint64_t)(uintptr_t)request.buffer.data();
+            sqe->len = (uint32_t)request.size;
+            sqe->off = request.offset;
+            sqe->user_data = slot;
+            m_SqArray[index] = index;
+            __atomic_store_n(m_SqTail, tail + 1, __ATOMIC_RELEASE);
+
+            m_Slots[slot] = std::move(request);
+            ++m_InFlight;
+            if (enter(1, 0, 0) < 0) {
+                // The kernel did not take it: write this batch now instead
+                __atomic_store_n(m_SqTail, tail, __ATOMIC_RELEASE);
+                complete(slot, -EINVAL);
+            }
+        }
+
+        int wait(size_t inFlight) override {
+            while (m_InFlight > inFlight) {
+                if (!reap() && enter(0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+                    // Ring unusable: everything still pending is lost, report it
+                    if (m_Error == 0) m_Error = AVERROR(errno);
+                    break;
+                }
+            }
+            return m_Error;
+        }
+
+    private:
+        explicit UringWriteBackend(int file) : m_File(file), m_Slots(AsyncFileWriter::MaxInFlight) { }
+
+        bool setup() {
+            io_uring_params params{};
+            m_Ring = (int)syscall(__NR_io_uring_setup, (unsigned)m_Slots.size(), &params);
+            if (m_Ring < 0) return false;
+
+            m_SqRingBytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+            m_CqRingBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+            if (singleMap) m_SqRingBytes = m_CqRingBytes = std::max(m_SqRingBytes, m_CqRingBytes);
+
+            m_SqRing = mmap(nullptr, m_SqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Ring, IORING_OFF_SQ_RING);
+            if (m_SqRing == MAP_FAILED) { m_SqRing = nullptr; return false; }
+            m_CqRing = singleMap ? m_SqRing : mmap(nullptr, m_CqRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Ring, IORING_OFF_CQ_RING);
+            if (m_CqRing == MAP_FAILED) { m_CqRing = nullptr; return false; }
+            m_SqesBytes = params.sq_entries * sizeof(io_uring_sqe);
+            void* sqes = mmap(nullptr, m_SqesBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_Ring, IORING_OFF_SQES);
+            if (sqes == MAP_FAILED) return false;
+            m_Sqes = static_cast<io_uring_sqe*>(sqes);
+
+            uint8_t* sq = static_cast<uint8_t*>(m_SqRing);
+            m_SqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+            m_SqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+            m_SqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+            uint8_t* cq = static_cast<uint8_t*>(m_CqRing);
+            m_CqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+            m_CqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+            m_CqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+            m_Cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+            return true;
+        }
+
+        int enter(unsigned submit, unsigned minComplete, unsigned flags) {
+            return (int)syscall(__NR_io_uring_enter, m_Ring, submit, minComplete, flags, nullptr, 0);
+        }
+
+        // Takes every completion the kernel posted; false when there was none
+        bool reap() {
+            unsigned head = *m_CqHead;
+            unsigned tail = __atomic_load_n(m_CqTail, __ATOMIC_ACQUIRE);
+            if (head == tail) return false;
+            for (; head != tail; ++head) {
+                const io_uring_cqe &cqe = m_Cqes[head & *m_CqMask];
+                complete((size_t)cqe.user_data, cqe.res);
+            }
+            __atomic_store_n(m_CqHead, head, __ATOMIC_RELEASE);
+            return true;
+        }
+
+        // A short write finishes synchronously, as does a batch the kernel refused
+        // (IORING_OP_WRITE needs Linux 5.6)
+        void complete(size_t slot, int result) {
+            WriteRequest &request = m_Slots[slot];
+            int error = 0;
+            if (result == -EINVAL || result == -EOPNOTSUPP) error = writeFully(m_File, request.buffer.data(), request.size, request.offset);
+            else if (result < 0) error = AVERROR(-result);
+            else if ((size_t)result < request.size) error = writeFully(m_File, request.buffer.data() + result, request.size - result, request.offset + result);
+
+            if (error < 0 && m_Error == 0) m_Error = error;
+            request.buffer.reset();
+            --m_InFlight;
+        }
+
+    private:
+        int m_File;
+        int m_Ring = -1;
+        void* m_SqRing = nullptr;
+        void* m_CqRing = nullptr;
+        size_t m_SqRingBytes = 0, m_CqRingBytes = 0, m_SqesBytes = 0;
+        io_uring_sqe* m_Sqes = nullptr;
+        unsigned *m_SqTail = nullptr, *m_SqMask = nullptr, *m_SqArray = nullptr;
+        unsigned *m_CqHead = nullptr, *m_CqTail = nullptr, *m_CqMask = nullptr;
+        io_uring_cqe* m_Cqes = nullptr;
+
+        std::vector<WriteRequest> m_Slots;
+        size_t m_InFlight = 0;
+        int m_Error = 0;
+    };
+#endif
+
+    AsyncFileWriter::AsyncFileWriter() = default;
+
+    AsyncFileWriter::~AsyncFileWriter() {
+        close();
+    }
+
+    int AsyncFileWriter::open(const std::string &path) {
+        close();
+    #ifdef LINUX
+        m_File = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+        if (m_File < 0) return AVERROR(errno);
+
+        uint8_t* buffer = static_cast<uint8_t*>(av_malloc(IOBufferSize));
+        m_Context = buffer ? avio_alloc_context(buffer, IOBufferSize, 1, this, nullptr, &AsyncFileWriter::writePacket, &AsyncFileWriter::seek) : nullptr;
+        if (!m_Context) {
+            av_free(buffer);
+            ::close(m_File);
+            m_File = -1;
+            return AVERROR(ENOMEM);
+        }
+
+        m_BatchSize = 0;
+        m_BatchOffset = 0;
+        m_End = 0;
+        m_Reserved = 0;
+        m_CanReserve = true;
+        m_Error = 0;
+        return 0;
+    #else
+        (void)path;
+        return AVERROR(ENOSYS);
+    #endif
+    }
+
+    int AsyncFileWriter::close() {
+        if (!m_Context) return 0;
+    #ifdef LINUX
+        avio_flush(m_Context);
+        flushBatch(true);
+        if (m_Backend) {
+            int error = m_Backend->wait(0);
+            if (error < 0 && m_Error == 0) m_Error = error;
+            m_Backend.reset();
+        }
+        if (m_Reserved > m_End && ftruncate(m_File, (off_t)m_End) != 0 && m_Error == 0) m_Error = AVERROR(errno);
+        if (::close(m_File) != 0 && m_Error == 0) m_Error = AVERROR(errno);
+        m_File = -1;
+    #endif
+        m_Batch.reset();
+        av_freep(&m_Context->buffer);
+        avio_context_free(&m_Context);
+        return m_Error;
+    }
+
+    int AsyncFileWriter::writePacket(void* opaque, const uint8_t* data, int size) {
+        AsyncFileWriter* writer = static_cast<AsyncFileWriter*>(opaque);
+        if (writer->m_Error < 0) return writer->m_Error;
+
+        for (size_t remaining = (size_t)size; remaining > 0;) {
+            if (!writer->m_Batch.data()) writer->m_Batch = BufferPool::global().acquire(BatchBytes);
+            size_t count = std::min(remaining, BatchBytes - writer->m_BatchSize);
+            std::memcpy(writer->m_Batch.data() + writer->m_BatchSize, data, count);
+            writer->m_BatchSize += count;
+            data += count;
+            remaining -= count;
+            if (writer->m_BatchSize == BatchBytes) writer->flushBatch(false);
+        }
+        return writer->m_Error < 0 ? writer->m_Error : size;
+    }
+
+    int64_t AsyncFileWriter::seek(void* opaque, int64_t offset, int whence) {
+        AsyncFileWriter* writer = static_cast<AsyncFileWriter*>(opaque);
+        uint64_t position = writer->m_BatchOffset + writer->m_BatchSize;
+        uint64_t end = std::max(writer->m_End, position);
+
+        whence &= ~AVSEEK_FORCE;
+        if (whence == AVSEEK_SIZE) return (int64_t)end;
+
+        int64_t base = whence == SEEK_SET ? 0 : whence == SEEK_CUR ? (int64_t)position : whence == SEEK_END ? (int64_t)end : -1;
+        if (base < 0 || base + offset < 0) return AVERROR(EINVAL);
+        uint64_t target = (uint64_t)(base + offset);
+        if (target == position) return (int64_t)target;
+
+        // Muxers seek back to patch headers (MP4 moov sizes, MKV cues). Batches in flight can land
+        // in any order, so they all finish before a write that may overlap one of them.
+        writer->flushBatch(!writer->m_Backend);
+    #ifdef LINUX
+        if (writer->m_Backend) {
+            int error = writer->m_Backend->wait(0);
+            if (error < 0 && writer->m_Error == 0) writer->m_Error = error;
+        }
+    #endif
+        writer->m_BatchOffset = target;
+        return writer->m_Error < 0 ? writer->m_Error : (int64_t)target;
+    }
+
+    void AsyncFileWriter::flushBatch(bool direct) {
+        if (m_BatchSize == 0) return;
+    #ifdef LINUX
+        WriteRequest request;
+        request.buffer = std::move(m_Batch);
+        request.size = m_BatchSize;
+        request.offset = m_BatchOffset;
+        m_BatchOffset += m_BatchSize;
+        m_End = std::max(m_End, m_BatchOffset);
+        m_BatchSize = 0;
+
+        if (direct && !m_Backend) {
+            int error = writeFully(m_File, request.buffer.data(), request.size, request.offset);
+            if (error < 0 && m_Error == 0) m_Error = error;
+            return;
+        }
+
+        reserve(m_End);
+        if (!m_Backend) {
+        #ifdef HAVE_IO_URING
+            m_Backend = UringWriteBackend::create(m_File);
+        #endif
+            if (!m_Backend) m_Backend = std::make_unique<ThreadWriteBackend>(m_File);
+        }
+        // Keeps the muxer at most MaxInFlight batches ahead of the disk
+        int error = m_Backend->wait(MaxInFlight - 1);
+        if (error < 0 && m_Error == 0) m_Error = error;
+        m_Backend->submit(std::move(request));
+    #endif
+    }
+
+    void AsyncFileWriter::reserve(uint64_t end) {
+    #ifdef LINUX
+        if (end <= m_Reserved || !m_CanReserve) return;
+        uint64_t size = std::max({ end, m_Reserved * 2, ReserveBytes });
+        // Extents allocated up front instead of block by block as the batches land; the file is
+        // trimmed back to what was written on close. Filesystems without fallocate just skip it.
+        if (fallocate(m_File, 0, (off_t)m_Reserved, (off_t)(size - m_Reserved)) != 0) {
+            m_CanReserve = false;
+            return;
+        }
+        m_Reserved = size;
+    #else
+        (void)end;
+    #endif
+    }
+
+    int AsyncFileWriter::openFormatIO(AVFormatContext* format, AVIOContext** context, const char* url, int flags, AVDictionary** options) {
+        // Reads, and protocols other than plain files (pipe:1 for stdout), keep FFmpeg's own I/O
+        const char* protocol = avio_find_protocol_name(url);
+        if ((flags & AVIO_FLAG_READ) || !protocol || std::strcmp(protocol, "file") != 0) {
+            return avio_open2(context, url, flags, &format->interrupt_callback, options);
+        }
+        std::string path = url;
+        if (path.rfind("file:", 0) == 0) path.erase(0, 5);
+
+        std::unique_ptr<AsyncFileWriter> writer = std::make_unique<AsyncFileWriter>();
+        int ret = writer->open(path);
+        if (ret == AVERROR(ENOSYS)) return avio_open2(context, url, flags, &format->interrupt_callback, options);
+        if (ret < 0) return ret;
+        *context = writer.release()->context();
+        return 0;
+    }
+
+    int AsyncFileWriter::closeFormatIO(AVFormatContext* format, AVIOContext* context) {
+        if (!context) return 0;
+        if (context->write_packet != &AsyncFileWriter::writePacket) return avio_close(context);
+
+        std::unique_ptr<AsyncFileWriter> writer(static_cast<AsyncFileWriter*>(context->opaque));
+        int ret = writer->close();
+        if (ret < 0 && format->opaque) {
+            int* error = static_cast<int*>(format->opaque);
+            if (*error == 0) *error = ret;
+        }
+        return ret;
+    }
+}
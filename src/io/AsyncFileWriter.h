@@ -0,0 +1,81 @@
+/*
+ * Async File Writer
+ * =================
+ *
+ * Write-only AVIOContext that gathers the muxer's output into large batches and writes
+ * them in the background: through io_uring where the kernel allows it, on a writer
+ * thread otherwise. The file is preallocated ahead of the writes and trimmed to its
+ * final size on close. Outputs that fit in one batch, like most images, skip all of
+ * that and go out in a single pwrite().
+ *
+ * Author: Finoshkin Aleksei
+ * License: MIT
+ */
+
+#ifndef IMG_DEINT_ASYNC_FILE_WRITER_H
+#define IMG_DEINT_ASYNC_FILE_WRITER_H
+
+
+#include <StdAfx.h>
+
+#include "utils/BufferPool.h"
+
+namespace media_proc {
+
+    class AsyncWriteBackend;
+
+    class AsyncFileWriter {
+    public:
+        static constexpr size_t BatchBytes = 1 << 20;
+        // Batches written at once; the muxer waits for the oldest one past that
+        static constexpr size_t MaxInFlight = 4;
+        // Preallocation grows by at least this much, doubling with the file
+        static constexpr uint64_t ReserveBytes = 8 << 20;
+        static constexpr int IOBufferSize = 64 << 10;
+
+        AsyncFileWriter();
+        AsyncFileWriter(const AsyncFileWriter&) = delete;
+        AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+
+        ~AsyncFileWriter();
+
+        // Creates or truncates `path`; returns 0 or an AVERROR code
+        int open(const std::string &path);
+        // Flushes the AVIO buffer and every batch, trims the preallocation and closes the file.
+        // Returns the first write error, if any.
+        int close();
+
+        AVIOContext* context() const { return m_Context; }
+
+        // Hooks for AVFormatContext::io_open and io_close2, so muxers that open their own files
+        // (image2) write through the writer as well. Set the context's opaque to an int* to get
+        // write errors of files closed inside the muxer.
+        static int openFormatIO(AVFormatContext* format, AVIOContext** context, const char* url, int flags, AVDictionary** options);
+        static int closeFormatIO(AVFormatContext* format, AVIOContext* context);
+
+    private:
+        static int writePacket(void* opaque, const uint8_t* data, int size);
+        static int64_t seek(void* opaque, int64_t offset, int whence);
+
+        // Hands the batch to the backend. With `direct` and no backend started yet, as on closing
+        // an output that fit in one batch, it is written right away instead.
+        void flushBatch(bool direct);
+        void reserve(uint64_t end);
+
+    private:
+        int m_File = -1;
+        AVIOContext* m_Context = nullptr;
+        std::unique_ptr<AsyncWriteBackend> m_Backend;
+
+        PooledBuffer m_Batch;
+        size_t m_BatchSize = 0;
+        uint64_t m_BatchOffset = 0;     // File offset of the batch's first byte
+        uint64_t m_End = 0;             // Size of the file once everything is written
+        uint64_t m_Reserved = 0;        // Bytes preallocated so far
+        bool m_CanReserve = true;
+        int m_Error = 0;
+    };
+}
+
+
+#endif //!IMG_DEINT_ASYNC_FILE_WRITER_H
@@ -0,0 +1,105 @@
+#include "MappedInput.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef LINUX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace media_proc {
+
+    bool MappedInput::open(const std::string &path) {
+        close();
+    #ifdef LINUX
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+
+        struct stat info;
+        if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size <= 0) {
+            ::close(fd);
+            return false;
+        }
+
+        size_t size = (size_t)info.st_size;
+        int flags = MAP_PRIVATE | (size <= PopulateBytes ? MAP_POPULATE : 0);
+        void* data = mmap(nullptr, size, PROT_READ, flags, fd, 0);
+        // The mapping keeps the file alive on its own
+        ::close(fd);
+        if (data == MAP_FAILED) return false;
+        if (size > PopulateBytes) madvise(data, size, MADV_SEQUENTIAL);
+
+        if (!createContext(static_cast<const uint8_t*>(data), size)) {
+            munmap(data, size);
+            return false;
+        }
+        m_Mapped = true;
+        return true;
+    #else
+        (void)path;
+        return false;
+    #endif
+    }
+
+    bool MappedInput::openMemory(const uint8_t* data, size_t size) {
+        close();
+        return size > 0 && createContext(data, size);
+    }
+
+    bool MappedInput::createContext(const uint8_t* data, size_t size) {
+        uint8_t* buffer = static_cast<uint8_t*>(av_malloc(IOBufferSize));
+        m_Context = buffer ? avio_alloc_context(buffer, IOBufferSize, 0, this, &MappedInput::readPacket, nullptr, &MappedInput::seek) : nullptr;
+        if (!m_Context) {
+            av_free(buffer);
+            return false;
+        }
+        // Large reads go straight to the caller's buffer, and seeking is free
+        m_Context->direct = 1;
+
+        m_Data = data;
+        m_Size = size;
+        m_Position = 0;
+        return true;
+    }
+
+    void MappedInput::close() {
+        if (m_Context) {
+            av_freep(&m_Context->buffer);
+            avio_context_free(&m_Context);
+        }
+    #ifdef LINUX
+        if (m_Mapped) munmap(const_cast<uint8_t*>(m_Data), m_Size);
+    #endif
+        m_Mapped = false;
+        m_Data = nullptr;
+        m_Size = 0;
+        m_Position = 0;
+    }
+
+    int MappedInput::readPacket(void* opaque, uint8_t* buffer, int size) {
+        MappedInput* input = static_cast<MappedInput*>(opaque);
+        size_t count = std::min((size_t)size, input->m_Size - input->m_Position);
+        if (count == 0) return AVERROR_EOF;
+
+        std::memcpy(buffer, input->m_Data + input->m_Position, count);
+        input->m_Position += count;
+        return (int)count;
+    }
+
+    int64_t MappedInput::seek(void* opaque, int64_t offset, int whence) {
+        MappedInput* input = static_cast<MappedInput*>(opaque);
+        whence &= ~AVSEEK_FORCE;
+        if (whence == AVSEEK_SIZE) return (int64_t)input->m_Size;
+
+        int64_t base = whence == SEEK_SET ? 0 : whence == SEEK_CUR ? (int64_t)input->m_Position : whence == SEEK_END ? (int64_t)input->m_Size : -1;
+        if (base < 0) return AVERROR(EINVAL);
+
+        int64_t position = base + offset;
+        if (position < 0 || position > (int64_t)input->m_Size) return AVERROR(EINVAL);
+        input->m_Position = (size_t)position;
+        return position;
+    }
+}
@@ -0,0 +1,61 @@
+/*
+ * Mapped Input
+ * ============
+ *
+ * Read-only AVIOContext over a memory-mapped file, or over a buffer already in memory.
+ * The demuxer reads straight from the page cache: no read() per buffer refill, and with
+ * direct I/O every packet is copied once from the mapping into its own buffer, with no
+ * AVIO buffer in between.
+ *
+ * Author: Finoshkin Aleksei
+ * License: MIT
+ */
+
+#ifndef IMG_DEINT_MAPPED_INPUT_H
+#define IMG_DEINT_MAPPED_INPUT_H
+
+
+#include <StdAfx.h>
+
+namespace media_proc {
+
+    class MappedInput {
+    public:
+        // Files up to this size are faulted in by mmap() itself, larger ones are read ahead as they stream
+        static constexpr size_t PopulateBytes = 8 << 20;
+        // Buffer for the demuxer's small reads (headers, probing); packets bypass it
+        static constexpr int IOBufferSize = 32 << 10;
+
+        MappedInput() = default;
+        MappedInput(const MappedInput&) = delete;
+        MappedInput& operator=(const MappedInput&) = delete;
+
+        ~MappedInput() { close(); }
+
+        // False when the path can't be mapped (pipes, devices, URLs, empty files, non-Linux),
+        // the caller then lets FFmpeg open it by name
+        bool open(const std::string &path);
+        // Serves a buffer the caller keeps alive until close(), e.g. an input sent over a socket
+        bool openMemory(const uint8_t* data, size_t size);
+        // Unmaps the file or lets go of the buffer; the format context using it must be closed first
+        void close();
+
+        AVIOContext* context() const { return m_Context; }
+
+    private:
+        static int readPacket(void* opaque, uint8_t* buffer, int size);
+        static int64_t seek(void* opaque, int64_t offset, int whence);
+
+        bool createContext(const uint8_t* data, size_t size);
+
+    private:
+        const uint8_t* m_Data = nullptr;
+        size_t m_Size = 0;
+        size_t m_Position = 0;
+        bool m_Mapped = false;
+        AVIOContext* m_Context = nullptr;
+    };
+}
+
+
+#endif //!IMG_DEINT_MAPPED_INPUT_H
@@ -0,0 +1,244 @@
+#include "BlurKernels.h"
+
+#include "utils/BufferPool.h"
+
+#include <cmath>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+namespace media_proc {
+namespace kernels {
+
+    void blurRowScalar(const uint8_t* prev, const uint8_t* curr, const uint8_t* next, uint8_t* dst, int width, int step) {
+        // Simple 3x3 Gaussian kernel
+        static const float kernel[3][3] = {
+            {1.0f/16, 2.0f/16, 1.0f/16},
+            {2.0f/16, 4.0f/16, 2.0f/16},
+            {1.0f/16, 2.0f/16, 1.0f/16}
+        };
+
+        for (int x = step; x < width - step; ++x) {
+            float sum = 0.0f;
+
+            // Apply 3x3 Gaussian kernel
+            for (int ky = -1; ky <= 1; ++ky) {
+                const uint8_t* row = (ky == -1) ? prev : (ky == 0) ? curr : next;
+                for (int kx = -1; kx <= 1; ++kx) {
+                    sum += row[x + kx * step] * kernel[ky + 1][kx + 1];
+                }
+            }
+
+            dst[x] = static_cast<uint8_t>(std::round(sum));
+        }
+    }
+
+    void blurRowFixedScalar(const uint8_t* prev, const uint8_t* curr, const uint8_t* next, uint8_t* dst, int width, int step) {
+        for (int x = step; x < width - step; ++x) {
+            uint32_t sum = prev[x - step] + 2 * prev[x] + prev[x + step]
+                         + 2 * curr[x - step] + 4 * curr[x] + 2 * curr[x + step]
+                         + next[x - step] + 2 * next[x] + next[x + step];
+            dst[x] = static_cast<uint8_t>(sum >> 4);
+        }
+    }
+
+    // pavgb semantics: (a + b + 1) >> 1
+    static inline uint8_t average(uint8_t a, uint8_t b) { return static_cast<uint8_t>((a + b + 1) >> 1); }
+
+    void blurRowApproxScalar(const uint8_t* prev, const uint8_t* curr, const uint8_t* next, uint8_t* dst, int width, int step) {
+        for (int x = step; x < width - step; ++x) {
+            uint8_t above = average(average(prev[x - step], prev[x + step]), prev[x]);
+            uint8_t middle = average(average(curr[x - step], curr[x + step]), curr[x]);
+            uint8_t below = average(average(next[x - step], next[x + step]), next[x]);
+            dst[x] = average(average(above, below), middle);
+        }
+    }
+
+    void sharpenRowScalar(const uint8_t* src, uint8_t* dst, int width, int step, int amount) {
+        for (int x = step; x < width - step; ++x) {
+            int value = src[x] + (((src[x] - dst[x]) * amount + (1 << (SharpenShift - 1))) >> SharpenShift);
+            dst[x] = static_cast<uint8_t>(value < 0 ? 0 : value > 255 ? 255 : value);
+        }
+    }
+
+    const char* precisionName(Precision precision) {
+        switch (precision) {
+            case Precision::Exact: return "exact";
+            case Precision::Fixed: return "fixed";
+            case Precision::Approx: return "approx";
+        }
+        return "unknown";
+    }
+
+    bool parsePrecision(const std::string &name, Precision &precision) {
+        for (Precision candidate : { Precision::Exact, Precision::Fixed, Precision::Approx }) {
+            if (name == precisionName(candidate)) { precision = candidate; return true; }
+        }
+        return false;
+    }
+
+    // Exact rounds s / 16 half up, Fixed floors it. Each byte average rounds up by at most 1/2, so the
+    // approximate result lies in [s / 16, s / 16 + 1.5] and ends up at most one step above the rounded value.
+    int maxPrecisionError(Precision precision) {
+        return precision == Precision::Exact ? 0 : 1;
+    }
+
+    const char* sampleTypeName(SampleType type) {
+        switch (type) {
+            case SampleType::U8: return "8-bit";
+            case SampleType::U16: return "16-bit";
+            case SampleType::Half: return "half";
+            case SampleType::Float: return "float";
+        }
+        return "unknown";
+    }
+
+    int sampleSize(SampleType type) {
+        switch (type) {
+            case SampleType::U8: return 1;
+            case SampleType::U16: return 2;
+            case SampleType::Half: return 2;
+            case SampleType::Float: return 4;
+        }
+        return 1;
+    }
+
+    // binary16 <-> binary32, exact in one direction and round-to-nearest-even in the other like F16C
+    static float halfToFloat(uint16_t half) {
+        uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+        uint32_t exponent = (half >> 10) & 0x1f;
+        uint32_t mantissa = half & 0x3ff;
+
+        uint32_t bits;
+        if (exponent == 0x1f) bits = sign | 0x7f800000 | (mantissa << 13);
+        else if (exponent != 0) bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+        else {
+            float magnitude = mantissa * (1.0f / 16777216.0f); // Subnormal: mantissa * 2^-24, exact in binary32
+            return sign ? -magnitude : magnitude;
+        }
+
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    static uint16_t floatToHalf(float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        uint16_t sign = (bits >> 16) & 0x8000;
+        int exponent = (int)((bits >> 23) & 0xff);
+        uint32_t mantissa = bits & 0x7fffff;
+
+        if (exponent == 0xff) return sign | 0x7c00 | (mantissa ? 0x200 | (mantissa >> 13) : 0);
+
+        int halfExponent = exponent - 127 + 15;
+        if (halfExponent >= 0x1f) return sign | 0x7c00;
+
+        // Drop the low bits of the mantissa and round to nearest, ties to even. A carry out of the
+        // mantissa moves on into the exponent, up to infinity, which is the right encoding.
+        auto round = [](uint32_t kept, uint32_t dropped, uint32_t half) {
+            return kept + (dropped > half || (dropped == half && (kept & 1)) ? 1 : 0);
+        };
+        if (halfExponent > 0) {
+            return sign | (uint16_t)round(((uint32_t)halfExponent << 10) | (mantissa >> 13), mantissa & 0x1fff, 0x1000);
+        }
+        if (halfExponent < -10) return sign;
+
+        mantissa |= 0x800000;
+        int shift = 14 - halfExponent;
+        return sign | (uint16_t)round(mantissa >> shift, mantissa & ((1u << shift) - 1), 1u << (shift - 1));
+    }
+
+    void blurRow16Scalar(const uint16_t* prev, const uint16_t* curr, const uint16_t* next, uint16_t* dst, int width, int step, int shift) {
+        // Samples are multiples of 2^shift and so is their weighted sum: rounding at 4 + shift bits rounds the significant bits
+        uint32_t bias = 8u << shift;
+        for (int x = step; x < width - step; ++x) {
+            uint32_t sum = prev[x - step] + 2 * prev[x] + prev[x + step]
+                         + 2 * curr[x - step] + 4 * curr[x] + 2 * curr[x + step]
+                         + next[x - step] + 2 * next[x] + next[x + step];
+            dst[x] = static_cast<uint16_t>(((sum + bias) >> (4 + shift)) << shift);
+        }
+    }
+
+    void blurRowHalfScalar(const uint16_t* prev, const uint16_t* curr, const uint16_t* next, uint16_t* dst, int width, int step) {
+        // Every sample is read nine times; a 256 KiB table beats decoding it bit by bit each time
+        static const std::vector<float> table = [] {
+            std::vector<float> values(1 << 16);
+            for (size_t half = 0; half < values.size(); ++half) values[half] = halfToFloat((uint16_t)half);
+            return values;
+        }();
+        const float* toFloat = table.data();
+
+        auto horizontal = [step, toFloat](const uint16_t* row, int x) {
+            return (toFloat[row[x - step]] + toFloat[row[x + step]]) + (toFloat[row[x]] + toFloat[row[x]]);
+        };
+        for (int x = step; x < width - step; ++x) {
+            float middle = horizontal(curr, x);
+            dst[x] = floatToHalf(((horizontal(prev, x) + horizontal(next, x)) + (middle + middle)) * 0.0625f);
+        }
+    }
+
+    void blurRowFloatScalar(const float* prev, const float* curr, const float* next, float* dst, int width, int step) {
+        // Same summation order as the vector kernels; the final scale by 1/16 is exact
+        auto horizontal = [step](const float* row, int x) { return (row[x - step] + row[x + step]) + (row[x] + row[x]); };
+        for (int x = step; x < width - step; ++x) {
+            float middle = horizontal(curr, x);
+            dst[x] = ((horizontal(prev, x) + horizontal(next, x)) + (middle + middle)) * 0.0625f;
+        }
+    }
+
+    // Ring of two original rows: the one above the row being written and the row itself
+    template<typename Sample, typename RowFn>
+    static void blurRowsRolling(uint8_t* data, int stride, int width, int startY, int endY,
+                                const uint8_t* topHalo, const uint8_t* bottomHalo, uint8_t* scratch, RowFn blurRow) {
+        if (startY >= endY) return;
+
+        size_t rowBytes = (size_t)width * sizeof(Sample);
+        Sample* prevOriginal = reinterpret_cast<Sample*>(scratch);
+        Sample* currOriginal = reinterpret_cast<Sample*>(scratch + rowBytes);
+        std::memcpy(prevOriginal, topHalo ? topHalo : data + (startY - 1) * stride, rowBytes);
+
+        for (int y = startY; y < endY; ++y) {
+            uint8_t* row = data + y * stride;
+            const uint8_t* next = (y + 1 == endY && bottomHalo) ? bottomHalo : row + stride;
+
+            std::memcpy(currOriginal, row, rowBytes);
+            blurRow(prevOriginal, currOriginal, reinterpret_cast<const Sample*>(next), reinterpret_cast<Sample*>(row));
+            std::swap(prevOriginal, currOriginal);
+        }
+    }
+
+    void blurRowsInPlace(uint8_t* data, int stride, int width, int step, int startY, int endY,
+                         const uint8_t* topHalo, const uint8_t* bottomHalo, uint8_t* scratch, BlurRowFn blurRow) {
+        blurRowsRolling<uint8_t>(data, stride, width, startY, endY, topHalo, bottomHalo, scratch,
+            [=](const uint8_t* prev, const uint8_t* curr, const uint8_t* next, uint8_t* dst) { blurRow(prev, curr, next, dst, width, step); });
+    }
+
+    void blurRowsInPlaceWide(uint8_t* data, int stride, int width, int step, SampleType type, int shift, int startY, int endY,
+                             const uint8_t* topHalo, const uint8_t* bottomHalo, uint8_t* scratch, const WideKernels &kernels) {
+        switch (type) {
+            case SampleType::U8:
+                break; // 8-bit planes go through blurRowsInPlace() with a precision tier
+            case SampleType::U16:
+                blurRowsRolling<uint16_t>(data, stride, width, startY, endY, topHalo, bottomHalo, scratch,
+                    [&](const uint16_t* prev, const uint16_t* curr, const uint16_t* next, uint16_t* dst) { kernels.blurRow16(prev, curr, next, dst, width, step, shift); });
+                break;
+            case SampleType::Half:
+                blurRowsRolling<uint16_t>(data, stride, width, startY, endY, topHalo, bottomHalo, scratch,
+                    [&](const uint16_t* prev, const uint16_t* curr, const uint16_t* next, uint16_t* dst) { kernels.blurRowHalf(prev, curr, next, dst, width, step); });
+                break;
+            case SampleType::Float:
+                blurRowsRolling<float>(data, stride, width, startY, endY, topHalo, bottomHalo, scratch,
+                    [&](const float* prev, const float* curr, const float* next, float* dst) { kernels.blurRowFloat(prev, curr, next, dst, width, step); });
+                break;
+        }
+    }
+
+    void blurPlaneWide(uint8_t* data, int stride, int width, int height, int step, SampleType type, int shift, const WideKernels &kernels) {
+        if (width < 2 * step + 1 || height < 3) return;
+        PooledBuffer scratch = BufferPool::global().acquire(inPlaceScratchSize(width * sampleSize(type)));
+        blurRowsInPlaceWide(data, stride, width, step, type, shift, 1, height - 1, nullptr, nullptr, scratch.data(), kernels);
+    }
+
+}
+}
@@ -0,0 +1,126 @@
+/*
+ * Blur Kernels
+ * ============
+ *
+ * Row-level 3x3 Gaussian kernels shared by the CPU processor nodes, plus the
+ * in-place plane driver that replaces the full-plane temp copy with a small
+ * rolling line buffer. 8-bit samples have three precision tiers; 16-bit,
+ * half and float samples are blurred exactly in their own type.
+ *
+ * Author: Finoshkin Aleksei
+ * License: MIT
+ */
+
+#ifndef IMG_DEINT_BLUR_KERNELS_H
+#define IMG_DEINT_BLUR_KERNELS_H
+
+
+#include <cstdint>
+#include <string>
+
+namespace media_proc {
+namespace kernels {
+
+    // Writes dst[step .. width-step-1] from three source rows, the first and last pixel of every channel
+    // are left untouched. `step` is the distance between horizontally neighbouring samples of one
+    // channel: 1 for planar data, 2 for interleaved NV12 chroma, 3 for RGB24, 4 for RGBA. Vector
+    // kernels load the neighbours at +-step, so every lane only ever meets its own channel.
+    // dst must not alias prev/curr/next.
+    using BlurRowFn = void (*)(const uint8_t* prev, const uint8_t* curr, const uint8_t* next, uint8_t* dst, int width, int step);
+
+    // Accuracy tiers of the 3x3 kernel. Every tier gives the same output on every ISA level; the
+    // error is the largest difference to the exact tier in 8-bit code values (see maxPrecisionError).
+    enum class Precision {
+        Exact,  // Float reference with per-pixel rounding; integer kernels with a rounding bias match it bit for bit
+        Fixed,  // 16-bit fixed point, truncating: at most 1 below Exact
+        Approx  // Two byte averages per direction (pavgb): at most 1 above Exact, no widening at all
+    };
+
+    const char* precisionName(Precision precision);
+    bool parsePrecision(const std::string &name, Precision &precision);
+    int maxPrecisionError(Precision precision);
+
+    // Float kernel with per-pixel rounding, the reference for every other kernel
+    void blurRowScalar(const uint8_t* prev, const uint8_t* curr, const uint8_t* next, uint8_t* dst, int width, int step);
+    void blurRowFixedScalar(const uint8_t* prev, const uint8_t* curr, const uint8_t* next, uint8_t* dst, int width, int step);
+    void blurRowApproxScalar(const uint8_t* prev, const uint8_t* curr, const uint8_t* next, uint8_t* dst, int width, int step);
+
+    // Vector kernels, one per tier and ISA level. They are built with per-file ISA flags; pick one
+    // through CpuDispatch.h, never call them directly.
+    void blurRowExactSSE41(const uint8_t* prev, const uint8_t* curr, const uint8_t* next, uint8_t* dst, int width, int step);  // 16 pixels per iteration
+    void blurRowFixedSSE41(const uint8_t* prev, const uint8_t* curr, const uint8_t* next, uint8_t* dst, int width, int step);
+    void blurRowApproxSSE41(const uint8_t* prev, const uint8_t* curr, const uint8_t* next, uint8_t* dst, int width, int step);
+    void blurRowExactAVX2(const uint8_t* prev, const uint8_t* curr, const uint8_t* next, uint8_t* dst, int width, int step);   // 32 pixels per iteration
+    void blurRowFixedAVX2(const uint8_t* prev, const uint8_t* curr, const uint8_t* next, uint8_t* dst, int width, int step);
+    void blurRowApproxAVX2(const uint8_t* prev, const uint8_t* curr, const uint8_t* next, uint8_t* dst, int width, int step);
+    void blurRowExactAVX512(const uint8_t* prev, const uint8_t* curr, const uint8_t* next, uint8_t* dst, int width, int step); // 64 pixels per iteration, AVX-512BW
+    void blurRowFixedAVX512(const uint8_t* prev, const uint8_t* curr, const uint8_t* next, uint8_t* dst, int width, int step);
+    void blurRowApproxAVX512(const uint8_t* prev, const uint8_t* curr, const uint8_t* next, uint8_t* dst, int width, int step);
+
+    // Unsharp mask over dst[step .. width-step-1], where dst holds a blur of src on entry:
+    // dst[x] = clamp(src[x] + (((src[x] - dst[x]) * amount + half) >> SharpenShift), 0, 255). `amount`
+    // is the strength in 1/256 steps, at most 8 << SharpenShift. dst must not alias src.
+    constexpr int SharpenShift = 8;
+    using SharpenRowFn = void (*)(const uint8_t* src, uint8_t* dst, int width, int step, int amount);
+
+    void sharpenRowScalar(const uint8_t* src, uint8_t* dst, int width, int step, int amount);
+    void sharpenRowSSE41(const uint8_t* src, uint8_t* dst, int width, int step, int amount);  // 16 pixels per iteration
+    void sharpenRowAVX2(const uint8_t* src, uint8_t* dst, int width, int step, int amount);   // 32 pixels per iteration
+    void sharpenRowAVX512(const uint8_t* src, uint8_t* dst, int width, int step, int amount); // 64 pixels per iteration
+
+    // Sample types of a plane, picked from the AVPixFmtDescriptor depth and flags
+    enum class SampleType {
+        U8,    // 8-bit unsigned, the BlurRowFn kernels above
+        U16,   // 9 to 16-bit unsigned little-endian, possibly shifted up (P010)
+        Half,  // IEEE 754 binary16
+        Float  // IEEE 754 binary32
+    };
+
+    const char* sampleTypeName(SampleType type);
+    int sampleSize(SampleType type);
+
+    // Exact kernels for samples wider than 8 bits, as BlurRowFn with width and step counted in samples.
+    // Formats such as P010 keep the value in the high bits: `shift` drops the unused low bits and keeps
+    // them zero. Half and float sum in binary32 in a fixed order, so every ISA level gives the same bits.
+    using BlurRow16Fn = void (*)(const uint16_t* prev, const uint16_t* curr, const uint16_t* next, uint16_t* dst, int width, int step, int shift);
+    using BlurRowHalfFn = void (*)(const uint16_t* prev, const uint16_t* curr, const uint16_t* next, uint16_t* dst, int width, int step);
+    using BlurRowFloatFn = void (*)(const float* prev, const float* curr, const float* next, float* dst, int width, int step);
+
+    void blurRow16Scalar(const uint16_t* prev, const uint16_t* curr, const uint16_t* next, uint16_t* dst, int width, int step, int shift);
+    void blurRowHalfScalar(const uint16_t* prev, const uint16_t* curr, const uint16_t* next, uint16_t* dst, int width, int step);
+    void blurRowFloatScalar(const float* prev, const float* curr, const float* next, float* dst, int width, int step);
+    void blurRow16AVX2(const uint16_t* prev, const uint16_t* curr, const uint16_t* next, uint16_t* dst, int width, int step, int shift); // 16 samples per iteration
+    void blurRowHalfAVX2(const uint16_t* prev, const uint16_t* curr, const uint16_t* next, uint16_t* dst, int width, int step);          // 8 samples per iteration, F16C
+    void blurRowFloatAVX2(const float* prev, const float* curr, const float* next, float* dst, int width, int step);                      // 8 samples per iteration
+
+    // One kernel per wide sample type, part of every CpuDispatch kernel set
+    struct WideKernels {
+        BlurRow16Fn blurRow16;
+        BlurRowHalfFn blurRowHalf;
+        BlurRowFloatFn blurRowFloat;
+    };
+
+    // Scratch bytes blurRowsInPlace() needs for a row of the given width
+    inline int inPlaceScratchSize(int width) { return 2 * width; }
+
+    // Blurs rows [startY, endY) of a plane in place, 1 <= startY <= endY <= height - 1.
+    // Only two rows of original pixels are kept in `scratch` (see inPlaceScratchSize), so the
+    // extra memory is O(width) and no copy-back pass is needed. topHalo/bottomHalo hold the
+    // original rows startY-1 and endY; pass nullptr to read them from the plane when no other
+    // strip writes them concurrently.
+    void blurRowsInPlace(uint8_t* data, int stride, int width, int step, int startY, int endY,
+                         const uint8_t* topHalo, const uint8_t* bottomHalo, uint8_t* scratch, BlurRowFn blurRow);
+
+    // Same for samples wider than 8 bits: `width` counts samples, `stride` bytes. The scratch needs
+    // inPlaceScratchSize(width * sampleSize(type)) bytes and the halos are rows of `type` samples.
+    void blurRowsInPlaceWide(uint8_t* data, int stride, int width, int step, SampleType type, int shift, int startY, int endY,
+                             const uint8_t* topHalo, const uint8_t* bottomHalo, uint8_t* scratch, const WideKernels &kernels);
+
+    // Blurs rows [1, height-1) of a whole wide plane in place on the calling thread
+    void blurPlaneWide(uint8_t* data, int stride, int width, int height, int step, SampleType type, int shift, const WideKernels &kernels);
+
+}
+}
+
+
+#endif //!IMG_DEINT_BLUR_KERNELS_H
@@ -0,0 +1,241 @@
+// Built with -mavx2 -mf16c (see premake5.lua). Only call these through the dispatcher after checking the CPU,
+// and keep inline and template code from shared headers out of this file: the linker may pick the
+// AVX2 copy for the whole program.
+
+#include "BlurKernels.h"
+#include "GaussianBlur.h"
+
+#include <immintrin.h> // AVX2
+
+namespace media_proc {
+namespace kernels {
+
+    namespace {
+
+        // pavgb semantics: (a + b + 1) >> 1
+        inline uint8_t average(uint8_t a, uint8_t b) { return (uint8_t)((a + b + 1) >> 1); }
+
+        // Weights [1 2 1; 2 4 2; 1 2 1] * 16, so the sum of a 3x3 block fits 16 bits and >> 8 divides by 256.
+        // Rounded adds half before the shift and matches the float reference exactly; otherwise it truncates.
+        template<bool Rounded>
+        void blurRowFixedPoint(const uint8_t* prev, const uint8_t* curr, const uint8_t* next, uint8_t* dst, int width, int step) {
+            constexpr int SIMD_WIDTH = 32; // AVX2 processes 32 uint8_t per vector
+
+            static const uint16_t kernelWeights[9] = {16, 32, 16, 32, 64, 32, 16, 32, 16};
+            const __m256i bias = _mm256_set1_epi16(Rounded ? 128 : 0);
+
+            int x = step; // Skip the left border pixel of every channel
+
+            // SIMD processing for bulk of the row
+            for (; x <= width - SIMD_WIDTH - step; x += SIMD_WIDTH) {
+                __m256i sum_lo = bias;
+                __m256i sum_hi = bias;
+
+                // Process 3x3 kernel
+                for (int ky = -1; ky <= 1; ++ky) {
+                    const uint8_t* row = (ky == -1) ? prev : (ky == 0) ? curr : next;
+
+                    for (int kx = -1; kx <= 1; ++kx) {
+                        __m256i weight_vec = _mm256_set1_epi16(kernelWeights[(ky + 1) * 3 + (kx + 1)]);
+
+                        // Load 32 pixels and widen to 16-bit for multiplication
+                        __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + x + kx * step));
+                        __m256i pixels_lo = _mm256_unpacklo_epi8(pixels, _mm256_setzero_si256());
+                        __m256i pixels_hi = _mm256_unpackhi_epi8(pixels, _mm256_setzero_si256());
+
+                        sum_lo = _mm256_add_epi16(sum_lo, _mm256_mullo_epi16(pixels_lo, weight_vec));
+                        sum_hi = _mm256_add_epi16(sum_hi, _mm256_mullo_epi16(pixels_hi, weight_vec));
+                    }
+                }
+
+                // Divide by 256 (shift right by 8) and pack back to uint8_t
+                sum_lo = _mm256_srli_epi16(sum_lo, 8);
+                sum_hi = _mm256_srli_epi16(sum_hi, 8);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), _mm256_packus_epi16(sum_lo, sum_hi));
+            }
+
+            // Fallback for remaining pixels
+            for (; x < width - step; ++x) {
+                uint32_t sum = Rounded ? 128 : 0;
+                for (int ky = -1; ky <= 1; ++ky) {
+                    const uint8_t* row = (ky == -1) ? prev : (ky == 0) ? curr : next;
+                    for (int kx = -1; kx <= 1; ++kx) {
+                        sum += row[x + kx * step] * kernelWeights[(ky + 1) * 3 + (kx + 1)];
+                    }
+                }
+                dst[x] = static_cast<uint8_t>(sum >> 8); // Divide by 256
+            }
+        }
+    }
+
+    void blurRowExactAVX2(const uint8_t* prev, const uint8_t* curr, const uint8_t* next, uint8_t* dst, int width, int step) {
+        blurRowFixedPoint<true>(prev, curr, next, dst, width, step);
+    }
+
+    void blurRowFixedAVX2(const uint8_t* prev, const uint8_t* curr, const uint8_t* next, uint8_t* dst, int width, int step) {
+        blurRowFixedPoint<false>(prev, curr, next, dst, width, step);
+    }
+
+    void blurRowApproxAVX2(const uint8_t* prev, const uint8_t* curr, const uint8_t* next, uint8_t* dst, int width, int step) {
+        constexpr int SIMD_WIDTH = 32;
+
+        // [1 2 1] / 4 as two byte averages, first along each row, then across the three rows
+        auto horizontal = [step](const uint8_t* row) {
+            __m256i left = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row - step));
+            __m256i centre = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row));
+            __m256i right = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + step));
+            return _mm256_avg_epu8(_mm256_avg_epu8(left, right), centre);
+        };
+
+        int x = step;
+        for (; x <= width - SIMD_WIDTH - step; x += SIMD_WIDTH) {
+            __m256i above = horizontal(prev + x);
+            __m256i middle = horizontal(curr + x);
+            __m256i below = horizontal(next + x);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), _mm256_avg_epu8(_mm256_avg_epu8(above, below), middle));
+        }
+
+        for (; x < width - step; ++x) {
+            uint8_t above = average(average(prev[x - step], prev[x + step]), prev[x]);
+            uint8_t middle = average(average(curr[x - step], curr[x + step]), curr[x]);
+            uint8_t below = average(average(next[x - step], next[x + step]), next[x]);
+            dst[x] = average(average(above, below), middle);
+        }
+    }
+
+    void blurRow16AVX2(const uint16_t* prev, const uint16_t* curr, const uint16_t* next, uint16_t* dst, int width, int step, int shift) {
+        constexpr int SIMD_WIDTH = 16; // Two halves of 8 samples widened to 32-bit
+
+        // [1 2 1] of 8 samples, widened to 32 bits: a 3x3 sum of 16-bit samples needs 20 bits
+        auto horizontal = [step](const uint16_t* row) {
+            __m256i left = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row - step)));
+            __m256i centre = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row)));
+            __m256i right = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + step)));
+            return _mm256_add_epi32(_mm256_add_epi32(left, right), _mm256_slli_epi32(centre, 1));
+        };
+        const __m256i bias = _mm256_set1_epi32(8 << shift);
+        const __m128i down = _mm_cvtsi32_si128(4 + shift);
+        const __m128i up = _mm_cvtsi32_si128(shift);
+        auto blur = [&](int x) {
+            __m256i sum = _mm256_add_epi32(_mm256_add_epi32(horizontal(prev + x), horizontal(next + x)), _mm256_slli_epi32(horizontal(curr + x), 1));
+            return _mm256_sll_epi32(_mm256_srl_epi32(_mm256_add_epi32(sum, bias), down), up);
+        };
+
+        int x = step;
+        for (; x <= width - SIMD_WIDTH - step; x += SIMD_WIDTH) {
+            // packus works within 128-bit lanes; the permute puts the two halves back in order
+            __m256i packed = _mm256_packus_epi32(blur(x), blur(x + 8));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), _mm256_permute4x64_epi64(packed, 0xD8));
+        }
+
+        // The scalar kernel finishes the row from x on: shift the window so its first output is dst[x]
+        if (x < width - step) blurRow16Scalar(prev + x - step, curr + x - step, next + x - step, dst + x - step, width - x + step, step, shift);
+    }
+
+    void blurRowHalfAVX2(const uint16_t* prev, const uint16_t* curr, const uint16_t* next, uint16_t* dst, int width, int step) {
+        constexpr int SIMD_WIDTH = 8; // 8 halves convert to one register of floats
+
+        auto load = [](const uint16_t* src) { return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src))); };
+        auto horizontal = [&](const uint16_t* row) {
+            __m256 centre = load(row);
+            return _mm256_add_ps(_mm256_add_ps(load(row - step), load(row + step)), _mm256_add_ps(centre, centre));
+        };
+        const __m256 scale = _mm256_set1_ps(0.0625f);
+
+        int x = step;
+        for (; x <= width - SIMD_WIDTH - step; x += SIMD_WIDTH) {
+            __m256 middle = horizontal(curr + x);
+            __m256 sum = _mm256_add_ps(_mm256_add_ps(horizontal(prev + x), horizontal(next + x)), _mm256_add_ps(middle, middle));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm256_cvtps_ph(_mm256_mul_ps(sum, scale), _MM_FROUND_TO_NEAREST_INT));
+        }
+
+        if (x < width - step) blurRowHalfScalar(prev + x - step, curr + x - step, next + x - step, dst + x - step, width - x + step, step);
+    }
+
+    void blurRowFloatAVX2(const float* prev, const float* curr, const float* next, float* dst, int width, int step) {
+        constexpr int SIMD_WIDTH = 8;
+
+        auto horizontal = [step](const float* row) {
+            __m256 centre = _mm256_loadu_ps(row);
+            return _mm256_add_ps(_mm256_add_ps(_mm256_loadu_ps(row - step), _mm256_loadu_ps(row + step)), _mm256_add_ps(centre, centre));
+        };
+        const __m256 scale = _mm256_set1_ps(0.0625f);
+
+        int x = step;
+        for (; x <= width - SIMD_WIDTH - step; x += SIMD_WIDTH) {
+            __m256 middle = horizontal(curr + x);
+            __m256 sum = _mm256_add_ps(_mm256_add_ps(horizontal(prev + x), horizontal(next + x)), _mm256_add_ps(middle, middle));
+            _mm256_storeu_ps(dst + x, _mm256_mul_ps(sum, scale));
+        }
+
+        if (x < width - step) blurRowFloatScalar(prev + x - step, curr + x - step, next + x - step, dst + x - step, width - x + step, step);
+    }
+
+    void sharpenRowAVX2(const uint8_t* src, uint8_t* dst, int width, int step, int amount) {
+        constexpr int SIMD_WIDTH = 32;
+
+        // madd of (diff, 1) pairs against (amount, half) gives diff * amount + half in 32 bits
+        const __m256i weights = _mm256_set1_epi32((int)((uint16_t)amount | (1u << (SharpenShift - 1)) << 16));
+        const __m256i one = _mm256_set1_epi16(1);
+        auto scale = [&](__m256i diff) {
+            __m256i lo = _mm256_srai_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(diff, one), weights), SharpenShift);
+            __m256i hi = _mm256_srai_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(diff, one), weights), SharpenShift);
+            return _mm256_packs_epi32(lo, hi);
+        };
+
+        // Unpacking and packing both work per 128-bit lane, so the pixels come back in order
+        int x = step;
+        for (; x <= width - SIMD_WIDTH - step; x += SIMD_WIDTH) {
+            __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + x));
+            __m256i blurred = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dst + x));
+            __m256i src_lo = _mm256_unpacklo_epi8(pixels, _mm256_setzero_si256());
+            __m256i src_hi = _mm256_unpackhi_epi8(pixels, _mm256_setzero_si256());
+            __m256i diff_lo = _mm256_sub_epi16(src_lo, _mm256_unpacklo_epi8(blurred, _mm256_setzero_si256()));
+            __m256i diff_hi = _mm256_sub_epi16(src_hi, _mm256_unpackhi_epi8(blurred, _mm256_setzero_si256()));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), _mm256_packus_epi16(_mm256_add_epi16(src_lo, scale(diff_lo)), _mm256_add_epi16(src_hi, scale(diff_hi))));
+        }
+
+        if (x < width - step) sharpenRowScalar(src + x - step, dst + x - step, width - x + step, step, amount);
+    }
+
+    void gaussianTapsAVX2(const uint8_t* const* rows, const int16_t* weights, int taps, uint8_t* dst, int width) {
+        constexpr int SIMD_WIDTH = 16; // 16 pixels widened to 16-bit fill one AVX2 register
+
+        const __m256i rounding = _mm256_set1_epi32(1 << (GaussianKernel::Shift - 1));
+        int x = 0;
+
+        for (; x + SIMD_WIDTH <= width; x += SIMD_WIDTH) {
+            __m256i sum_lo = rounding;
+            __m256i sum_hi = rounding;
+
+            // Two taps per madd: interleave their pixels and multiply by the (w[k], w[k + 1]) pair
+            for (int k = 0; k < taps; k += 2) {
+                bool paired = k + 1 < taps;
+                __m256i a = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k] + x)));
+                __m256i b = paired ? _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rows[k + 1] + x)))
+                                   : _mm256_setzero_si256();
+                uint32_t pair = (uint16_t)weights[k] | ((uint32_t)(paired ? (uint16_t)weights[k + 1] : 0) << 16);
+                __m256i weight_vec = _mm256_set1_epi32((int)pair);
+
+                sum_lo = _mm256_add_epi32(sum_lo, _mm256_madd_epi16(_mm256_unpacklo_epi16(a, b), weight_vec));
+                sum_hi = _mm256_add_epi32(sum_hi, _mm256_madd_epi16(_mm256_unpackhi_epi16(a, b), weight_vec));
+            }
+
+            // The unpacks split every 128-bit lane in halves; packing the halves back restores pixel order
+            sum_lo = _mm256_srai_epi32(sum_lo, GaussianKernel::Shift);
+            sum_hi = _mm256_srai_epi32(sum_hi, GaussianKernel::Shift);
+            __m256i words = _mm256_packus_epi32(sum_lo, sum_hi);
+            __m256i bytes = _mm256_permute4x64_epi64(_mm256_packus_epi16(words, words), 0x08);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm256_castsi256_si128(bytes));
+        }
+
+        // Fallback for remaining pixels
+        for (; x < width; ++x) {
+            int32_t sum = 1 << (GaussianKernel::Shift - 1);
+            for (int k = 0; k < taps; ++k) sum += weights[k] * rows[k][x];
+            dst[x] = static_cast<uint8_t>(sum >> GaussianKernel::Shift);
+        }
+    }
+
+}
+}
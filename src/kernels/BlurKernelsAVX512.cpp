@@ -0,0 +1,172 @@
+// Built with -mavx512f -mavx512bw (see premake5.lua). Only call these through the dispatcher after checking
+// the CPU, and keep inline and template code from shared headers out of this file: the linker may pick the
+// AVX-512 copy for the whole program.
+
+#include "BlurKernels.h"
+#include "GaussianBlur.h"
+
+#include <immintrin.h> // AVX-512F/BW
+
+namespace media_proc {
+namespace kernels {
+
+    namespace {
+
+        // pavgb semantics: (a + b + 1) >> 1
+        inline uint8_t average(uint8_t a, uint8_t b) { return (uint8_t)((a + b + 1) >> 1); }
+
+        // Weights [1 2 1; 2 4 2; 1 2 1] * 16, so the sum of a 3x3 block fits 16 bits and >> 8 divides by 256.
+        // Rounded adds half before the shift and matches the float reference exactly; otherwise it truncates.
+        template<bool Rounded>
+        void blurRowFixedPoint(const uint8_t* prev, const uint8_t* curr, const uint8_t* next, uint8_t* dst, int width, int step) {
+            constexpr int SIMD_WIDTH = 64; // AVX-512 processes 64 uint8_t per vector
+
+            static const uint16_t kernelWeights[9] = {16, 32, 16, 32, 64, 32, 16, 32, 16};
+            const __m512i bias = _mm512_set1_epi16(Rounded ? 128 : 0);
+
+            int x = step; // Skip the left border pixel of every channel
+
+            // SIMD processing for bulk of the row
+            for (; x <= width - SIMD_WIDTH - step; x += SIMD_WIDTH) {
+                __m512i sum_lo = bias;
+                __m512i sum_hi = bias;
+
+                // Process 3x3 kernel
+                for (int ky = -1; ky <= 1; ++ky) {
+                    const uint8_t* row = (ky == -1) ? prev : (ky == 0) ? curr : next;
+
+                    for (int kx = -1; kx <= 1; ++kx) {
+                        __m512i weight_vec = _mm512_set1_epi16(kernelWeights[(ky + 1) * 3 + (kx + 1)]);
+
+                        // Load 64 pixels and widen to 16-bit within each 128-bit lane
+                        __m512i pixels = _mm512_loadu_si512(row + x + kx * step);
+                        __m512i pixels_lo = _mm512_unpacklo_epi8(pixels, _mm512_setzero_si512());
+                        __m512i pixels_hi = _mm512_unpackhi_epi8(pixels, _mm512_setzero_si512());
+
+                        sum_lo = _mm512_add_epi16(sum_lo, _mm512_mullo_epi16(pixels_lo, weight_vec));
+                        sum_hi = _mm512_add_epi16(sum_hi, _mm512_mullo_epi16(pixels_hi, weight_vec));
+                    }
+                }
+
+                // Divide by 256 (shift right by 8) and pack back to uint8_t
+                sum_lo = _mm512_srli_epi16(sum_lo, 8);
+                sum_hi = _mm512_srli_epi16(sum_hi, 8);
+                _mm512_storeu_si512(dst + x, _mm512_packus_epi16(sum_lo, sum_hi));
+            }
+
+            // Fallback for remaining pixels
+            for (; x < width - step; ++x) {
+                uint32_t sum = Rounded ? 128 : 0;
+                for (int ky = -1; ky <= 1; ++ky) {
+                    const uint8_t* row = (ky == -1) ? prev : (ky == 0) ? curr : next;
+                    for (int kx = -1; kx <= 1; ++kx) {
+                        sum += row[x + kx * step] * kernelWeights[(ky + 1) * 3 + (kx + 1)];
+                    }
+                }
+                dst[x] = static_cast<uint8_t>(sum >> 8); // Divide by 256
+            }
+        }
+    }
+
+    void blurRowExactAVX512(const uint8_t* prev, const uint8_t* curr, const uint8_t* next, uint8_t* dst, int width, int step) {
+        blurRowFixedPoint<true>(prev, curr, next, dst, width, step);
+    }
+
+    void blurRowFixedAVX512(const uint8_t* prev, const uint8_t* curr, const uint8_t* next, uint8_t* dst, int width, int step) {
+        blurRowFixedPoint<false>(prev, curr, next, dst, width, step);
+    }
+
+    void blurRowApproxAVX512(const uint8_t* prev, const uint8_t* curr, const uint8_t* next, uint8_t* dst, int width, int step) {
+        constexpr int SIMD_WIDTH = 64;
+
+        // [1 2 1] / 4 as two byte averages, first along each row, then across the three rows
+        auto horizontal = [step](const uint8_t* row) {
+            __m512i left = _mm512_loadu_si512(row - step);
+            __m512i centre = _mm512_loadu_si512(row);
+            __m512i right = _mm512_loadu_si512(row + step);
+            return _mm512_avg_epu8(_mm512_avg_epu8(left, right), centre);
+        };
+
+        int x = step;
+        for (; x <= width - SIMD_WIDTH - step; x += SIMD_WIDTH) {
+            __m512i above = horizontal(prev + x);
+            __m512i middle = horizontal(curr + x);
+            __m512i below = horizontal(next + x);
+            _mm512_storeu_si512(dst + x, _mm512_avg_epu8(_mm512_avg_epu8(above, below), middle));
+        }
+
+        for (; x < width - step; ++x) {
+            uint8_t above = average(average(prev[x - step], prev[x + step]), prev[x]);
+            uint8_t middle = average(average(curr[x - step], curr[x + step]), curr[x]);
+            uint8_t below = average(average(next[x - step], next[x + step]), next[x]);
+            dst[x] = average(average(above, below), middle);
+        }
+    }
+
+    void sharpenRowAVX512(const uint8_t* src, uint8_t* dst, int width, int step, int amount) {
+        constexpr int SIMD_WIDTH = 64;
+
+        // madd of (diff, 1) pairs against (amount, half) gives diff * amount + half in 32 bits
+        const __m512i weights = _mm512_set1_epi32((int)((uint16_t)amount | (1u << (SharpenShift - 1)) << 16));
+        const __m512i one = _mm512_set1_epi16(1);
+        auto scale = [&](__m512i diff) {
+            __m512i lo = _mm512_srai_epi32(_mm512_madd_epi16(_mm512_unpacklo_epi16(diff, one), weights), SharpenShift);
+            __m512i hi = _mm512_srai_epi32(_mm512_madd_epi16(_mm512_unpackhi_epi16(diff, one), weights), SharpenShift);
+            return _mm512_packs_epi32(lo, hi);
+        };
+
+        // Unpacking and packing both work per 128-bit lane, so the pixels come back in order
+        int x = step;
+        for (; x <= width - SIMD_WIDTH - step; x += SIMD_WIDTH) {
+            __m512i pixels = _mm512_loadu_si512(src + x);
+            __m512i blurred = _mm512_loadu_si512(dst + x);
+            __m512i src_lo = _mm512_unpacklo_epi8(pixels, _mm512_setzero_si512());
+            __m512i src_hi = _mm512_unpackhi_epi8(pixels, _mm512_setzero_si512());
+            __m512i diff_lo = _mm512_sub_epi16(src_lo, _mm512_unpacklo_epi8(blurred, _mm512_setzero_si512()));
+            __m512i diff_hi = _mm512_sub_epi16(src_hi, _mm512_unpackhi_epi8(blurred, _mm512_setzero_si512()));
+            _mm512_storeu_si512(dst + x, _mm512_packus_epi16(_mm512_add_epi16(src_lo, scale(diff_lo)), _mm512_add_epi16(src_hi, scale(diff_hi))));
+        }
+
+        if (x < width - step) sharpenRowScalar(src + x - step, dst + x - step, width - x + step, step, amount);
+    }
+
+    void gaussianTapsAVX512(const uint8_t* const* rows, const int16_t* weights, int taps, uint8_t* dst, int width) {
+        constexpr int SIMD_WIDTH = 32; // 32 pixels widened to 16-bit fill one AVX-512 register
+
+        const __m512i rounding = _mm512_set1_epi32(1 << (GaussianKernel::Shift - 1));
+        int x = 0;
+
+        for (; x + SIMD_WIDTH <= width; x += SIMD_WIDTH) {
+            __m512i sum_lo = rounding;
+            __m512i sum_hi = rounding;
+
+            // Two taps per madd: interleave their pixels and multiply by the (w[k], w[k + 1]) pair
+            for (int k = 0; k < taps; k += 2) {
+                bool paired = k + 1 < taps;
+                __m512i a = _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[k] + x)));
+                __m512i b = paired ? _mm512_cvtepu8_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows[k + 1] + x)))
+                                   : _mm512_setzero_si512();
+                uint32_t pair = (uint16_t)weights[k] | ((uint32_t)(paired ? (uint16_t)weights[k + 1] : 0) << 16);
+                __m512i weight_vec = _mm512_set1_epi32((int)pair);
+
+                sum_lo = _mm512_add_epi32(sum_lo, _mm512_madd_epi16(_mm512_unpacklo_epi16(a, b), weight_vec));
+                sum_hi = _mm512_add_epi32(sum_hi, _mm512_madd_epi16(_mm512_unpackhi_epi16(a, b), weight_vec));
+            }
+
+            // Packing per lane restores pixel order; the results fit in a byte, so narrowing truncates nothing
+            sum_lo = _mm512_srai_epi32(sum_lo, GaussianKernel::Shift);
+            sum_hi = _mm512_srai_epi32(sum_hi, GaussianKernel::Shift);
+            __m512i words = _mm512_packus_epi32(sum_lo, sum_hi);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), _mm512_cvtepi16_epi8(words));
+        }
+
+        // Fallback for remaining pixels
+        for (; x < width; ++x) {
+            int32_t sum = 1 << (GaussianKernel::Shift - 1);
+            for (int k = 0; k < taps; ++k) sum += weights[k] * rows[k][x];
+            dst[x] = static_cast<uint8_t>(sum >> GaussianKernel::Shift);
+        }
+    }
+
+}
+}
@@ -0,0 +1,171 @@
+// Built with -msse4.1 (see premake5.lua). Only call these through the dispatcher after checking the CPU,
+// and keep inline and template code from shared headers out of this file: the linker may pick the
+// SSE4.1 copy for the whole program.
+
+#include "BlurKernels.h"
+#include "GaussianBlur.h"
+
+#include <smmintrin.h> // SSE4.1
+
+namespace media_proc {
+namespace kernels {
+
+    namespace {
+
+        // pavgb semantics: (a + b + 1) >> 1
+        inline uint8_t average(uint8_t a, uint8_t b) { return (uint8_t)((a + b + 1) >> 1); }
+
+        // Weights [1 2 1; 2 4 2; 1 2 1] * 16, so the sum of a 3x3 block fits 16 bits and >> 8 divides by 256.
+        // Rounded adds half before the shift and matches the float reference exactly; otherwise it truncates.
+        template<bool Rounded>
+        void blurRowFixedPoint(const uint8_t* prev, const uint8_t* curr, const uint8_t* next, uint8_t* dst, int width, int step) {
+            constexpr int SIMD_WIDTH = 16; // SSE processes 16 uint8_t per vector
+
+            static const uint16_t kernelWeights[9] = {16, 32, 16, 32, 64, 32, 16, 32, 16};
+            const __m128i bias = _mm_set1_epi16(Rounded ? 128 : 0);
+
+            int x = step; // Skip the left border pixel of every channel
+
+            // SIMD processing for bulk of the row
+            for (; x <= width - SIMD_WIDTH - step; x += SIMD_WIDTH) {
+                __m128i sum_lo = bias;
+                __m128i sum_hi = bias;
+
+                // Process 3x3 kernel
+                for (int ky = -1; ky <= 1; ++ky) {
+                    const uint8_t* row = (ky == -1) ? prev : (ky == 0) ? curr : next;
+
+                    for (int kx = -1; kx <= 1; ++kx) {
+                        __m128i weight_vec = _mm_set1_epi16(kernelWeights[(ky + 1) * 3 + (kx + 1)]);
+
+                        // Load 16 pixels and widen to 16-bit for multiplication
+                        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x + kx * step));
+                        __m128i pixels_lo = _mm_unpacklo_epi8(pixels, _mm_setzero_si128());
+                        __m128i pixels_hi = _mm_unpackhi_epi8(pixels, _mm_setzero_si128());
+
+                        sum_lo = _mm_add_epi16(sum_lo, _mm_mullo_epi16(pixels_lo, weight_vec));
+                        sum_hi = _mm_add_epi16(sum_hi, _mm_mullo_epi16(pixels_hi, weight_vec));
+                    }
+                }
+
+                // Divide by 256 (shift right by 8) and pack back to uint8_t
+                sum_lo = _mm_srli_epi16(sum_lo, 8);
+                sum_hi = _mm_srli_epi16(sum_hi, 8);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_packus_epi16(sum_lo, sum_hi));
+            }
+
+            // Fallback for remaining pixels
+            for (; x < width - step; ++x) {
+                uint32_t sum = Rounded ? 128 : 0;
+                for (int ky = -1; ky <= 1; ++ky) {
+                    const uint8_t* row = (ky == -1) ? prev : (ky == 0) ? curr : next;
+                    for (int kx = -1; kx <= 1; ++kx) {
+                        sum += row[x + kx * step] * kernelWeights[(ky + 1) * 3 + (kx + 1)];
+                    }
+                }
+                dst[x] = static_cast<uint8_t>(sum >> 8); // Divide by 256
+            }
+        }
+    }
+
+    void blurRowExactSSE41(const uint8_t* prev, const uint8_t* curr, const uint8_t* next, uint8_t* dst, int width, int step) {
+        blurRowFixedPoint<true>(prev, curr, next, dst, width, step);
+    }
+
+    void blurRowFixedSSE41(const uint8_t* prev, const uint8_t* curr, const uint8_t* next, uint8_t* dst, int width, int step) {
+        blurRowFixedPoint<false>(prev, curr, next, dst, width, step);
+    }
+
+    void blurRowApproxSSE41(const uint8_t* prev, const uint8_t* curr, const uint8_t* next, uint8_t* dst, int width, int step) {
+        constexpr int SIMD_WIDTH = 16;
+
+        // [1 2 1] / 4 as two byte averages, first along each row, then across the three rows
+        auto horizontal = [step](const uint8_t* row) {
+            __m128i left = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row - step));
+            __m128i centre = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row));
+            __m128i right = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + step));
+            return _mm_avg_epu8(_mm_avg_epu8(left, right), centre);
+        };
+
+        int x = step;
+        for (; x <= width - SIMD_WIDTH - step; x += SIMD_WIDTH) {
+            __m128i above = horizontal(prev + x);
+            __m128i middle = horizontal(curr + x);
+            __m128i below = horizontal(next + x);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_avg_epu8(_mm_avg_epu8(above, below), middle));
+        }
+
+        for (; x < width - step; ++x) {
+            uint8_t above = average(average(prev[x - step], prev[x + step]), prev[x]);
+            uint8_t middle = average(average(curr[x - step], curr[x + step]), curr[x]);
+            uint8_t below = average(average(next[x - step], next[x + step]), next[x]);
+            dst[x] = average(average(above, below), middle);
+        }
+    }
+
+    void sharpenRowSSE41(const uint8_t* src, uint8_t* dst, int width, int step, int amount) {
+        constexpr int SIMD_WIDTH = 16;
+
+        // madd of (diff, 1) pairs against (amount, half) gives diff * amount + half in 32 bits
+        const __m128i weights = _mm_set1_epi32((int)((uint16_t)amount | (1u << (SharpenShift - 1)) << 16));
+        const __m128i one = _mm_set1_epi16(1);
+        auto scale = [&](__m128i diff) {
+            __m128i lo = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(diff, one), weights), SharpenShift);
+            __m128i hi = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(diff, one), weights), SharpenShift);
+            return _mm_packs_epi32(lo, hi);
+        };
+
+        // Unpacking and packing both work per 128-bit lane, so the pixels come back in order
+        int x = step;
+        for (; x <= width - SIMD_WIDTH - step; x += SIMD_WIDTH) {
+            __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x));
+            __m128i blurred = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dst + x));
+            __m128i src_lo = _mm_unpacklo_epi8(pixels, _mm_setzero_si128());
+            __m128i src_hi = _mm_unpackhi_epi8(pixels, _mm_setzero_si128());
+            __m128i diff_lo = _mm_sub_epi16(src_lo, _mm_unpacklo_epi8(blurred, _mm_setzero_si128()));
+            __m128i diff_hi = _mm_sub_epi16(src_hi, _mm_unpackhi_epi8(blurred, _mm_setzero_si128()));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_packus_epi16(_mm_add_epi16(src_lo, scale(diff_lo)), _mm_add_epi16(src_hi, scale(diff_hi))));
+        }
+
+        if (x < width - step) sharpenRowScalar(src + x - step, dst + x - step, width - x + step, step, amount);
+    }
+
+    void gaussianTapsSSE41(const uint8_t* const* rows, const int16_t* weights, int taps, uint8_t* dst, int width) {
+        constexpr int SIMD_WIDTH = 8; // 8 pixels widened to 16-bit fill one SSE register
+
+        const __m128i rounding = _mm_set1_epi32(1 << (GaussianKernel::Shift - 1));
+        int x = 0;
+
+        for (; x + SIMD_WIDTH <= width; x += SIMD_WIDTH) {
+            __m128i sum_lo = rounding;
+            __m128i sum_hi = rounding;
+
+            // Two taps per madd: interleave their pixels and multiply by the (w[k], w[k + 1]) pair
+            for (int k = 0; k < taps; k += 2) {
+                bool paired = k + 1 < taps;
+                __m128i a = _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(rows[k] + x)));
+                __m128i b = paired ? _mm_cvtepu8_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(rows[k + 1] + x)))
+                                   : _mm_setzero_si128();
+                uint32_t pair = (uint16_t)weights[k] | ((uint32_t)(paired ? (uint16_t)weights[k + 1] : 0) << 16);
+                __m128i weight_vec = _mm_set1_epi32((int)pair);
+
+                sum_lo = _mm_add_epi32(sum_lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), weight_vec));
+                sum_hi = _mm_add_epi32(sum_hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), weight_vec));
+            }
+
+            sum_lo = _mm_srai_epi32(sum_lo, GaussianKernel::Shift);
+            sum_hi = _mm_srai_epi32(sum_hi, GaussianKernel::Shift);
+            __m128i words = _mm_packus_epi32(sum_lo, sum_hi);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dst + x), _mm_packus_epi16(words, words));
+        }
+
+        // Fallback for remaining pixels
+        for (; x < width; ++x) {
+            int32_t sum = 1 << (GaussianKernel::Shift - 1);
+            for (int k = 0; k < taps; ++k) sum += weights[k] * rows[k][x];
+            dst[x] = static_cast<uint8_t>(sum >> GaussianKernel::Shift);
+        }
+    }
+
+}
+}
@@ -0,0 +1,119 @@
+#include "CpuDispatch.h"
+
+#include <stdexcept>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace media_proc {
+namespace kernels {
+
+    static void cpuid(unsigned int leaf, unsigned int subleaf, unsigned int regs[4]) {
+        regs[0] = regs[1] = regs[2] = regs[3] = 0;
+    #if defined(_MSC_VER)
+        int info[4];
+        __cpuidex(info, (int)leaf, (int)subleaf);
+        for (int i = 0; i < 4; ++i) regs[i] = (unsigned int)info[i];
+    #elif defined(__x86_64__) || defined(__i386__)
+        __get_cpuid_count(leaf, subleaf, &regs[0], &regs[1], &regs[2], &regs[3]);
+    #endif
+    }
+
+    // Register state the OS saves on context switches; without it the wide registers are unusable
+    static unsigned long long xgetbv() {
+    #if defined(_MSC_VER)
+        return _xgetbv(0);
+    #elif defined(__x86_64__) || defined(__i386__)
+        unsigned int eax, edx;
+        __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        return ((unsigned long long)edx << 32) | eax;
+    #else
+        return 0;
+    #endif
+    }
+
+    Isa detectIsa() {
+        unsigned int leaf1[4], leaf7[4];
+        cpuid(0, 0, leaf1);
+        unsigned int maxLeaf = leaf1[0];
+
+        cpuid(1, 0, leaf1);
+        if (maxLeaf >= 7) cpuid(7, 0, leaf7);
+        else leaf7[0] = leaf7[1] = leaf7[2] = leaf7[3] = 0;
+
+        bool sse41 = leaf1[2] & (1u << 19);
+        bool osxsave = leaf1[2] & (1u << 27);
+        bool avx = leaf1[2] & (1u << 28);
+        bool f16c = leaf1[2] & (1u << 29);
+        if (!sse41) return Isa::Scalar;
+        if (!osxsave || !avx) return Isa::SSE41;
+
+        unsigned long long xcr0 = xgetbv();
+        bool ymmState = (xcr0 & 0x6) == 0x6;    // SSE and AVX state
+        bool zmmState = (xcr0 & 0xE6) == 0xE6;  // plus opmask and both halves of the ZMM registers
+
+        bool avx2 = ymmState && (leaf7[1] & (1u << 5)) && f16c; // Every AVX2 CPU has F16C, the half kernel relies on it
+        bool avx512bw = zmmState && (leaf7[1] & (1u << 16)) && (leaf7[1] & (1u << 30));
+
+        if (avx2 && avx512bw) return Isa::AVX512;
+        if (avx2) return Isa::AVX2;
+        return Isa::SSE41;
+    }
+
+    const char* isaName(Isa isa) {
+        switch (isa) {
+            case Isa::Scalar: return "scalar";
+            case Isa::SSE41: return "sse4.1";
+            case Isa::AVX2: return "avx2";
+            case Isa::AVX512: return "avx512";
+        }
+        return "unknown";
+    }
+
+    bool parseIsa(const std::string &name, Isa &isa) {
+        for (Isa candidate : { Isa::Scalar, Isa::SSE41, Isa::AVX2, Isa::AVX512 }) {
+            if (name == isaName(candidate)) { isa = candidate; return true; }
+        }
+        return false;
+    }
+
+    static KernelSet kernelSet(Isa isa) {
+        const WideKernels wideAVX2 = { blurRow16AVX2, blurRowHalfAVX2, blurRowFloatAVX2 };
+        const WideKernels wideScalar = { blurRow16Scalar, blurRowHalfScalar, blurRowFloatScalar };
+
+        switch (isa) {
+            case Isa::AVX512: return { isa, blurRowExactAVX512, blurRowFixedAVX512, blurRowApproxAVX512, gaussianTapsAVX512, sharpenRowAVX512, wideAVX2 };
+            case Isa::AVX2: return { isa, blurRowExactAVX2, blurRowFixedAVX2, blurRowApproxAVX2, gaussianTapsAVX2, sharpenRowAVX2, wideAVX2 };
+            case Isa::SSE41: return { isa, blurRowExactSSE41, blurRowFixedSSE41, blurRowApproxSSE41, gaussianTapsSSE41, sharpenRowSSE41, wideScalar };
+            case Isa::Scalar: break;
+        }
+        return { Isa::Scalar, blurRowScalar, blurRowFixedScalar, blurRowApproxScalar, gaussianTapsScalar, sharpenRowScalar, wideScalar };
+    }
+
+    static KernelSet& selectedKernels() {
+        static KernelSet kernels = kernelSet(detectIsa());
+        return kernels;
+    }
+
+    void selectIsa(Isa isa) {
+        Isa supported = detectIsa();
+        if (isa > supported) {
+            throw std::runtime_error(std::string("CPU does not support ") + isaName(isa) + " (best: " + isaName(supported) + ")");
+        }
+        selectedKernels() = kernelSet(isa);
+    }
+
+    const KernelSet& activeKernels() {
+        return selectedKernels();
+    }
+
+    const KernelSet& scalarKernels() {
+        static const KernelSet kernels = kernelSet(Isa::Scalar);
+        return kernels;
+    }
+
+}
+}
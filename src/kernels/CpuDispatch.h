@@ -0,0 +1,64 @@
+/*
+ * CPU Dispatch
+ * ============
+ *
+ * Runtime selection of the vector kernels. Every ISA level is compiled into
+ * the binary with its own per-file flags; at startup cpuid (and the OS state
+ * enabled in XCR0) decides which level the CPU can run, and the matching
+ * kernel set is used by the SIMD and tiled processor nodes.
+ *
+ * Author: Finoshkin Aleksei
+ * License: MIT
+ */
+
+#ifndef IMG_DEINT_CPU_DISPATCH_H
+#define IMG_DEINT_CPU_DISPATCH_H
+
+
+#include "BlurKernels.h"
+#include "GaussianBlur.h"
+
+#include <string>
+
+namespace media_proc {
+namespace kernels {
+
+    enum class Isa { Scalar, SSE41, AVX2, AVX512 };
+
+    struct KernelSet {
+        Isa isa;
+        BlurRowFn blurRowExact;
+        BlurRowFn blurRowFixed;
+        BlurRowFn blurRowApprox;
+        GaussianTapsFn gaussianTaps;
+        SharpenRowFn sharpenRow;
+        WideKernels wide; // AVX2 kernels on the AVX-512 level too, scalar below AVX2
+
+        BlurRowFn blurRow(Precision precision) const {
+            return precision == Precision::Fixed ? blurRowFixed : precision == Precision::Approx ? blurRowApprox : blurRowExact;
+        }
+    };
+
+    // Best level this CPU and OS support
+    Isa detectIsa();
+
+    const char* isaName(Isa isa);
+
+    // Accepts the names printed by isaName(): scalar, sse4.1, avx2, avx512
+    bool parseIsa(const std::string &name, Isa &isa);
+
+    // Forces a level, e.g. for benchmarking. Call before processing starts.
+    // Throws std::runtime_error when the CPU cannot run it.
+    void selectIsa(Isa isa);
+
+    // Kernels of the selected level, detectIsa() unless selectIsa() was called
+    const KernelSet& activeKernels();
+
+    // Scalar kernels, for the modes that parallelise across threads instead of vector lanes
+    const KernelSet& scalarKernels();
+
+}
+}
+
+
+#endif //!IMG_DEINT_CPU_DISPATCH_H
@@ -0,0 +1,91 @@
+#include "GaussianBlur.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace media_proc {
+namespace kernels {
+
+    GaussianKernel GaussianKernel::create(float sigma, int radius) {
+        if (sigma <= 0.0f && radius <= 0) throw std::runtime_error("Gaussian kernel needs a positive sigma or radius");
+        if (radius <= 0) radius = std::max(1, (int)std::ceil(3.0f * sigma));
+        if (sigma <= 0.0f) sigma = radius / 3.0f;
+        if (radius > MaxRadius) throw std::runtime_error("Gaussian radius " + std::to_string(radius) + " exceeds " + std::to_string(MaxRadius));
+
+        std::vector<double> exact(2 * radius + 1);
+        double total = 0.0;
+        for (int k = -radius; k <= radius; ++k) {
+            exact[k + radius] = std::exp(-(double)k * k / (2.0 * sigma * sigma));
+            total += exact[k + radius];
+        }
+
+        GaussianKernel kernel;
+        kernel.radius = radius;
+        kernel.weights.resize(exact.size());
+
+        // Round every weight, then give the rounding error to the centre tap so the sum is exactly 1 << Shift
+        int sum = 0;
+        for (size_t k = 0; k < exact.size(); ++k) {
+            kernel.weights[k] = (int16_t)std::lround(exact[k] / total * (1 << Shift));
+            sum += kernel.weights[k];
+        }
+        kernel.weights[radius] += (int16_t)((1 << Shift) - sum);
+        return kernel;
+    }
+
+    void gaussianTapsScalar(const uint8_t* const* rows, const int16_t* weights, int taps, uint8_t* dst, int width) {
+        for (int x = 0; x < width; ++x) {
+            int32_t sum = 1 << (GaussianKernel::Shift - 1);
+            for (int k = 0; k < taps; ++k) sum += weights[k] * rows[k][x];
+            dst[x] = static_cast<uint8_t>(sum >> GaussianKernel::Shift);
+        }
+    }
+
+    void blurRowsSeparable(uint8_t* data, int stride, int width, int height, int step, int startY, int endY,
+                           const uint8_t* topHalo, const uint8_t* bottomHalo, const GaussianKernel &kernel,
+                           uint8_t* scratch, GaussianTapsFn tapsFn) {
+        if (startY >= endY || width < step) return;
+
+        int radius = kernel.radius;
+        int taps = kernel.taps();
+        const int16_t* weights = kernel.weights.data();
+
+        // Ring of horizontally blurred rows: row i lives in slot (i - startY + radius) % taps
+        uint8_t* ring = scratch;
+        uint8_t* line = scratch + (size_t)taps * width;
+        int pad = radius * step;
+
+        // Tap k of an interleaved channel sits k pixels, k * step samples, to the right
+        const uint8_t* lineTaps[2 * GaussianKernel::MaxRadius + 1];
+        const uint8_t* rowTaps[2 * GaussianKernel::MaxRadius + 1];
+        for (int k = 0; k < taps; ++k) lineTaps[k] = line + k * step;
+
+        auto original = [&](int i) -> const uint8_t* {
+            if (i < startY && topHalo) return topHalo + (size_t)(i - (startY - radius)) * width;
+            if (i >= endY && bottomHalo) return bottomHalo + (size_t)(i - endY) * width;
+            return data + (size_t)std::min(std::max(i, 0), height - 1) * stride;
+        };
+
+        // Row i is read before any row at or below it is written, so the plane still holds its original pixels
+        auto blurHorizontal = [&](int i) {
+            const uint8_t* src = original(i);
+            for (int x = 0; x < pad; ++x) line[x] = src[x % step];
+            std::memcpy(line + pad, src, width);
+            for (int x = 0; x < pad; ++x) line[pad + width + x] = src[width - step + x % step];
+            tapsFn(lineTaps, weights, taps, ring + (size_t)((i - startY + radius) % taps) * width, width);
+        };
+
+        for (int i = startY - radius; i < startY + radius; ++i) blurHorizontal(i);
+
+        for (int y = startY; y < endY; ++y) {
+            blurHorizontal(y + radius);
+            for (int k = 0; k < taps; ++k) rowTaps[k] = ring + (size_t)((y - startY + k) % taps) * width;
+            tapsFn(rowTaps, weights, taps, data + (size_t)y * stride, width);
+        }
+    }
+
+}
+}
@@ -0,0 +1,70 @@
+/*
+ * Gaussian Blur Kernels
+ * =====================
+ *
+ * Separable Gaussian blur with a kernel generated at runtime from sigma and
+ * radius. A horizontal and a vertical 1D pass replace the fixed 3x3 stencil,
+ * so a pixel costs 2 * (2r + 1) taps instead of (2r + 1)^2. Both passes are
+ * fused into one in-place sweep over the plane through a ring of 2r + 1
+ * horizontally blurred rows.
+ *
+ * Author: Finoshkin Aleksei
+ * License: MIT
+ */
+
+#ifndef IMG_DEINT_GAUSSIAN_BLUR_H
+#define IMG_DEINT_GAUSSIAN_BLUR_H
+
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace media_proc {
+namespace kernels {
+
+    // Normalised 1D Gaussian in fixed point: the 2 * radius + 1 weights sum to 1 << Shift
+    struct GaussianKernel {
+        static constexpr int Shift = 14;
+        static constexpr int MaxRadius = 64;
+
+        int radius = 0;
+        std::vector<int16_t> weights;
+
+        // A missing radius is taken as ceil(3 * sigma), a missing sigma as radius / 3.
+        // Throws std::runtime_error when neither is positive or the radius exceeds MaxRadius.
+        static GaussianKernel create(float sigma, int radius);
+
+        int taps() const { return 2 * radius + 1; }
+    };
+
+    // dst[x] = sum of weights[k] * rows[k][x] over k < taps, rounded back to 8 bits.
+    // The horizontal pass calls it with rows[k] = line + k * step.
+    using GaussianTapsFn = void (*)(const uint8_t* const* rows, const int16_t* weights, int taps, uint8_t* dst, int width);
+
+    void gaussianTapsScalar(const uint8_t* const* rows, const int16_t* weights, int taps, uint8_t* dst, int width);
+
+    // Vector versions pairing taps through madd, bit-exact with the scalar one. Built with per-file ISA
+    // flags; pick one through CpuDispatch.h.
+    void gaussianTapsSSE41(const uint8_t* const* rows, const int16_t* weights, int taps, uint8_t* dst, int width);  // 8 pixels per iteration
+    void gaussianTapsAVX2(const uint8_t* const* rows, const int16_t* weights, int taps, uint8_t* dst, int width);   // 16 pixels per iteration
+    void gaussianTapsAVX512(const uint8_t* const* rows, const int16_t* weights, int taps, uint8_t* dst, int width); // 32 pixels per iteration
+
+    // Scratch bytes blurRowsSeparable() needs: the row ring plus one edge-padded line
+    inline size_t separableScratchSize(int width, int radius, int step = 1) {
+        return (size_t)(2 * radius + 1) * width + (width + 2 * radius * step);
+    }
+
+    // Blurs rows [startY, endY) of a plane in place, edges are clamped per channel when `step`
+    // interleaves several (see BlurRowFn). topHalo/bottomHalo hold the `radius` original rows above
+    // startY and below endY (clamped to the plane); pass nullptr to read them from the plane when
+    // no other strip writes them concurrently.
+    void blurRowsSeparable(uint8_t* data, int stride, int width, int height, int step, int startY, int endY,
+                           const uint8_t* topHalo, const uint8_t* bottomHalo, const GaussianKernel &kernel,
+                           uint8_t* scratch, GaussianTapsFn taps);
+
+}
+}
+
+
+#endif //!IMG_DEINT_GAUSSIAN_BLUR_H
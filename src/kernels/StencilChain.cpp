@@ -0,0 +1,186 @@
+#include "StencilChain.h"
+
+#include "utils/BufferPool.h"
+#include "utils/Executor.h"
+#include "utils/Trace.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace media_proc {
+namespace kernels {
+
+    int stencilHalo(const Stencil* stages, int count) {
+        int halo = 0;
+        for (int i = 0; i < count; ++i) halo += stages[i].radius();
+        return halo;
+    }
+
+    // Ring bytes of one stage: the three input rows of the 3x3 kernels, or the horizontally blurred
+    // rows of the Gaussian plus its edge-padded input line
+    static size_t stageScratchSize(const Stencil &stage, int width, int step) {
+        if (stage.op != Stencil::Op::Gaussian) return 3 * (size_t)width;
+        return (size_t)stage.gaussian.taps() * width + width + 2 * stage.gaussian.radius * step;
+    }
+
+    // Streams the rows of one strip through every stage. A producer writes row i into inputRow(k, i) of
+    // the stage after it and calls pushed(k, i); the stage then emits every output row whose neighbourhood
+    // is complete, each straight into the next stage's input, and the last stage into the plane.
+    class StencilStream {
+    public:
+        StencilStream(uint8_t* data, int stride, int width, int height, int step, const Stencil* stages, int count,
+                      const StencilKernels &kernels, uint8_t* scratch)
+            : m_Data(data), m_Stride(stride), m_Width(width), m_Height(height), m_Step(step), m_Kernels(kernels), m_Stages(count) {
+            for (int k = 0; k < count; ++k) {
+                Stage &stage = m_Stages[k];
+                stage.stencil = &stages[k];
+                stage.ring = scratch;
+                if (stages[k].op == Stencil::Op::Gaussian) {
+                    stage.slots = stages[k].gaussian.taps();
+                    stage.line = scratch + (size_t)stage.slots * width;
+                    for (int tap = 0; tap < stage.slots; ++tap) stage.lineTaps.push_back(stage.line + tap * step);
+                    stage.rowTaps.resize(stage.slots);
+                }
+                else stage.slots = 3;
+                scratch += stageScratchSize(stages[k], width, step);
+            }
+        }
+
+        // Writes output rows [startY, endY). Original rows above and below them come from `top`, which
+        // holds the `halo` rows ending at startY, and `bottom`, which holds those from endY on.
+        void run(int startY, int endY, const uint8_t* top, const uint8_t* bottom, int halo) {
+            int remaining = halo;
+            for (Stage &stage : m_Stages) {
+                remaining -= stage.stencil->radius();
+                stage.next = std::max(startY - remaining, 0);
+                stage.end = std::min(endY + remaining, m_Height);
+            }
+
+            // The row is in the first stage's ring before the last stage can write over it in the plane
+            for (int y = std::max(startY - halo, 0); y < std::min(endY + halo, m_Height); ++y) {
+                const uint8_t* src = y < startY ? top + (size_t)(y - startY + halo) * m_Width
+                                   : y >= endY ? bottom + (size_t)(y - endY) * m_Width
+                                   : m_Data + (size_t)y * m_Stride;
+                std::memcpy(inputRow(0, y), src, m_Width);
+                pushed(0, y);
+            }
+        }
+
+    private:
+        struct Stage {
+            const Stencil* stencil = nullptr;
+            uint8_t* ring = nullptr;
+            uint8_t* line = nullptr;  // Gaussian: padded input line
+            int slots = 0;
+            int next = 0, end = 0;    // Output rows still to emit
+            std::vector<const uint8_t*> lineTaps, rowTaps;
+        };
+
+        uint8_t* inputRow(size_t k, int row) {
+            if (k == m_Stages.size()) return m_Data + (size_t)row * m_Stride;
+            Stage &stage = m_Stages[k];
+            if (stage.stencil->op == Stencil::Op::Gaussian) return stage.line + stage.stencil->gaussian.radius * m_Step;
+            return stage.ring + (size_t)(row % stage.slots) * m_Width;
+        }
+
+        void pushed(size_t k, int row) {
+            Stage &stage = m_Stages[k];
+            const Stencil &stencil = *stage.stencil;
+            int radius = stencil.radius();
+
+            if (stencil.op == Stencil::Op::Gaussian) {
+                // Horizontal pass of the new row into the ring, edges clamped per channel as blurRowsSeparable() does
+                uint8_t* line = stage.line;
+                int pad = radius * m_Step;
+                for (int x = 0; x < pad; ++x) {
+                    line[x] = line[pad + x % m_Step];
+                    line[pad + m_Width + x] = line[pad + m_Width - m_Step + x % m_Step];
+                }
+                m_Kernels.gaussianTaps(stage.lineTaps.data(), stencil.gaussian.weights.data(), stage.slots,
+                                       stage.ring + (size_t)(row % stage.slots) * m_Width, m_Width);
+            }
+
+            while (stage.next < stage.end && std::min(stage.next + radius, m_Height - 1) <= row) {
+                int y = stage.next++;
+                uint8_t* dst = inputRow(k + 1, y);
+
+                if (stencil.op == Stencil::Op::Gaussian) {
+                    for (int tap = 0; tap < stage.slots; ++tap) {
+                        int source = std::min(std::max(y - radius + tap, 0), m_Height - 1);
+                        stage.rowTaps[tap] = stage.ring + (size_t)(source % stage.slots) * m_Width;
+                    }
+                    m_Kernels.gaussianTaps(stage.rowTaps.data(), stencil.gaussian.weights.data(), stage.slots, dst, m_Width);
+                }
+                else {
+                    const uint8_t* curr = stage.ring + (size_t)(y % 3) * m_Width;
+                    if (y == 0 || y == m_Height - 1 || m_Width < 2 * m_Step + 1) std::memcpy(dst, curr, m_Width);
+                    else {
+                        m_Kernels.blurRow(stage.ring + (size_t)((y - 1) % 3) * m_Width, curr, stage.ring + (size_t)((y + 1) % 3) * m_Width, dst, m_Width, m_Step);
+                        std::memcpy(dst, curr, m_Step);
+                        std::memcpy(dst + m_Width - m_Step, curr + m_Width - m_Step, m_Step);
+                        if (stencil.op == Stencil::Op::Sharpen) m_Kernels.sharpenRow(curr, dst, m_Width, m_Step, stencil.amount);
+                    }
+                }
+
+                if (k + 1 < m_Stages.size()) pushed(k + 1, y);
+            }
+        }
+
+    private:
+        uint8_t* m_Data;
+        int m_Stride, m_Width, m_Height, m_Step;
+        StencilKernels m_Kernels;
+        std::vector<Stage> m_Stages;
+    };
+
+    void filterPlaneFused(uint8_t* data, int stride, int width, int height, int step, const Stencil* stages, int count,
+                          const StencilKernels &kernels, Executor* executor) {
+        if (count <= 0 || width < step || height <= 0) return;
+
+        int halo = stencilHalo(stages, count);
+        size_t scratchBytes = 0;
+        for (int k = 0; k < count; ++k) scratchBytes += stageScratchSize(stages[k], width, step);
+
+        // Strips only recompute the halo rows at their edges, so they are kept at least four halos tall
+        int strips = executor ? std::max(1, std::min((int)executor->size() * 2, height / (4 * halo))) : 1;
+        int stripHeight = (height + strips - 1) / strips;
+        strips = (height + stripHeight - 1) / stripHeight;
+
+        // Neighbouring strips overwrite each other's halo rows, so snapshot all of them first
+        size_t haloBytes = (size_t)halo * width;
+        PooledBuffer snapshots;
+        if (strips > 1) {
+            snapshots = BufferPool::global().acquire((size_t)strips * 2 * haloBytes);
+            for (int strip = 0; strip < strips; ++strip) {
+                int startY = strip * stripHeight;
+                int endY = std::min(startY + stripHeight, height);
+
+                uint8_t* snapshot = snapshots.data() + strip * 2 * haloBytes;
+                for (int k = 0; k < halo; ++k) {
+                    if (startY - halo + k >= 0) std::memcpy(snapshot + k * width, data + (size_t)(startY - halo + k) * stride, width);
+                    if (endY + k < height) std::memcpy(snapshot + haloBytes + k * width, data + (size_t)(endY + k) * stride, width);
+                }
+            }
+        }
+
+        const uint8_t* snapshotRows = snapshots.data();
+        auto filterStrips = [=, &kernels](size_t begin, size_t end) {
+            PooledBuffer scratch = BufferPool::global().acquire(scratchBytes);
+            StencilStream stream(data, stride, width, height, step, stages, count, kernels, scratch.data());
+            for (size_t strip = begin; strip < end; ++strip) {
+                int startY = (int)strip * stripHeight;
+                int endY = std::min(startY + stripHeight, height);
+                TRACE_SPAN_ARG("filter strip", "y", startY);
+
+                const uint8_t* top = snapshotRows ? snapshotRows + strip * 2 * haloBytes : nullptr;
+                stream.run(startY, endY, top, top ? top + haloBytes : nullptr, halo);
+            }
+        };
+
+        if (strips > 1) executor->parallelFor(0, strips, filterStrips, 1);
+        else filterStrips(0, 1);
+    }
+
+}
+}
@@ -0,0 +1,66 @@
+/*
+ * Stencil Chain Engine
+ * ====================
+ *
+ * Applies a run of neighbourhood filters (3x3 blur, separable Gaussian,
+ * unsharp mask) to an 8-bit plane in one sweep. Rows stream through the
+ * stages as they are read: every stage keeps a ring of just the rows its
+ * neighbourhood spans and hands each finished row straight to the next one,
+ * and the last stage writes it back. The plane is read once and written
+ * once whatever the number of filters, and no stage computes a row twice.
+ *
+ * Author: Finoshkin Aleksei
+ * License: MIT
+ */
+
+#ifndef IMG_DEINT_STENCIL_CHAIN_H
+#define IMG_DEINT_STENCIL_CHAIN_H
+
+
+#include "BlurKernels.h"
+#include "GaussianBlur.h"
+
+#include <cstddef>
+
+namespace media_proc {
+
+    class Executor;
+
+namespace kernels {
+
+    // One filter of a chain, with the same border rules as the mode that runs it on its own
+    struct Stencil {
+        enum class Op {
+            Blur,      // The 3x3 kernel at the chain's precision; first and last row and pixel of every channel kept
+            Gaussian,  // Separable Gaussian with clamped edges, every pixel written
+            Sharpen    // Unsharp mask against the 3x3 blur: p + amount * (p - blur(p)); borders kept like Blur
+        };
+
+        Op op = Op::Blur;
+        GaussianKernel gaussian;  // Gaussian only
+        int amount = 256;         // Sharpen only: strength in 1/256 steps (SharpenShift), 256 = 1.0
+
+        // Rows above and below an output row the stage reads
+        int radius() const { return op == Op::Gaussian ? gaussian.radius : 1; }
+    };
+
+    struct StencilKernels {
+        BlurRowFn blurRow;
+        GaussianTapsFn gaussianTaps;
+        SharpenRowFn sharpenRow;
+    };
+
+    // Halo of a run of stages: rows above and below its output that its first stage has to see
+    int stencilHalo(const Stencil* stages, int count);
+
+    // Applies stages [0, count) one after the other to a plane in place, `step` as for BlurRowFn. Strips
+    // of rows run in parallel on `executor` when one is given, otherwise the whole plane streams on the
+    // calling thread. The output matches running every stage over the whole plane in turn, bit for bit.
+    void filterPlaneFused(uint8_t* data, int stride, int width, int height, int step, const Stencil* stages, int count,
+                          const StencilKernels &kernels, Executor* executor = nullptr);
+
+}
+}
+
+
+#endif //!IMG_DEINT_STENCIL_CHAIN_H
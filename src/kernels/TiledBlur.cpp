@@ -0,0 +1,136 @@
+#include "TiledBlur.h"
+
+#include "utils/BufferPool.h"
+#include "utils/Executor.h"
+#include "utils/Trace.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TILED_BLUR_SSE2
+#endif
+
+namespace media_proc {
+namespace kernels {
+
+    // Writes a finished tile row with non-temporal stores: the output is not read again in this
+    // pass, so it does not need to take cache space from the input rows and halos
+    static void streamRow(uint8_t* dst, const uint8_t* src, int count) {
+    #ifdef TILED_BLUR_SSE2
+        int head = std::min(count, (int)((16 - (reinterpret_cast<uintptr_t>(dst) & 15)) & 15));
+        std::memcpy(dst, src, head);
+
+        int x = head;
+        for (; x + 16 <= count; x += 16) {
+            _mm_stream_si128(reinterpret_cast<__m128i*>(dst + x), _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + x)));
+        }
+        std::memcpy(dst + x, src + x, count - x);
+    #else
+        std::memcpy(dst, src, count);
+    #endif
+    }
+
+    static void prefetchColumns(const uint8_t* data, int stride, int x, int cols, int startY, int endY) {
+    #ifdef TILED_BLUR_SSE2
+        for (int y = startY; y < endY; ++y) {
+            const char* row = reinterpret_cast<const char*>(data + y * stride + x);
+            for (int offset = 0; offset < cols; offset += 64) _mm_prefetch(row + offset, _MM_HINT_T0);
+        }
+    #endif
+    }
+
+    static size_t bandScratchSize(TileConfig tile, int step) {
+        return 2 * (size_t)(tile.height + 2) * (tile.width + 2 * step) + (tile.width + 2 * step);
+    }
+
+    // Blurs rows [startY, endY) tile by tile. topHalo/bottomHalo are the original rows startY-1 and endY.
+    static void blurBand(uint8_t* data, int stride, int width, int step, int startY, int endY,
+                         const uint8_t* topHalo, const uint8_t* bottomHalo, TileConfig tile, BlurRowFn blurRow, uint8_t* scratch) {
+        int rows = endY - startY;
+        int blockStride = tile.width + 2 * step;
+        uint8_t* blocks[2] = { scratch, scratch + (size_t)(tile.height + 2) * blockStride };
+        uint8_t* line = blocks[1] + (size_t)(tile.height + 2) * blockStride;
+
+        // Copies columns [x0 - step, x1 + step) of rows [startY - 1, endY] into a block. The halo is one
+        // pixel of every channel, so interleaved samples keep their channel at the same offset in the block.
+        auto load = [&](uint8_t* block, int x0, int x1) {
+            int cols = x1 - x0 + 2 * step;
+            std::memcpy(block, topHalo + x0 - step, cols);
+            for (int r = 0; r < rows; ++r) std::memcpy(block + (r + 1) * blockStride, data + (startY + r) * stride + x0 - step, cols);
+            std::memcpy(block + (rows + 1) * blockStride, bottomHalo + x0 - step, cols);
+        };
+
+        int x0 = step, x1 = std::min(x0 + tile.width, width - step);
+        int current = 0;
+        load(blocks[current], x0, x1);
+
+        while (x0 < x1) {
+            int nextX0 = x1, nextX1 = std::min(nextX0 + tile.width, width - step);
+
+            // The next tile is loaded before this one is written back: its left halo is this tile's last original column
+            if (nextX0 < nextX1) {
+                load(blocks[current ^ 1], nextX0, nextX1);
+                prefetchColumns(data, stride, nextX1, std::min(tile.width, width - nextX1), startY, endY);
+            }
+
+            TRACE_SPAN_ARG("tile", "x", x0);
+            int cols = x1 - x0 + 2 * step;
+            const uint8_t* block = blocks[current];
+            for (int r = 1; r <= rows; ++r) {
+                blurRow(block + (r - 1) * blockStride, block + r * blockStride, block + (r + 1) * blockStride, line, cols, step);
+                uint8_t* dst = data + (startY + r - 1) * stride + x0;
+                if (tile.streamStores) streamRow(dst, line + step, x1 - x0);
+                else std::memcpy(dst, line + step, x1 - x0);
+            }
+
+            x0 = nextX0;
+            x1 = nextX1;
+            current ^= 1;
+        }
+    }
+
+    size_t blurPlaneTiled(uint8_t* data, int stride, int width, int height, int step, TileConfig tile, BlurRowFn blurRow, Executor* executor) {
+        if (width < 2 * step + 1 || height < 3) return 0;
+        tile.width = std::max(tile.width, 16);
+        tile.height = std::max(tile.height, 1);
+
+        int rows = height - 2;
+        int bands = (rows + tile.height - 1) / tile.height;
+
+        // Bands write each other's boundary rows, so the original row above and below every band is captured first
+        PooledBuffer halos = BufferPool::global().acquire((size_t)bands * 2 * width);
+        for (int band = 0; band < bands; ++band) {
+            int startY = 1 + band * tile.height;
+            int endY = std::min(startY + tile.height, height - 1);
+
+            uint8_t* halo = halos.data() + (size_t)band * 2 * width;
+            std::memcpy(halo, data + (startY - 1) * stride, width);
+            std::memcpy(halo + width, data + endY * stride, width);
+        }
+
+        const uint8_t* haloRows = halos.data();
+        auto blurBands = [=](size_t begin, size_t end) {
+            PooledBuffer scratch = BufferPool::global().acquire(bandScratchSize(tile, step));
+            for (size_t band = begin; band < end; ++band) {
+                int startY = 1 + (int)band * tile.height;
+                int endY = std::min(startY + tile.height, height - 1);
+
+                const uint8_t* halo = haloRows + band * 2 * width;
+                TRACE_SPAN_ARG("tile band", "y", startY);
+                blurBand(data, stride, width, step, startY, endY, halo, halo + width, tile, blurRow, scratch.data());
+            }
+        #ifdef TILED_BLUR_SSE2
+            if (tile.streamStores) _mm_sfence(); // Make the streamed rows visible before the band is reported done
+        #endif
+        };
+
+        if (executor) executor->parallelFor(0, bands, blurBands, 1);
+        else blurBands(0, bands);
+
+        return 2 * (size_t)width * rows;
+    }
+
+}
+}
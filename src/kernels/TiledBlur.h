@@ -0,0 +1,48 @@
+/*
+ * Tiled Blur Engine
+ * =================
+ *
+ * Cache-blocked driver for the row kernels. The plane is cut into bands of
+ * tile rows and every band into tiles; a tile plus its one-pixel halo is
+ * copied into an L1/L2-sized block, blurred from there and streamed straight
+ * back into the plane. Blur and write-back are fused into a single pass, so
+ * each byte of the plane is read once and written once.
+ *
+ * Author: Finoshkin Aleksei
+ * License: MIT
+ */
+
+#ifndef IMG_DEINT_TILED_BLUR_H
+#define IMG_DEINT_TILED_BLUR_H
+
+
+#include "BlurKernels.h"
+
+#include <cstddef>
+
+namespace media_proc {
+
+    class Executor;
+
+namespace kernels {
+
+    struct TileConfig {
+        int width = 256;
+        int height = 32;
+
+        // Write tile rows with non-temporal stores. In place the output lines were just read into
+        // the cache, where regular stores are cheaper, so this only pays off on planes far larger
+        // than the last-level cache and is off by default.
+        bool streamStores = false;
+    };
+
+    // Blurs rows [1, height-1) and columns [step, width-step) of a plane in place, `step` as for
+    // BlurRowFn. Bands run in parallel on `executor` when one is given, otherwise on the calling thread.
+    // Returns the number of bytes read from and written to the plane.
+    size_t blurPlaneTiled(uint8_t* data, int stride, int width, int height, int step, TileConfig tile, BlurRowFn blurRow, Executor* executor = nullptr);
+
+}
+}
+
+
+#endif //!IMG_DEINT_TILED_BLUR_H
@@ -18,19 +18,24 @@
  * [mcdeint_out]qp=10[result]" -map [result] deinterlaced.jpg
  */
 
- //#define TRACK_MEMORY
-
 #include "StdAfx.h"
 #include "parser/CommandLineParser.h"
+#include "batch/BatchRunner.h"
+#include "server/BlurServer.h"
+#include "server/FrameRingServer.h"
 
 #include "nodes/FFmpegEncNode.h"
 #include "nodes/FFmpegDecNode.h"
+#include "nodes/BlurModes.h"
+#include "nodes/FilterChain.h"
+#include "nodes/GpuBackend.h"
+
+#include "kernels/CpuDispatch.h"
+#include "utils/MetricsExporter.h"
 
-#include "nodes/BlurProcNode.h"
-#include "nodes/BlurAsyncProcNode.h"
-#include "nodes/BlurThreadProcNode.h"
-#include "nodes/BlurGPUProcNode.h"
-#include "nodes/BlurSIMDProcNode.h"
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
 
 void printHelp() {
     std::cout << R"(Image Blur Tool
@@ -38,35 +43,433 @@ void printHelp() {
 Usage:
   img_blur --input <input_file> [--output <output_file>] [--mode <mode>]
   img_blur -i <input_file> [-o <output_file>] [-m <mode>]
+  img_blur -i - -o - --format <format> [-m <mode>]
+  img_blur -i <input_file> -f <filter>[,<filter>...] [-m <mode>]
+  img_blur --batch <dir|glob|@list> [--output <output_dir>] [--mode <mode>]
+  img_blur --serve <socket_path> [--mode <mode>] [--jobs <lanes>]
+  img_blur --serve-shm <socket_path> [--mode <mode>]
 
 Description:
-  This tool applies a blur effect to an image.
+  This tool applies a blur effect to an image, or to every frame of a video.
 
 Options:
-  --input, -i     Path to the input image file. (Required)
-  --output, -o    Path to save the output image file. (Optional, default: output.${input ext})
+  --input, -i     Path to the input image or video file, or - to stream from stdin.
+                  (Required)
+  --output, -o    Path to save the output file. Images are encoded by extension, other
+                  extensions are muxed as video, e.g. .mp4 or .mkv. - streams to stdout.
+                  (Optional, default: output.${input ext}, or - when reading stdin)
+  --format        Output format when the output has no usable extension, required with
+                  -o -: an image format (png, jpg, bmp, tiff, ...), a muxer (matroska,
+                  nut, mpegts) or a container extension (mkv, mp4).
   --mode, -m      Processing mode to use. (Optional, default: default)
-                  Available modes: default, async, threads, gpu, simd
+                  Available modes: default, async, threads, gpu, simd, simd-threads, tiled
+  --filter, -f    Chain of filters run instead of the mode's blur, separated by commas, with
+                  a filter's options after '=' separated by colons (default, threads, simd,
+                  simd-threads and tiled modes, 8-bit formats):
+                    blur                   3x3 kernel at --precision
+                    blur=sigma=2:radius=6  separable Gaussian, blur=2 is sigma 2
+                    sharpen=0.5            unsharp mask of this amount, 0 to 8 (default: 1)
+                  Adjacent filters are fused into one streamed sweep over each plane, so the
+                  frame is read and written once per run instead of once per filter.
+  --no-fuse       Run every filter of --filter as its own sweep, e.g. to compare timings.
+  --inplace       Blur each plane over itself through a rolling line buffer instead of
+                  a full-plane temp copy (default, threads, simd and simd-threads modes).
+  --sigma         Gaussian sigma in pixels. Switches to a separable Gaussian blur of any
+                  strength, done in one in-place pass (all CPU modes but async and tiled).
+  --radius        Gaussian radius in pixels, at most 64. (Optional, default: ceil(3 * sigma))
+  --tile          Tiled mode: tile size as <width>x<height> pixels. (Optional, default: 256x32)
+  --nt-stores     Tiled mode: write tiles back with non-temporal stores. Only worth it for
+                  planes much larger than the last-level cache.
+  --threads       Worker threads of the threads, simd-threads, tiled and async modes.
+                  (Optional, default: one per CPU core)
+  --concurrent    Run decoder, processor and encoder on separate threads connected
+                  by bounded queues. (Optional, default: sequential)
+  --queue-depth   Packets buffered between two concurrent nodes. (Optional, default: 4)
+  --decode-threads, --encode-threads
+                  Threads of the FFmpeg decoder / encoder, a number or "auto". Auto gives
+                  the codec every core when the pipeline is sequential, and the cores the
+                  processor leaves free (at least a quarter) with --concurrent. Batch lanes
+                  use one each. (Optional, default: auto)
+  --decode-thread-type, --encode-thread-type
+                  Codec threading kinds: frame, slice or frame,slice. Frame threading adds
+                  a frame of latency per thread. (Optional, default: frame,slice)
+  --batch         Process many images in one process: a directory, a quoted glob pattern
+                  or a list file (@list.txt, one path per line). --output names the output
+                  directory (default: blurred). Decoder, encoder and processor nodes are
+                  reused across inputs with the same codec and geometry.
+  --jobs          Batch: number of lanes processing small images side by side.
+                  (Optional, default: number of CPU cores)
+  --large-size    Batch: inputs of at least this many KiB are processed one at a time
+                  with --mode spread across all cores, smaller ones run single-threaded
+                  on the lanes. (Optional, default: 2048)
+  --serve         Run as a daemon serving blur jobs on this Unix socket path (Linux).
+                  Lanes keep their codec contexts, processors, thread pools and GL context
+                  between jobs. Requests name an input file or send the image inline, with
+                  an output path or a format to get the result back, a mode and a priority;
+                  replies carry queue, run and total milliseconds. See server/BlurServer.h
+                  for the protocol. --jobs sets the lanes (default: CPU cores, gpu: 1).
+  --queue-size    Server: jobs waiting for a lane before requests are turned away with
+                  status=busy. (Optional, default: 64)
+  --serve-shm     Blur raw frames of client processes in shared memory (Linux). A client
+                  hands over a memfd ring of frame slots on this Unix socket, then sends
+                  slot indices; each frame is blurred in place with no copy and no codec.
+                  See shm/FrameRing.h for the layout and img_blur_shm_client for a client.
+  --hugepages     Back large frame and scratch buffers with transparent huge pages.
+  --trace         Record decode, process and encode spans down to planes, tiles and
+                  executor tasks on every thread, and write them to this file as a
+                  Chrome trace (open in chrome://tracing or ui.perfetto.dev).
+  --metrics-file  Rewrite this file with live metrics in the Prometheus text format:
+                  per-node latency histograms, frames and bytes, packets in flight,
+                  queue depths and pool usage.
+  --metrics-interval
+                  Milliseconds between two rewrites of --metrics-file. (Optional, default: 1000)
+  --metrics-port  Serve the same metrics at http://127.0.0.1:<port>/metrics (Linux).
+  --memory-report Print live, peak and allocated heap bytes per subsystem (decoder,
+                  processor, encoder, pool, ffmpeg) once at the end of the job, or after
+                  every encoded frame with "--memory-report frame". Needs a build with
+                  premake5 --track-memory.
+  --precision     Accuracy of the 3x3 kernel in every CPU mode (Optional, default: exact):
+                    exact   float reference, integer kernels match it bit for bit
+                    fixed   16-bit fixed point, truncating; at most 1 below exact
+                    approx  byte averages (pavgb); at most 1 above exact, fastest
+  --isa           Vector kernels for simd, simd-threads and tiled modes: scalar, sse4.1,
+                  avx2 or avx512.
+                  (Optional, default: best one the CPU supports)
   --help, -h      Show this help message and exit.
 
 Processing Modes:
   default         Standard CPU processing (single-threaded)
   async           Asynchronous processing with background threads
   threads         Multi-threaded processing 
+  simd-threads    Row strips across all cores, each strip with the SIMD kernels
   gpu             GPU-accelerated processing using OpenGL/OpenCL
-  simd            SIMD-optimized processing using CPU vector instructions
+  simd            SIMD-optimized processing, kernels picked at startup from the CPU features
+  tiled           Cache-blocked in-place processing, tile bands spread across all cores
 
 Example:
   img_blur --input photo.jpeg --output photo_blurred.jpeg --mode simd
   img_blur -i photo.jpg -m gpu
+  cat photo.png | img_blur -i - -o - --format png --mode simd > photo_blurred.png
+  ffmpeg -i clip.mp4 -c:v rawvideo -f nut - | img_blur -i - -o - --format nut | ffplay -
   img_blur --input original.png --mode threads
+  img_blur --input scan.tiff --mode tiled --tile 512x16
+  img_blur --input photo.jpg --mode simd --sigma 4
+  img_blur --input photo.jpg --mode simd-threads -f "blur=sigma=2,sharpen=0.5,blur"
+  img_blur --input photo.jpg --mode simd --isa sse4.1
+  img_blur --input frame.png --mode simd --precision approx
+  img_blur --input clip.mp4 --mode threads --concurrent
+  img_blur --input clip.mkv --output clip_blurred.mp4 --mode simd-threads --concurrent
+  img_blur --input clip.mp4 --mode simd --concurrent --decode-threads 4 --encode-thread-type slice
+  img_blur --input scan_16k.png --mode simd-threads
+  img_blur --batch "photos/*.png" --output photos_blurred --mode threads
+  img_blur --serve /run/img_blur.sock --mode simd --jobs 8 --queue-size 128
+  img_blur --serve-shm /run/img_blur-shm.sock --mode simd-threads
+  img_blur --input clip.mp4 --mode simd-threads --concurrent --trace blur.trace.json
+  img_blur --batch photos/ --mode threads --metrics-file /var/lib/node_exporter/img_blur.prom
+  img_blur --input clip.mp4 --mode async --memory-report frame
 )";
 }
 
+void startTracing(const media_proc::CommandLineParser &parser) {
+    if(!parser.hasOption("--trace")) return;
+#ifndef DISABLE_TRACING
+    media_proc::Tracer::global().start();
+    TRACE_THREAD_NAME("main");
+#else
+    std::cerr << "Warning: built with --no-tracing, --trace is ignored\n";
+#endif
+}
+
+// Publishes the metrics registry while the job runs; nullptr when no export was requested
+std::unique_ptr<media_proc::MetricsExporter> startMetrics(const media_proc::CommandLineParser &parser) {
+    if(!parser.hasOption("--metrics-file") && !parser.hasOption("--metrics-port")) return nullptr;
+
+    media_proc::MetricsRegistry &registry = media_proc::MetricsRegistry::global();
+    registry.addCallback("img_blur_buffer_pool_in_use_bytes", "Bytes handed out by the buffer pool and not yet released", "",
+                         []() { return (double)media_proc::BufferPool::global().inUse(); });
+    registry.addCallback("img_blur_buffer_pool_peak_bytes", "Highest buffer pool usage so far", "",
+                         []() { return (double)media_proc::BufferPool::global().peakInUse(); });
+    registry.addCallback("img_blur_buffer_pool_cached_bytes", "Released buffer pool bytes kept for reuse", "",
+                         []() { return (double)media_proc::BufferPool::global().cachedBytes(); });
+    registry.addCallback("img_blur_frame_pool_cached_frames", "Frame shells kept for reuse", "",
+                         []() { return (double)media_proc::FramePool::global().cachedFrames(); });
+
+    auto exporter = std::make_unique<media_proc::MetricsExporter>();
+    if(parser.hasOption("--metrics-file")) {
+        int interval = std::max(100, parser.getIntOption("--metrics-interval", 1000));
+        exporter->startFile(parser.getOption("--metrics-file"), std::chrono::milliseconds(interval));
+    }
+    if(parser.hasOption("--metrics-port")) exporter->startHttp(parser.getIntOption("--metrics-port"));
+    return exporter;
+}
+
+bool startMemoryReport(const media_proc::CommandLineParser &parser) {
+    if(!parser.hasOption("--memory-report")) return true;
+    std::string when = parser.getOption("--memory-report");
+    if(when != "true" && when != "job" && when != "frame") {
+        std::cerr << "Error: --memory-report should be one of: [job, frame]\n";
+        return false;
+    }
+#ifdef TRACK_MEMORY
+    media_proc::MemoryProfiler::setFrameReports(when == "frame");
+#else
+    std::cerr << "Warning: built without --track-memory, --memory-report is ignored\n";
+#endif
+    return true;
+}
+
+void reportMemory(const media_proc::CommandLineParser &parser) {
+#ifdef TRACK_MEMORY
+    if(!parser.hasOption("--memory-report")) return;
+    media_proc::MemoryProfiler::report(std::cout, "job");
+#endif
+}
+
+void saveTrace(const media_proc::CommandLineParser &parser) {
+#ifndef DISABLE_TRACING
+    if(!parser.hasOption("--trace")) return;
+    std::string traceFile = parser.getOption("--trace");
+    media_proc::Tracer::global().stop();
+    if(media_proc::Tracer::global().save(traceFile)) std::cout << "[Trace] written to " << traceFile << "\n";
+    else std::cerr << "Error: cannot write trace file " << traceFile << "\n";
+#endif
+}
+
+media_proc::BlurOptions parseBlurOptions(const media_proc::CommandLineParser &parser) {
+    media_proc::BlurOptions blurOptions;
+    blurOptions.inPlace = parser.getBoolOption("--inplace");
+    blurOptions.tile.streamStores = parser.getBoolOption("--nt-stores");
+    blurOptions.sigma = std::strtof(parser.getOption("--sigma", "0").c_str(), nullptr);
+    blurOptions.radius = parser.getIntOption("--radius", 0);
+    blurOptions.threads = (unsigned int)std::max(0, parser.getIntOption("--threads", 0));
+    blurOptions.fuse = !parser.getBoolOption("--no-fuse");
+
+    if(parser.hasOption("--tile")) {
+        int tileWidth = 0, tileHeight = 0;
+        std::string tile = parser.getOption("--tile");
+        if(std::sscanf(tile.c_str(), "%dx%d", &tileWidth, &tileHeight) == 2 && tileWidth > 0 && tileHeight > 0) {
+            blurOptions.tile.width = tileWidth;
+            blurOptions.tile.height = tileHeight;
+        }
+        else std::cerr << "Warning: --tile should look like 256x32, using the default tile size\n";
+    }
+    return blurOptions;
+}
+
+// Reads --decode-threads/--encode-threads and their thread types; "auto" or no value means autoThreads
+bool parseCodecOptions(const media_proc::CommandLineParser &parser, unsigned int autoThreads, media_proc::CodecOptions &codecs) {
+    auto parseThreading = [&](const std::string &prefix, media_proc::CodecThreading &threading) {
+        std::string threads = parser.getOption("--" + prefix + "-threads", "auto");
+        if(threads == "auto") threading.threads = (int)autoThreads;
+        else {
+            threading.threads = std::atoi(threads.c_str());
+            if(threading.threads <= 0) {
+                std::cerr << "Error: --" << prefix << "-threads should be a positive number or auto\n";
+                return false;
+            }
+        }
+        if(parser.hasOption("--" + prefix + "-thread-type") && !media_proc::parseThreadTypes(parser.getOption("--" + prefix + "-thread-type"), threading.types)) {
+            std::cerr << "Error: --" << prefix << "-thread-type should be one of: [frame, slice, frame,slice]\n";
+            return false;
+        }
+        return true;
+    };
+    return parseThreading("decode", codecs.decoder) && parseThreading("encode", codecs.encoder);
+}
+
+int runBatch(const media_proc::CommandLineParser &parser, const std::string &pipelineMode, const media_proc::BlurOptions &blurOptions) {
+    media_proc::BatchOptions options;
+    options.outputDir = parser.getOption("--output", parser.getOption("-o", options.outputDir));
+    options.largeMode = pipelineMode;
+    // Small images run on single-threaded processors side by side, so the multi-threaded modes fall back there
+    options.smallMode = media_proc::singleThreadedMode(pipelineMode);
+    options.largeInputBytes = (uintmax_t)parser.getIntOption("--large-size", 2048) * 1024;
+    options.lanes = pipelineMode == "gpu" ? 1 : (unsigned int)std::max(0, parser.getIntOption("--jobs", 0));
+    options.concurrent = parser.getBoolOption("--concurrent");
+    options.queueDepth = parser.getIntOption("--queue-depth", 4);
+    // Lanes already keep every core busy, a large input has them all to its stages
+    unsigned int largeCodecThreads = media_proc::autoCodecThreads(media_proc::processorThreads(pipelineMode, blurOptions), options.concurrent);
+    if(!parseCodecOptions(parser, 1, options.smallCodecs) || !parseCodecOptions(parser, largeCodecThreads, options.largeCodecs)) return 1;
+
+    std::vector<std::string> inputs;
+    media_proc::BatchStats stats;
+    try {
+        inputs = media_proc::BatchRunner::collectInputs(parser.getOption("--batch"));
+        if(inputs.empty()) {
+            std::cerr << "Error: --batch matched no input files\n";
+            return 1;
+        }
+
+        media_proc::BatchRunner runner(options, [blurOptions](const std::string &mode) { return media_proc::createBlurProcessor(mode, blurOptions); });
+        stats = runner.run(inputs);
+    }
+    catch(const std::exception &e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+
+    std::cout << "[Batch] " << stats.processed << " images (" << stats.smallJobs << " small on " << stats.lanes << " lanes, "
+              << stats.largeJobs << " large, " << stats.failed << " failed) in " << stats.seconds << " s: "
+              << stats.imagesPerSecond() << " images/s\n";
+    return stats.failed ? 1 : 0;
+}
+
+static std::atomic<bool> g_StopServer{false};
+
+int runServer(const media_proc::CommandLineParser &parser, const std::string &pipelineMode, const media_proc::BlurOptions &blurOptions) {
+    media_proc::ServerOptions options;
+    options.socketPath = parser.getOption("--serve");
+    options.mode = pipelineMode;
+    options.lanes = (unsigned int)std::max(0, parser.getIntOption("--jobs", 0));
+    options.queueSize = (size_t)std::max(1, parser.getIntOption("--queue-size", 64));
+    options.concurrent = parser.getBoolOption("--concurrent");
+    options.queueDepth = parser.getIntOption("--queue-depth", 4);
+    // Lanes serve jobs side by side, their codecs stay on one thread each
+    if(!parseCodecOptions(parser, 1, options.codecs)) return 1;
+
+    std::signal(SIGINT, [](int) { g_StopServer.store(true); });
+    std::signal(SIGTERM, [](int) { g_StopServer.store(true); });
+
+    media_proc::BlurServer server(options, [blurOptions](const std::string &mode) { return media_proc::createBlurProcessor(mode, blurOptions); });
+    try { server.run(g_StopServer); }
+    catch(const std::exception &e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+int runFrameRingServer(const media_proc::CommandLineParser &parser, const std::string &pipelineMode, const media_proc::BlurOptions &blurOptions) {
+    media_proc::FrameRingServerOptions options;
+    options.socketPath = parser.getOption("--serve-shm");
+    options.mode = pipelineMode;
+
+    std::signal(SIGINT, [](int) { g_StopServer.store(true); });
+    std::signal(SIGTERM, [](int) { g_StopServer.store(true); });
+
+    media_proc::FrameRingServer server(options, [blurOptions](const std::string &mode) { return media_proc::createBlurProcessor(mode, blurOptions); });
+    try { server.run(g_StopServer); }
+    catch(const std::exception &e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
+
 int main(int argc, char* argv[]) {
     media_proc::CommandLineParser parser(argc, argv);
     if (parser.getOptCount() == 0 || parser.hasOption("--help") || parser.hasOption("-h")) { printHelp(); return 0; }
 
+    std::string pipelineMode = parser.getOption("--mode", "default");
+    if(pipelineMode == "default") pipelineMode = parser.getOption("-m", "default");
+
+    media_proc::BufferPool::global().setHugePages(parser.getBoolOption("--hugepages"));
+
+    if(parser.hasOption("--isa")) {
+        media_proc::kernels::Isa isa;
+        if(!media_proc::kernels::parseIsa(parser.getOption("--isa"), isa)) {
+            std::cerr << "Error: --isa should be one of: [scalar, sse4.1, avx2, avx512]\n";
+            return 1;
+        }
+        try { media_proc::kernels::selectIsa(isa); }
+        catch(const std::exception &e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    media_proc::BlurOptions blurOptions = parseBlurOptions(parser);
+    if(parser.hasOption("--precision")) {
+        if(!media_proc::kernels::parsePrecision(parser.getOption("--precision"), blurOptions.precision)) {
+            std::cerr << "Error: --precision should be one of: [exact, fixed, approx]\n";
+            return 1;
+        }
+        if(pipelineMode == "gpu" && blurOptions.precision != media_proc::kernels::Precision::Exact) {
+            std::cerr << "Error: gpu mode always computes in float, --precision " << parser.getOption("--precision") << " is not available\n";
+            return 1;
+        }
+    }
+    if(parser.hasOption("--filter") || parser.hasOption("-f")) {
+        try { blurOptions.filters = media_proc::parseFilterChain(parser.getOption("--filter", parser.getOption("-f"))); }
+        catch(const std::exception &e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+        if(!media_proc::supportsFilterChain(pipelineMode)) {
+            std::cerr << "Error: -f/--filter chains run in default, threads, simd, simd-threads and tiled modes\n";
+            return 1;
+        }
+        if(blurOptions.separable()) {
+            std::cerr << "Error: --sigma/--radius set the mode's blur, a -f chain takes blur=sigma=<s>:radius=<r> instead\n";
+            return 1;
+        }
+    }
+    if(pipelineMode == "gpu") {
+        // GL lives in a plugin loaded on demand; a build or host without it fails here, before any decoding
+        try { media_proc::loadGpuBackend(); }
+        catch(const std::exception &e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+    }
+    if(blurOptions.separable()) {
+        if(!media_proc::supportsGaussian(pipelineMode)) {
+            std::cerr << "Error: --sigma/--radius are supported in default, threads, simd and simd-threads modes\n";
+            return 1;
+        }
+        if(blurOptions.sigma < 0.0f || blurOptions.radius < 0 || blurOptions.radius > media_proc::kernels::GaussianKernel::MaxRadius
+           || (blurOptions.radius == 0 && blurOptions.sigma > media_proc::kernels::GaussianKernel::MaxRadius / 3.0f)) {
+            std::cerr << "Error: --sigma should be positive and --radius between 1 and " << media_proc::kernels::GaussianKernel::MaxRadius << "\n";
+            return 1;
+        }
+    }
+
+    if(!startMemoryReport(parser)) return 1;
+
+    // Kept until main returns, so the last rewrite of the file has the final totals
+    std::unique_ptr<media_proc::MetricsExporter> metrics;
+    try { metrics = startMetrics(parser); }
+    catch(const std::exception &e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+
+    if(parser.hasOption("--serve-shm")) {
+        if(!media_proc::isSupportedMode(pipelineMode)) {
+            std::cerr << "Error: --mode/-m should be one of: [default, async, threads, gpu, simd, simd-threads, tiled]\n"; 
+            return 1; 
+        }
+        startTracing(parser);
+        int result = runFrameRingServer(parser, pipelineMode, blurOptions);
+        saveTrace(parser);
+        reportMemory(parser);
+        return result;
+    }
+
+    if(parser.hasOption("--serve")) {
+        if(!media_proc::isSupportedMode(pipelineMode)) {
+            std::cerr << "Error: --mode/-m should be one of: [default, async, threads, gpu, simd, simd-threads, tiled]\n"; 
+            return 1; 
+        }
+        startTracing(parser);
+        int result = runServer(parser, pipelineMode, blurOptions);
+        saveTrace(parser);
+        reportMemory(parser);
+        return result;
+    }
+
+    if(parser.hasOption("--batch")) {
+        if(!media_proc::isSupportedMode(pipelineMode)) {
+            std::cerr << "Error: --mode/-m should be one of: [default, async, threads, gpu, simd, simd-threads, tiled]\n"; 
+            return 1; 
+        }
+        startTracing(parser);
+        int result = runBatch(parser, pipelineMode, blurOptions);
+        saveTrace(parser);
+        reportMemory(parser);
+        return result;
+    }
+
     std::string inputFilename;
     if (parser.hasOption("--input")) inputFilename = parser.getOption("--input");
     else if(parser.hasOption("-i")) inputFilename = parser.getOption("-i");
@@ -75,71 +478,68 @@ int main(int argc, char* argv[]) {
         return 1; 
     }
 
-    std::string outputFilename = "output" + inputFilename.substr(inputFilename.find_last_of('.'));
+    // Streaming from stdin writes to stdout unless told otherwise
+    size_t extension = inputFilename.find_last_of('.');
+    std::string outputFilename = inputFilename == "-" ? "-" : "output" + (extension == std::string::npos ? "" : inputFilename.substr(extension));
     if (parser.hasOption("--output")) outputFilename = parser.getOption("--output");
     else if(parser.hasOption("-o")) outputFilename = parser.getOption("-o");
 
-    std::string pipelineMode = parser.getOption("--mode", "default");
-    if(pipelineMode == "default") pipelineMode = parser.getOption("-m", "default");
+    std::string outputFormat = parser.getOption("--format");
+    if(outputFilename == "-") {
+        if(outputFormat.empty()) {
+            std::cerr << "Error: --format is required when writing to stdout (-o -)\n";
+            return 1;
+        }
+        // stdout carries the encoded stream, so every report goes to stderr
+        std::cout.rdbuf(std::cerr.rdbuf());
+    }
+
+    bool concurrent = parser.getBoolOption("--concurrent");
+    int queueDepth = parser.getIntOption("--queue-depth", 4);
 
-    std::unique_ptr<media_proc::PipelineNode> rootNode = nullptr;
-    
-    if(pipelineMode == "default") {
-      media_proc::Timer timer("Running pipeline with mode: default");
-
-      rootNode = std::make_unique<media_proc::FFmpegDecNode>(inputFilename);
-      std::unique_ptr<media_proc::PipelineNode> processor = std::make_unique<media_proc::BlurProcNode>();
-      std::unique_ptr<media_proc::PipelineNode> encoder = std::make_unique<media_proc::FFmpegEncNode>(outputFilename);
-      processor->setNext(std::move(encoder));
-      rootNode->setNext(std::move(processor));
-      rootNode->execute();
-    }
-    else if(pipelineMode == "async") {
-        media_proc::Timer timer("Running pipeline with mode: async");
-
-        rootNode = std::make_unique<media_proc::FFmpegDecNode>(inputFilename);
-        std::unique_ptr<media_proc::PipelineNode> processor = std::make_unique<media_proc::BlurAsyncProcNode>();
-        std::unique_ptr<media_proc::PipelineNode> encoder = std::make_unique<media_proc::FFmpegEncNode>(outputFilename);
-        processor->setNext(std::move(encoder));
-        rootNode->setNext(std::move(processor));
-        rootNode->execute();
-    }
-    else if(pipelineMode == "threads") {
-        media_proc::Timer timer("Running pipeline with mode: threads");
-
-        rootNode = std::make_unique<media_proc::FFmpegDecNode>(inputFilename);
-        std::unique_ptr<media_proc::PipelineNode> processor = std::make_unique<media_proc::BlurThreadProcNode>();
-        std::unique_ptr<media_proc::PipelineNode> encoder = std::make_unique<media_proc::FFmpegEncNode>(outputFilename);
-        processor->setNext(std::move(encoder));
-        rootNode->setNext(std::move(processor));
-        rootNode->execute();
-    }
-    else if(pipelineMode == "gpu") {
-        media_proc::Timer timer("Running pipeline with mode: gpu");
-
-        rootNode = std::make_unique<media_proc::FFmpegDecNode>(inputFilename);
-        std::unique_ptr<media_proc::PipelineNode> processor = std::make_unique<media_proc::BlurGPUProcNode>();
-        std::unique_ptr<media_proc::PipelineNode> encoder = std::make_unique<media_proc::FFmpegEncNode>(outputFilename);
-        processor->setNext(std::move(encoder));
-        rootNode->setNext(std::move(processor));
-        rootNode->execute();
-    }
-    else if(pipelineMode == "simd") {
-      #ifdef USE_SIMD
-        media_proc::Timer timer("Running pipeline with mode: SIMD");
-
-        rootNode = std::make_unique<media_proc::FFmpegDecNode>(inputFilename);
-        std::unique_ptr<media_proc::PipelineNode> processor = std::make_unique<media_proc::BlurSIMDProcNode>();
-        std::unique_ptr<media_proc::PipelineNode> encoder = std::make_unique<media_proc::FFmpegEncNode>(outputFilename);
-        processor->setNext(std::move(encoder));
-        rootNode->setNext(std::move(processor));
-        rootNode->execute();
-      #else 
-        std::cerr << "Error: --mode/-m simd is not supported\n"; 
-      #endif
+    std::unique_ptr<media_proc::PipelineNode> processor = media_proc::createBlurProcessor(pipelineMode, blurOptions);
+    if(!processor) {
+        std::cerr << "Error: --mode/-m should be one of: [default, async, threads, gpu, simd, simd-threads, tiled]\n"; 
+        return 1; 
     }
-    else { 
-        std::cerr << "Error: --mode/-m should be one of: [default, async, threads, gpu, simd]\n"; 
+    if(queueDepth <= 0) {
+        std::cerr << "Error: --queue-depth should be a positive number\n"; 
         return 1; 
     }
+    media_proc::CodecOptions codecs;
+    if(!parseCodecOptions(parser, media_proc::autoCodecThreads(media_proc::processorThreads(pipelineMode, blurOptions), concurrent), codecs)) return 1;
+
+    // The vector modes name the kernel level picked at startup (or with --isa)
+    std::string modeLabel = pipelineMode;
+    if(pipelineMode == "simd" || pipelineMode == "simd-threads" || pipelineMode == "tiled") {
+        modeLabel += std::string(" (") + media_proc::kernels::isaName(media_proc::kernels::activeKernels().isa) + ")";
+    }
+    if(blurOptions.inPlace) modeLabel += " (in-place)";
+    if(!blurOptions.filters.empty()) {
+        std::string runs;
+        for(const auto &run : media_proc::fuseFilters(blurOptions.filters, blurOptions.fuse)) {
+            std::string names;
+            for(const media_proc::FilterStage &filter : run) names += (names.empty() ? "" : ",") + filter.name;
+            runs += (runs.empty() ? "" : " | ") + names;
+        }
+        modeLabel += " (filters: " + runs + ")";
+    }
+    modeLabel += " (codec threads: decode " + std::to_string(codecs.decoder.threads) + " " + media_proc::threadTypesName(codecs.decoder.types)
+               + ", encode " + std::to_string(codecs.encoder.threads) + " " + media_proc::threadTypesName(codecs.encoder.types) + ")";
+
+    startTracing(parser);
+    media_proc::Timer timer("Running pipeline with mode: " + modeLabel + (concurrent ? " (concurrent)" : ""));
+
+    std::unique_ptr<media_proc::PipelineNode> rootNode = std::make_unique<media_proc::FFmpegDecNode>(inputFilename, codecs.decoder);
+    std::unique_ptr<media_proc::FFmpegEncNode> encoder = std::make_unique<media_proc::FFmpegEncNode>(outputFilename, codecs.encoder);
+    encoder->setFormat(outputFormat);
+    processor->tail().setNext(std::move(encoder));
+    rootNode->setNext(std::move(processor));
+
+    if(concurrent) rootNode->executeConcurrent(queueDepth);
+    else rootNode->execute();
+
+    timer.Stop();
+    saveTrace(parser);
+    reportMemory(parser);
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "BlurAsyncProcNode.h"
 
+#include "kernels/CpuDispatch.h"
+
 #include <algorithm>
 #include <future>
 #include <functional>
@@ -7,42 +9,48 @@
 
 namespace media_proc {
 
-    BlurAsyncProcNode::BlurAsyncProcNode() { }
+    BlurAsyncProcNode::BlurAsyncProcNode(const BlurOptions &options) : m_Options(options) { }
     BlurAsyncProcNode::~BlurAsyncProcNode() { }
 
     void BlurAsyncProcNode::blend(AVFrame* frame) {
-        media_proc::Timer timer("Running blur with mode: async");
+        TRACE_SPAN("blur async");
         if (!frame || !frame->data[0]) throw std::runtime_error("Invalid frame data");
         
         int width = frame->width;
         int height = frame->height;
         if (width <= 0 || height <= 0) throw std::runtime_error("Invalid frame dimensions");
         
-        unsigned int numCores = std::thread::hardware_concurrency();
+        unsigned int numCores = m_Options.threads ? m_Options.threads : std::thread::hardware_concurrency();
         if (numCores == 0) numCores = 4;
         
-        // Simple 3x3 Gaussian kernel
-        const float kernel[3][3] = {
-            {1.0f/16, 2.0f/16, 1.0f/16},
-            {2.0f/16, 4.0f/16, 2.0f/16},
-            {1.0f/16, 2.0f/16, 1.0f/16}
-        };
+        kernels::BlurRowFn blurRow = kernels::scalarKernels().blurRow(m_Options.precision);
         
         std::vector<std::future<void>> planeFutures;
         
-        for (int plane = 0; plane < m_PlaneCount; ++plane) {
-            if (!frame->data[plane]) continue;
-            
-            uint8_t* data = frame->data[plane];
-            int planeWidth = frame->linesize[plane];
-            int planeHeight = (plane > 0 ? height >> m_Log2ChromaHeight : height);
+        m_Layout.swapByteOrder(frame);
+        for (int index = 0; index < m_Layout.planeCount(); ++index) {
+            PlaneView plane = m_Layout.plane(frame, index);
+            if (!plane.data || plane.height <= 0) continue;
+
+            uint8_t* data = plane.data;
+            int planeWidth = plane.stride;
+            int planeHeight = plane.height;
+            int rowWidth = plane.width;
+            int step = plane.step;
             
-            if (planeWidth <= 0 || planeHeight <= 0) continue;
+            if (plane.type != kernels::SampleType::U8) {
+                kernels::blurPlaneWide(data, planeWidth, rowWidth, planeHeight, step, plane.type, plane.shift, kernels::scalarKernels().wide);
+                continue;
+            }
+            if (rowWidth < 2 * step + 1) continue;
             
-            // Create temporary buffer for this plane
-            std::vector<uint8_t> tempBuffer(planeWidth * planeHeight);
+            // Temporary buffer for this plane, recycled across frames. It is moved into the
+            // plane task so it stays alive until that task has finished
+            PooledBuffer tempBuffer = BufferPool::global().acquire(planeWidth * planeHeight);
             
-            planeFutures.emplace_back(std::async(std::launch::async, [=, &tempBuffer]() {
+            planeFutures.emplace_back(std::async(std::launch::async, [=, tempBuffer = std::move(tempBuffer)]() {
+                TRACE_SPAN_ARG("plane", "index", index);
+                uint8_t* temp = tempBuffer.data();
                 std::vector<std::future<void>> chunkFutures;
                 int chunkHeight = (planeHeight - 2) / numCores; // -2 to account for border
                 
@@ -50,23 +58,11 @@ namespace media_proc {
                     int startY = 1 + core * chunkHeight;
                     int endY = (core + 1 == numCores) ? planeHeight - 1 : startY + chunkHeight;
                     
-                    chunkFutures.emplace_back(std::async(std::launch::async, [=, &tempBuffer]() {
+                    chunkFutures.emplace_back(std::async(std::launch::async, [=]() {
+                        TRACE_SPAN_ARG("rows", "startY", startY);
                         for (int y = startY; y < endY; ++y) {
-                            for (int x = 1; x < planeWidth - 1; ++x) {
-                                float sum = 0.0f;
-                                
-                                // Apply 3x3 Gaussian kernel
-                                for (int ky = -1; ky <= 1; ++ky) {
-                                    for (int kx = -1; kx <= 1; ++kx) {
-                                        int srcY = y + ky;
-                                        int srcX = x + kx;
-                                        uint8_t pixel = data[srcY * planeWidth + srcX];
-                                        sum += pixel * kernel[ky + 1][kx + 1];
-                                    }
-                                }
-                                
-                                tempBuffer[y * planeWidth + x] = static_cast<uint8_t>(std::round(sum));
-                            }
+                            uint8_t* row = data + y * planeWidth;
+                            blurRow(row - planeWidth, row, row + planeWidth, temp + y * planeWidth, rowWidth, step);
                         }
                     }));
                 }
@@ -75,24 +71,22 @@ namespace media_proc {
                 for (auto& cf : chunkFutures) cf.get();
                 
                 // Copy blurred data back (excluding borders)
+                TRACE_SPAN("copy back");
                 for (int y = 1; y < planeHeight - 1; ++y) {
-                    for (int x = 1; x < planeWidth - 1; ++x) {
-                        data[y * planeWidth + x] = tempBuffer[y * planeWidth + x];
+                    for (int x = step; x < rowWidth - step; ++x) {
+                        data[y * planeWidth + x] = temp[y * planeWidth + x];
                     }
                 }
             }));
         }
         
+        TRACE_SPAN("wait for planes");
         for (auto& pf : planeFutures) pf.get();
+        m_Layout.swapByteOrder(frame);
     }
 
     void BlurAsyncProcNode::init(std::shared_ptr<const PipelineContext> context) {
-        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(context->pixelFormat);
-        if (desc) {
-            if (!(desc->flags & AV_PIX_FMT_FLAG_PLANAR)) m_PlaneCount = 1;
-            else m_PlaneCount = desc->nb_components;
-            m_Log2ChromaHeight = desc->log2_chroma_h;
-        }
+        m_Layout.init(context->pixelFormat);
     }
 
     std::unique_ptr<PipelinePacket> BlurAsyncProcNode::updatePacket(std::unique_ptr<PipelinePacket> packet) {
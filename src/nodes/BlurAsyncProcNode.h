@@ -14,12 +14,14 @@
 
 
 #include "base/Processor.h"
+#include "base/PixelLayout.h"
+#include "BlurOptions.h"
 
 namespace media_proc {
 
     class BlurAsyncProcNode : public Processor {
     public:
-        BlurAsyncProcNode();
+        BlurAsyncProcNode(const BlurOptions &options = {});
         ~BlurAsyncProcNode();
         
     private:
@@ -30,8 +32,8 @@ namespace media_proc {
         virtual std::unique_ptr<PipelinePacket> updatePacket(std::unique_ptr<PipelinePacket> packet) override;
                         
     private:
-        int m_PlaneCount = -1;
-        int m_Log2ChromaHeight = 0;
+        BlurOptions m_Options;
+        PixelLayout m_Layout;
     };
 }
 
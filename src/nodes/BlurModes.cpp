@@ -0,0 +1,62 @@
+#include "BlurModes.h"
+
+#include "BlurProcNode.h"
+#include "BlurAsyncProcNode.h"
+#include "BlurThreadProcNode.h"
+#include "GpuBackend.h"
+#include "BlurSIMDProcNode.h"
+#include "BlurTiledProcNode.h"
+#include "FilterChain.h"
+
+#include "kernels/CpuDispatch.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace media_proc {
+
+    const std::vector<std::string>& blurModes() {
+        static const std::vector<std::string> modes = { "default", "async", "threads", "gpu", "simd", "simd-threads", "tiled" };
+        return modes;
+    }
+
+    bool isSupportedMode(const std::string &mode) {
+        const std::vector<std::string> &modes = blurModes();
+        return std::find(modes.begin(), modes.end(), mode) != modes.end();
+    }
+
+    static std::unique_ptr<PipelineNode> createNode(const std::string &mode, const BlurOptions &options) {
+        if(mode == "default") return std::make_unique<BlurProcNode>(options);
+        if(mode == "async") return std::make_unique<BlurAsyncProcNode>(options);
+        if(mode == "threads") return std::make_unique<BlurThreadProcNode>(options);
+        if(mode == "simd-threads") return std::make_unique<BlurThreadProcNode>(options, kernels::activeKernels());
+        if(mode == "gpu") return createGpuProcessor();
+        if(mode == "tiled") return std::make_unique<BlurTiledProcNode>(options);
+        if(mode == "simd") return std::make_unique<BlurSIMDProcNode>(options);
+        return nullptr;
+    }
+
+    std::unique_ptr<PipelineNode> createBlurProcessor(const std::string &mode, const BlurOptions &options) {
+        // A -f chain names its nodes after their filters
+        if(!options.filters.empty()) return createFilterChain(mode, options);
+
+        std::unique_ptr<PipelineNode> node = createNode(mode, options);
+        if(node) node->setName("blur " + mode);
+        return node;
+    }
+
+    bool supportsGaussian(const std::string &mode) {
+        return mode == "default" || mode == "threads" || mode == "simd" || mode == "simd-threads";
+    }
+
+    std::string singleThreadedMode(const std::string &mode) {
+        if(mode == "threads" || mode == "async" || mode == "tiled") return "default";
+        if(mode == "simd-threads") return "simd";
+        return mode;
+    }
+
+    unsigned int processorThreads(const std::string &mode, const BlurOptions &options) {
+        if(singleThreadedMode(mode) == mode) return 1;
+        return options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    }
+}
\ No newline at end of file
@@ -0,0 +1,42 @@
+/*
+ * Blur Modes
+ * ==========
+ *
+ * Registry of the processing modes: their names and the processor node each
+ * one creates. The tool and the benchmark both go through it, so a new mode
+ * only has to be added here.
+ *
+ * Author: Finoshkin Aleksei
+ * License: MIT
+ */
+
+#ifndef IMG_DEINT_BLUR_MODES_H
+#define IMG_DEINT_BLUR_MODES_H
+
+
+#include "base/Pipeline.h"
+#include "BlurOptions.h"
+
+namespace media_proc {
+
+    // Mode names in the order --help lists them
+    const std::vector<std::string>& blurModes();
+
+    bool isSupportedMode(const std::string &mode);
+
+    // nullptr for an unknown mode. With options.filters the result is the head of a chain of
+    // nodes, see FilterChain.h: link the next node to its tail().
+    std::unique_ptr<PipelineNode> createBlurProcessor(const std::string &mode, const BlurOptions &options);
+
+    // The GPU shader, the async node and the tiled engine only implement the 3x3 kernel
+    bool supportsGaussian(const std::string &mode);
+
+    // Mode to run when the caller already keeps every core busy; the mode itself when it is single-threaded
+    std::string singleThreadedMode(const std::string &mode);
+
+    // Cores the mode's processor keeps busy, for sharing them with the codecs
+    unsigned int processorThreads(const std::string &mode, const BlurOptions &options);
+}
+
+
+#endif //!IMG_DEINT_BLUR_MODES_H
@@ -0,0 +1,58 @@
+/*
+ * Blur Options
+ * ============
+ * 
+ * Settings shared by the blur processor nodes, filled from the command line.
+ * 
+ * Author: Finoshkin Aleksei
+ * License: MIT
+ */
+
+#ifndef IMG_DEINT_BLUR_OPTIONS_H
+#define IMG_DEINT_BLUR_OPTIONS_H
+
+
+#include "kernels/TiledBlur.h"
+#include "kernels/StencilChain.h"
+
+#include <string>
+#include <vector>
+
+namespace media_proc {
+
+    // One filter of a -f chain, named as written on the command line, e.g. "sharpen=0.5"
+    struct FilterStage {
+        std::string name;
+        kernels::Stencil stencil;
+    };
+
+    struct BlurOptions {
+        // Blur each plane in place through a rolling line buffer (O(width) scratch)
+        // instead of a full-plane temp copy followed by a copy-back pass
+        bool inPlace = false;
+
+        // Accuracy tier of the 3x3 kernel, the same output in every CPU mode
+        kernels::Precision precision = kernels::Precision::Exact;
+
+        // Tile geometry and store policy of the tiled mode
+        kernels::TileConfig tile;
+
+        // Separable Gaussian instead of the fixed 3x3 kernel when either is positive
+        float sigma = 0.0f;
+        int radius = 0;
+
+        // Worker threads of the multi-threaded modes, 0 = one per core
+        unsigned int threads = 0;
+
+        // Filters of -f in order, run instead of the mode's single blur when not empty
+        std::vector<FilterStage> filters;
+
+        // Let the fusion pass merge adjacent filters into one sweep per plane (off with --no-fuse)
+        bool fuse = true;
+
+        bool separable() const { return sigma > 0.0f || radius > 0; }
+    };
+}
+
+
+#endif //!IMG_DEINT_BLUR_OPTIONS_H
@@ -1,74 +1,83 @@
 #include "BlurProcNode.h"
 
+#include "kernels/CpuDispatch.h"
+
+#include <algorithm>
+#include <cstring>
+
 namespace media_proc {
 
-    BlurProcNode::BlurProcNode() { }
+    BlurProcNode::BlurProcNode(const BlurOptions &options) : m_Options(options) {
+        if (m_Options.separable()) m_Gaussian = kernels::GaussianKernel::create(m_Options.sigma, m_Options.radius);
+    }
     BlurProcNode::~BlurProcNode() { 
         
     }
 
     void BlurProcNode::blend(AVFrame* frame) {
-        media_proc::Timer timer("Running blur with mode: default");
+        TRACE_SPAN("blur default");
         if (!frame || !frame->data[0]) throw std::runtime_error("Invalid frame data");
         
         int width = frame->width;
         int height = frame->height;
         if (width <= 0 || height <= 0) throw std::runtime_error("Invalid frame dimensions");
+
+        kernels::BlurRowFn blurRow = kernels::scalarKernels().blurRow(m_Options.precision);
         
-        // Simple 3x3 Gaussian kernel
-        const float kernel[3][3] = {
-            {1.0f/16, 2.0f/16, 1.0f/16},
-            {2.0f/16, 4.0f/16, 2.0f/16},
-            {1.0f/16, 2.0f/16, 1.0f/16}
-        };
-        
-        for (int plane = 0; plane < m_PlaneCount; ++plane) {
-            if (!frame->data[plane]) continue;
-            
-            uint8_t* data = frame->data[plane];
-            int planeWidth = frame->linesize[plane];
-            int planeHeight = (plane > 0 ? height >> m_Log2ChromaHeight : height);
-            
-            if (planeWidth <= 0 || planeHeight <= 0) continue;
+        m_Layout.swapByteOrder(frame);
+        for (int index = 0; index < m_Layout.planeCount(); ++index) {
+            PlaneView plane = m_Layout.plane(frame, index);
+            if (!plane.data || plane.height <= 0) continue;
+            TRACE_SPAN_ARG("plane", "index", index);
+
+            uint8_t* data = plane.data;
+            int planeWidth = plane.stride;
+            int planeHeight = plane.height;
+            int rowWidth = plane.width;
+            int step = plane.step;
+
+            if (plane.type != kernels::SampleType::U8) {
+                kernels::blurPlaneWide(data, planeWidth, rowWidth, planeHeight, step, plane.type, plane.shift, kernels::scalarKernels().wide);
+                continue;
+            }
+
+            if (m_Gaussian.radius > 0) {
+                // Edges are clamped, so only the pixels of the row may take part, not the linesize padding
+                PooledBuffer scratch = BufferPool::global().acquire(kernels::separableScratchSize(rowWidth, m_Gaussian.radius, step));
+                kernels::blurRowsSeparable(data, planeWidth, rowWidth, planeHeight, step, 0, planeHeight, nullptr, nullptr, m_Gaussian, scratch.data(), kernels::gaussianTapsScalar);
+                continue;
+            }
+
+            if (rowWidth < 2 * step + 1) continue;
+
+            if (m_Options.inPlace) {
+                // Two rows of original pixels are enough to blur the plane over itself
+                PooledBuffer scratch = BufferPool::global().acquire(kernels::inPlaceScratchSize(rowWidth));
+                kernels::blurRowsInPlace(data, planeWidth, rowWidth, step, 1, planeHeight - 1, nullptr, nullptr, scratch.data(), blurRow);
+                continue;
+            }
             
-            // Create temporary buffer for this plane
-            std::vector<uint8_t> tempBuffer(planeWidth * planeHeight);
+            // Temporary buffer for this plane, recycled across frames
+            PooledBuffer tempBuffer = BufferPool::global().acquire(planeWidth * planeHeight);
+            uint8_t* temp = tempBuffer.data();
             
             // Apply Gaussian blur (skip borders to avoid out-of-bounds access)
             for (int y = 1; y < planeHeight - 1; ++y) {
-                for (int x = 1; x < planeWidth - 1; ++x) {
-                    float sum = 0.0f;
-                    
-                    // Apply 3x3 Gaussian kernel
-                    for (int ky = -1; ky <= 1; ++ky) {
-                        for (int kx = -1; kx <= 1; ++kx) {
-                            int srcY = y + ky;
-                            int srcX = x + kx;
-                            uint8_t pixel = data[srcY * planeWidth + srcX];
-                            sum += pixel * kernel[ky + 1][kx + 1];
-                        }
-                    }
-                    
-                    tempBuffer[y * planeWidth + x] = static_cast<uint8_t>(std::round(sum));
-                }
+                uint8_t* row = data + y * planeWidth;
+                blurRow(row - planeWidth, row, row + planeWidth, temp + y * planeWidth, rowWidth, step);
             }
             
-            // Copy blurred data back (excluding borders)
+            // Copy blurred data back (excluding the first and last pixel of every channel)
             for (int y = 1; y < planeHeight - 1; ++y) {
-                for (int x = 1; x < planeWidth - 1; ++x) {
-                    data[y * planeWidth + x] = tempBuffer[y * planeWidth + x];
-                }
+                std::memcpy(data + y * planeWidth + step, temp + y * planeWidth + step, rowWidth - 2 * step);
             }
         }
+        m_Layout.swapByteOrder(frame);
     }
 
     void BlurProcNode::init(std::shared_ptr<const PipelineContext> context) {
-        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(context->pixelFormat);
-        if (desc) {
-           if (!(desc->flags & AV_PIX_FMT_FLAG_PLANAR)) m_PlaneCount = 1;
-           else m_PlaneCount = desc->nb_components;
-           m_Log2ChromaHeight = desc->log2_chroma_h;
-        }
+        m_Layout.init(context->pixelFormat);
+        if (m_Gaussian.radius > 0 && m_Layout.hasWideSamples()) throw std::runtime_error("Gaussian blur supports 8-bit samples only");
     }
 
     std::unique_ptr<PipelinePacket> BlurProcNode::updatePacket(std::unique_ptr<PipelinePacket> packet) {
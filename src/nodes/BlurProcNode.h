@@ -14,12 +14,15 @@
 
 
 #include "base/Processor.h"
+#include "base/PixelLayout.h"
+#include "BlurOptions.h"
+#include "kernels/GaussianBlur.h"
 
 namespace media_proc {
 
     class BlurProcNode : public Processor {
     public:
-        BlurProcNode();
+        BlurProcNode(const BlurOptions &options = {});
         ~BlurProcNode();
         
     private:
@@ -30,8 +33,9 @@ namespace media_proc {
         virtual std::unique_ptr<PipelinePacket> updatePacket(std::unique_ptr<PipelinePacket> packet) override;
         
     private:
-        int m_PlaneCount = -1;
-        int m_Log2ChromaHeight = 0;
+        BlurOptions m_Options;
+        kernels::GaussianKernel m_Gaussian;
+        PixelLayout m_Layout;
     };
 }
 
@@ -1,18 +1,23 @@
 #include "BlurSIMDProcNode.h"
 
-#ifdef USE_SIMD
+#include "kernels/CpuDispatch.h"
 
-#include <immintrin.h> // AVX2
+#include <algorithm>
+#include <cstring>
 
 namespace media_proc {
 
-    BlurSIMDProcNode::BlurSIMDProcNode() { }
+    BlurSIMDProcNode::BlurSIMDProcNode(const BlurOptions &options) : m_Options(options) {
+        if (m_Options.separable()) m_Gaussian = kernels::GaussianKernel::create(m_Options.sigma, m_Options.radius);
+    }
     BlurSIMDProcNode::~BlurSIMDProcNode() { 
         
     }
 
     void BlurSIMDProcNode::blend(AVFrame* frame) {
-        media_proc::Timer timer("Running blur with mode: SIMD");
+        const kernels::KernelSet &simd = kernels::activeKernels();
+        kernels::BlurRowFn blurRow = simd.blurRow(m_Options.precision);
+        TRACE_SPAN("blur simd");
         if (!frame || !frame->data[0])
             throw std::runtime_error("Invalid frame data");
         
@@ -21,90 +26,46 @@ namespace media_proc {
         if (width <= 0 || height <= 0)
             throw std::runtime_error("Invalid frame dimensions");
         
-        constexpr int SIMD_WIDTH = 32; // AVX2 processes 32 uint8_t per vector
-        
-        // Gaussian kernel weights scaled by 256 for integer math
-        // [1/16, 2/16, 1/16; 2/16, 4/16, 2/16; 1/16, 2/16, 1/16] * 256
-        const uint16_t kernelWeights[9] = {16, 32, 16, 32, 64, 32, 16, 32, 16};
-        
-        for (int plane = 0; plane < m_PlaneCount; ++plane) {
-            if (!frame->data[plane]) continue;
-            
-            uint8_t* data = frame->data[plane];
-            int stride = frame->linesize[plane];
-            int planeHeight = (plane > 0 ? height >> m_Log2ChromaHeight : height);
-            int planeWidth = stride;
-            
-            if (stride <= 0 || planeHeight <= 2) continue;
+        m_Layout.swapByteOrder(frame);
+        for (int index = 0; index < m_Layout.planeCount(); ++index) {
+            PlaneView plane = m_Layout.plane(frame, index);
+            if (!plane.data || plane.height <= 0) continue;
+            TRACE_SPAN_ARG("plane", "index", index);
+
+            uint8_t* data = plane.data;
+            int stride = plane.stride;
+            int planeHeight = plane.height;
+            int rowWidth = plane.width;
+            int step = plane.step;
+
+            // Wide samples have a single exact tier, always blurred in place
+            if (plane.type != kernels::SampleType::U8) {
+                kernels::blurPlaneWide(data, stride, rowWidth, planeHeight, step, plane.type, plane.shift, simd.wide);
+                continue;
+            }
+
+            if (m_Gaussian.radius > 0) {
+                PooledBuffer scratch = BufferPool::global().acquire(kernels::separableScratchSize(rowWidth, m_Gaussian.radius, step));
+                kernels::blurRowsSeparable(data, stride, rowWidth, planeHeight, step, 0, planeHeight, nullptr, nullptr, m_Gaussian, scratch.data(), simd.gaussianTaps);
+                continue;
+            }
+
+            if (rowWidth < 2 * step + 1) continue;
+
+            if (m_Options.inPlace) {
+                // Two rows of original pixels are enough to blur the plane over itself
+                PooledBuffer scratch = BufferPool::global().acquire(kernels::inPlaceScratchSize(rowWidth));
+                kernels::blurRowsInPlace(data, stride, rowWidth, step, 1, planeHeight - 1, nullptr, nullptr, scratch.data(), blurRow);
+                continue;
+            }
             
-            // Create temporary buffer for this plane
-            std::vector<uint8_t> tempBuffer(stride * planeHeight);
+            // Temporary buffer for this plane, recycled across frames
+            PooledBuffer tempBuffer = BufferPool::global().acquire(stride * planeHeight);
             
             // Process rows (skip first and last row to avoid bounds checking)
             for (int y = 1; y < planeHeight - 1; ++y) {
                 uint8_t* curr = data + y * stride;
-                uint8_t* prev = data + (y - 1) * stride;
-                uint8_t* next = data + (y + 1) * stride;
-                uint8_t* dst = tempBuffer.data() + y * stride;
-                
-                int x = 1; // Start at x=1 to skip left border
-                
-                // SIMD processing for bulk of the row
-                for (; x <= width - SIMD_WIDTH - 1 && x <= planeWidth - SIMD_WIDTH - 1; x += SIMD_WIDTH) {
-                    // Load 3x3 neighborhood for 32 pixels
-                    __m256i sum_lo = _mm256_setzero_si256();
-                    __m256i sum_hi = _mm256_setzero_si256();
-                    
-                    // Process 3x3 kernel
-                    for (int ky = -1; ky <= 1; ++ky) {
-                        uint8_t* row = (ky == -1) ? prev : (ky == 0) ? curr : next;
-                        
-                        for (int kx = -1; kx <= 1; ++kx) {
-                            int kernelIdx = (ky + 1) * 3 + (kx + 1);
-                            uint16_t weight = kernelWeights[kernelIdx];
-                            
-                            // Load 32 pixels
-                            __m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + x + kx));
-                            
-                            // Convert to 16-bit for multiplication
-                            __m256i pixels_lo = _mm256_unpacklo_epi8(pixels, _mm256_setzero_si256());
-                            __m256i pixels_hi = _mm256_unpackhi_epi8(pixels, _mm256_setzero_si256());
-                            
-                            // Multiply by kernel weight
-                            __m256i weight_vec = _mm256_set1_epi16(weight);
-                            pixels_lo = _mm256_mullo_epi16(pixels_lo, weight_vec);
-                            pixels_hi = _mm256_mullo_epi16(pixels_hi, weight_vec);
-                            
-                            // Accumulate
-                            sum_lo = _mm256_add_epi16(sum_lo, pixels_lo);
-                            sum_hi = _mm256_add_epi16(sum_hi, pixels_hi);
-                        }
-                    }
-                    
-                    // Divide by 256 (shift right by 8) and pack back to uint8_t
-                    sum_lo = _mm256_srli_epi16(sum_lo, 8);
-                    sum_hi = _mm256_srli_epi16(sum_hi, 8);
-                    __m256i result = _mm256_packus_epi16(sum_lo, sum_hi);
-                    
-                    // Store result
-                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x), result);
-                }
-                
-                // Fallback for remaining pixels
-                for (; x < width - 1 && x < planeWidth - 1; ++x) {
-                    uint32_t sum = 0;
-                    
-                    // Apply 3x3 Gaussian kernel
-                    for (int ky = -1; ky <= 1; ++ky) {
-                        for (int kx = -1; kx <= 1; ++kx) {
-                            int kernelIdx = (ky + 1) * 3 + (kx + 1);
-                            uint8_t* row = (ky == -1) ? prev : (ky == 0) ? curr : next;
-                            sum += row[x + kx] * kernelWeights[kernelIdx];
-                        }
-                    }
-                    
-                    dst[x] = static_cast<uint8_t>(sum >> 8); // Divide by 256
-                }
+                blurRow(curr - stride, curr, curr + stride, tempBuffer.data() + y * stride, rowWidth, step);
             }
             
             // Copy blurred data back (excluding borders)
@@ -113,24 +74,19 @@ namespace media_proc {
                 uint8_t* dst = data + y * stride;
                 
                 // Copy the processed pixels (skip first and last pixel of each row)
-                std::memcpy(dst + 1, src + 1, std::min(width, planeWidth) - 2);
+                std::memcpy(dst + step, src + step, rowWidth - 2 * step);
             }
         }
+        m_Layout.swapByteOrder(frame);
     }
 
     void BlurSIMDProcNode::init(std::shared_ptr<const PipelineContext> context) {
-        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(context->pixelFormat);
-        if (desc) {
-           if (!(desc->flags & AV_PIX_FMT_FLAG_PLANAR)) m_PlaneCount = 1;
-           else m_PlaneCount = desc->nb_components;
-           m_Log2ChromaHeight = desc->log2_chroma_h;
-        }
+        m_Layout.init(context->pixelFormat);
+        if (m_Gaussian.radius > 0 && m_Layout.hasWideSamples()) throw std::runtime_error("Gaussian blur supports 8-bit samples only");
     }
 
     std::unique_ptr<PipelinePacket> BlurSIMDProcNode::updatePacket(std::unique_ptr<PipelinePacket> packet) {
         if(packet) blend(packet->frame);
         return std::move(packet);
     };
-}
-
-#endif
\ No newline at end of file
+}
\ No newline at end of file
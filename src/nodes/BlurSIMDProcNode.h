@@ -12,15 +12,17 @@
 #ifndef IMG_DEINT_SIMD_PROCESSOR_NODE_H
 #define IMG_DEINT_SIMD_PROCESSOR_NODE_H
 
-#ifdef USE_SIMD
 
 #include "base/Processor.h"
+#include "base/PixelLayout.h"
+#include "BlurOptions.h"
+#include "kernels/GaussianBlur.h"
 
 namespace media_proc {
 
     class BlurSIMDProcNode : public Processor {
     public:
-        BlurSIMDProcNode();
+        BlurSIMDProcNode(const BlurOptions &options = {});
         ~BlurSIMDProcNode();
         
     private:
@@ -31,11 +33,11 @@ namespace media_proc {
         virtual std::unique_ptr<PipelinePacket> updatePacket(std::unique_ptr<PipelinePacket> packet) override;
         
     private:
-        int m_PlaneCount = -1;
-        int m_Log2ChromaHeight = 0;
+        BlurOptions m_Options;
+        kernels::GaussianKernel m_Gaussian;
+        PixelLayout m_Layout;
     };
 }
 
-#endif
 
 #endif //!IMG_DEINT_SIMD_PROCESSOR_NODE_H
\ No newline at end of file
@@ -2,93 +2,192 @@
 
 #include <vector>
 #include <thread>
+#include <algorithm>
 
 
 namespace media_proc {
 
-    BlurThreadProcNode::BlurThreadProcNode() : m_Pool(std::thread::hardware_concurrency()) { }
+    BlurThreadProcNode::BlurThreadProcNode(const BlurOptions &options, const kernels::KernelSet &kernels)
+        : m_Executor(Executor::withThreads(options.threads)), m_Options(options), m_Kernels(kernels) {
+        if (m_Options.separable()) m_Gaussian = kernels::GaussianKernel::create(m_Options.sigma, m_Options.radius);
+    }
     BlurThreadProcNode::~BlurThreadProcNode() { }
 
+    void BlurThreadProcNode::blendPlane(TaskGroup &frameDone, TaskGroup &planeDone, PooledBuffer &scratch, const PlaneView &plane) {
+        uint8_t* data = plane.data;
+        int planeWidth = plane.stride;
+        int planeHeight = plane.height;
+        int rowWidth = plane.width;
+        int step = plane.step;
+
+        // Temporary buffer for this plane, recycled across frames
+        scratch = BufferPool::global().acquire(planeWidth * planeHeight);
+        uint8_t* temp = scratch.data();
+        Executor* executor = &m_Executor;
+        kernels::BlurRowFn blurRow = m_Kernels.blurRow(m_Options.precision);
+
+        // Blur rows (skip first and last row for border safety)
+        m_Executor.parallelFor(planeDone, 1, planeHeight - 1, [=](size_t begin, size_t end) {
+            for (size_t y = begin; y < end; ++y) {
+                uint8_t* curr = data + y * planeWidth;
+                blurRow(curr - planeWidth, curr, curr + planeWidth, temp + y * planeWidth, rowWidth, step);
+            }
+        });
+
+        // Copy blurred data back as soon as this plane's blur pass is done, other planes may still be blurring.
+        // Chained after the blur was submitted, so a submission that throws never leaves frameDone pending.
+        planeDone.then(&frameDone, [=, &frameDone]() {
+            executor->parallelFor(frameDone, 1, planeHeight - 1, [=](size_t begin, size_t end) {
+                for (size_t y = begin; y < end; ++y) {
+                    // Copy the processed pixels (skip first and last pixel of each row)
+                    std::memcpy(data + y * planeWidth + step, temp + y * planeWidth + step, rowWidth - 2 * step);
+                }
+            });
+        });
+        planeDone.close();
+    }
+
+    void BlurThreadProcNode::blendPlaneInPlace(TaskGroup &frameDone, PooledBuffer &scratch, const PlaneView &plane) {
+        uint8_t* data = plane.data;
+        int planeWidth = plane.stride;
+        int planeHeight = plane.height;
+        int rowWidth = plane.width;
+        int step = plane.step;
+        kernels::SampleType type = plane.type;
+        int shift = plane.shift;
+        int rowBytes = rowWidth * kernels::sampleSize(type);
+
+        int rows = planeHeight - 2;
+        int strips = std::max(1, std::min<int>((int)m_Executor.size(), rows));
+        int stripHeight = (rows + strips - 1) / strips;
+        strips = (rows + stripHeight - 1) / stripHeight;
+
+        // Per strip: original halo rows above and below it, then the two-row ring buffer
+        int stripScratch = 2 * rowBytes + kernels::inPlaceScratchSize(rowBytes);
+        scratch = BufferPool::global().acquire((size_t)strips * stripScratch);
+        uint8_t* halos = scratch.data();
+        kernels::BlurRowFn blurRow = m_Kernels.blurRow(m_Options.precision);
+        const kernels::WideKernels* wide = &m_Kernels.wide;
+
+        // Neighbouring strips overwrite each other's halo rows, so snapshot all of them first
+        for (int strip = 0; strip < strips; ++strip) {
+            int startY = 1 + strip * stripHeight;
+            int endY = std::min(startY + stripHeight, planeHeight - 1);
+
+            uint8_t* halo = halos + (size_t)strip * stripScratch;
+            std::memcpy(halo, data + (startY - 1) * planeWidth, rowBytes);
+            std::memcpy(halo + rowBytes, data + endY * planeWidth, rowBytes);
+        }
+
+        m_Executor.parallelFor(frameDone, 0, strips, [=](size_t begin, size_t end) {
+            for (size_t strip = begin; strip < end; ++strip) {
+                int startY = 1 + (int)strip * stripHeight;
+                int endY = std::min(startY + stripHeight, planeHeight - 1);
+
+                uint8_t* halo = halos + strip * stripScratch;
+                if (type == kernels::SampleType::U8) {
+                    kernels::blurRowsInPlace(data, planeWidth, rowWidth, step, startY, endY, halo, halo + rowBytes, halo + 2 * rowBytes, blurRow);
+                }
+                else {
+                    kernels::blurRowsInPlaceWide(data, planeWidth, rowWidth, step, type, shift, startY, endY, halo, halo + rowBytes, halo + 2 * rowBytes, *wide);
+                }
+            }
+        }, 1);
+    }
+
+    void BlurThreadProcNode::blendPlaneSeparable(TaskGroup &frameDone, PooledBuffer &scratch, const PlaneView &plane) {
+        uint8_t* data = plane.data;
+        int stride = plane.stride;
+        int planeHeight = plane.height;
+        int rowBytes = plane.width;
+        int step = plane.step;
+
+        int radius = m_Gaussian.radius;
+        int strips = std::max(1, std::min<int>((int)m_Executor.size(), planeHeight));
+        int stripHeight = (planeHeight + strips - 1) / strips;
+        strips = (planeHeight + stripHeight - 1) / stripHeight;
+
+        // Per strip: `radius` original rows above and below it, then the row ring and padded line
+        size_t haloBytes = (size_t)radius * rowBytes;
+        size_t stripScratch = 2 * haloBytes + kernels::separableScratchSize(rowBytes, radius, step);
+        scratch = BufferPool::global().acquire(strips * stripScratch);
+        uint8_t* halos = scratch.data();
+
+        // Neighbouring strips overwrite each other's halo rows, so snapshot all of them first
+        for (int strip = 0; strip < strips; ++strip) {
+            int startY = strip * stripHeight;
+            int endY = std::min(startY + stripHeight, planeHeight);
+
+            uint8_t* halo = halos + strip * stripScratch;
+            for (int k = 0; k < radius; ++k) {
+                std::memcpy(halo + k * rowBytes, data + std::max(startY - radius + k, 0) * stride, rowBytes);
+                std::memcpy(halo + haloBytes + k * rowBytes, data + std::min(endY + k, planeHeight - 1) * stride, rowBytes);
+            }
+        }
+
+        const kernels::GaussianKernel* gaussian = &m_Gaussian;
+        kernels::GaussianTapsFn gaussianTaps = m_Kernels.gaussianTaps;
+        m_Executor.parallelFor(frameDone, 0, strips, [=](size_t begin, size_t end) {
+            for (size_t strip = begin; strip < end; ++strip) {
+                int startY = (int)strip * stripHeight;
+                int endY = std::min(startY + stripHeight, planeHeight);
+
+                uint8_t* halo = halos + strip * stripScratch;
+                kernels::blurRowsSeparable(data, stride, rowBytes, planeHeight, step, startY, endY, halo, halo + haloBytes, *gaussian,
+                                           halo + 2 * haloBytes, gaussianTaps);
+            }
+        }, 1);
+    }
+
     void BlurThreadProcNode::blend(AVFrame* frame) {
-        media_proc::Timer timer("Running blur with mode: threads");
+        TRACE_SPAN(m_Kernels.isa == kernels::Isa::Scalar ? "blur threads" : "blur simd-threads");
         if (!frame || !frame->data[0]) throw std::runtime_error("Invalid frame data");
         
         int width = frame->width;
         int height = frame->height;
         if (width <= 0 || height <= 0) throw std::runtime_error("Invalid frame dimensions");
-        
-        // Simple 3x3 Gaussian kernel
-        const float kernel[3][3] = {
-            {1.0f/16, 2.0f/16, 1.0f/16},
-            {2.0f/16, 4.0f/16, 2.0f/16},
-            {1.0f/16, 2.0f/16, 1.0f/16}
-        };
-        
-        for (int plane = 0; plane < m_PlaneCount; ++plane) {
-            if (!frame->data[plane]) continue;
-            
-            uint8_t* data = frame->data[plane];
-            int planeWidth = frame->linesize[plane];
-            int planeHeight = (plane > 0 ? height >> m_Log2ChromaHeight : height);
-            
-            if (planeWidth <= 0 || planeHeight <= 2) continue;
-            
-            // Create temporary buffer for this plane - shared among threads
-            auto tempBuffer = std::make_shared<std::vector<uint8_t>>(planeWidth * planeHeight);
-            
-            // Process each row (skip first and last row for border safety)
-            for (int y = 1; y < planeHeight - 1; ++y) {
-                // Capture necessary data for the thread
-                m_Pool.enqueue([=, &kernel, tempBuffer]() {
-                    uint8_t* curr = data + y * planeWidth;
-                    uint8_t* prev = data + (y - 1) * planeWidth;
-                    uint8_t* next = data + (y + 1) * planeWidth;
-                    uint8_t* dst = tempBuffer->data() + y * planeWidth;
-                    
-                    // Apply Gaussian blur to this row (skip first and last pixel)
-                    for (int x = 1; x < planeWidth - 1; ++x) {
-                        float sum = 0.0f;
-                        
-                        // Apply 3x3 Gaussian kernel
-                        for (int ky = -1; ky <= 1; ++ky) {
-                            for (int kx = -1; kx <= 1; ++kx) {
-                                uint8_t* row = (ky == -1) ? prev : (ky == 0) ? curr : next;
-                                uint8_t pixel = row[x + kx];
-                                sum += pixel * kernel[ky + 1][kx + 1];
-                            }
-                        }
-                        
-                        dst[x] = static_cast<uint8_t>(std::round(sum));
-                    }
-                });
-            }
-            
-            // Wait for all blur operations to complete
-            m_Pool.wait();
-            
-            // Copy blurred data back in a separate threading pass
-            for (int y = 1; y < planeHeight - 1; ++y) {
-                m_Pool.enqueue([=, tempBuffer]() {
-                    uint8_t* src = tempBuffer->data() + y * planeWidth;
-                    uint8_t* dst = data + y * planeWidth;
-                    
-                    // Copy the processed pixels (skip first and last pixel of each row)
-                    std::memcpy(dst + 1, src + 1, planeWidth - 2);
-                });
+
+        // All planes are in flight at once; the frame is done when every plane and its copy-back finished
+        TaskGroup frameDone;
+        TaskGroup planeDone[AV_NUM_DATA_POINTERS];
+        PooledBuffer scratch[AV_NUM_DATA_POINTERS];
+
+        // Destroyed before the groups and scratch above: when a plane fails to start, the tasks already
+        // submitted still use them, so they are only given back once every task has finished
+        struct FrameWait {
+            Executor &executor;
+            TaskGroup &group;
+            bool closed = false;
+            ~FrameWait() {
+                if (!closed) group.close();
+                try { executor.wait(group); }
+                catch (...) { }
             }
-            
-            // Wait for all copy operations to complete
-            m_Pool.wait();
+        } frameWait{ m_Executor, frameDone };
+        
+        m_Layout.swapByteOrder(frame);
+        for (int index = 0; index < m_Layout.planeCount(); ++index) {
+            PlaneView plane = m_Layout.plane(frame, index);
+            if (!plane.data || plane.height <= 0) continue;
+
+            if (m_Gaussian.radius > 0) blendPlaneSeparable(frameDone, scratch[index], plane);
+            // The 3x3 kernel keeps the border rows and pixels, a plane made of nothing else is left as it is
+            else if (plane.width < 2 * plane.step + 1 || plane.height < 3) continue;
+            // Wide samples have a single exact tier, always blurred in place
+            else if (m_Options.inPlace || plane.type != kernels::SampleType::U8) blendPlaneInPlace(frameDone, scratch[index], plane);
+            else blendPlane(frameDone, planeDone[index], scratch[index], plane);
         }
+
+        frameWait.closed = true;
+        frameDone.close();
+        TRACE_SPAN("wait for planes");
+        m_Executor.wait(frameDone);
+        m_Layout.swapByteOrder(frame);
     }
 
     void BlurThreadProcNode::init(std::shared_ptr<const PipelineContext> context) {
-        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(context->pixelFormat);
-        if (desc) {
-           if (!(desc->flags & AV_PIX_FMT_FLAG_PLANAR)) m_PlaneCount = 1;
-           else m_PlaneCount = desc->nb_components;
-           m_Log2ChromaHeight = desc->log2_chroma_h;
-        }
+        m_Layout.init(context->pixelFormat);
+        if (m_Gaussian.radius > 0 && m_Layout.hasWideSamples()) throw std::runtime_error("Gaussian blur supports 8-bit samples only");
     }
 
     std::unique_ptr<PipelinePacket> BlurThreadProcNode::updatePacket(std::unique_ptr<PipelinePacket> packet) {
@@ -2,8 +2,9 @@
  * Thread Blur Processor Node
  * ==================================
  * 
- * Multi-threaded deinterlacing implementation using std::thread.
- * Provides explicit thread management for parallel processing.
+ * Multi-threaded blur implementation on the process-wide work-stealing
+ * Executor. Planes are blurred concurrently and each plane's copy-back
+ * starts as soon as its own blur pass has finished.
  * 
  * Author: Finoshkin Aleksei
  * License: MIT
@@ -14,124 +15,38 @@
 
 
 #include "base/Processor.h"
+#include "base/PixelLayout.h"
+#include "BlurOptions.h"
+#include "kernels/CpuDispatch.h"
 
-#include <queue>
-#include <mutex>
-#include <thread>
-#include <atomic>
-#include <cstring>
-#include <functional>
-#include <condition_variable>
+#include "utils/Executor.h"
 
 namespace media_proc {
 
-    class ThreadPool {
-    private:
-        std::vector<std::thread> workers;
-        std::queue<std::function<void()>> tasks;
-        mutable std::mutex queueMutex;
-        std::condition_variable condition;
-        std::condition_variable finished;
-        std::atomic<size_t> activeTasks{0};
-        std::atomic<bool> stop{false};
-
-    public:
-        ThreadPool(size_t numThreads) {
-            for (size_t i = 0; i < numThreads; ++i) {
-                workers.emplace_back([this]() {
-                    while (true) {
-                        std::function<void()> task;
-                        {
-                            std::unique_lock<std::mutex> lock(queueMutex);
-                            condition.wait(lock, [this]() {
-                                return stop.load() || !tasks.empty();
-                            });
-                            
-                            if (stop.load() && tasks.empty()) {
-                                return;
-                            }
-                            
-                            task = std::move(tasks.front());
-                            tasks.pop();
-                            activeTasks.fetch_add(1);
-                        }
-                        
-                        // Execute task outside the lock
-                        try {
-                            task();
-                        } catch (...) {
-                            // Handle exceptions to prevent thread termination
-                            // Log error or handle as appropriate for your application
-                        }
-                        
-                        // Notify completion
-                        size_t remaining = activeTasks.fetch_sub(1) - 1;
-                        if (remaining == 0) {
-                            finished.notify_all();
-                        }
-                    }
-                });
-            }
-        }
-
-        ~ThreadPool() {
-            stop.store(true);
-            condition.notify_all();
-            
-            for (std::thread &worker : workers) {
-                if (worker.joinable()) {
-                    worker.join();
-                }
-            }
-        }
-
-        template<typename F>
-        void enqueue(F&& task) {
-            {
-                std::lock_guard<std::mutex> lock(queueMutex);
-                if (stop.load()) {
-                    throw std::runtime_error("ThreadPool is stopped");
-                }
-                tasks.emplace(std::forward<F>(task));
-            }
-            condition.notify_one();
-        }
-
-        void wait() {
-            std::unique_lock<std::mutex> lock(queueMutex);
-            finished.wait(lock, [this]() {
-                return tasks.empty() && activeTasks.load() == 0;
-            });
-        }
-        
-        size_t size() const {
-            return workers.size();
-        }
-        
-        bool empty() const {
-            std::lock_guard<std::mutex> lock(queueMutex);
-            return tasks.empty() && activeTasks.load() == 0;
-        }
-    };
-
-
     class BlurThreadProcNode : public Processor {
     public:
-        BlurThreadProcNode();
+        // Rows are split across the executor and every strip runs `kernels`: the scalar set for the
+        // threads mode, the one picked by CpuDispatch for simd-threads
+        BlurThreadProcNode(const BlurOptions &options = {}, const kernels::KernelSet &kernels = kernels::scalarKernels());
         ~BlurThreadProcNode();
         
     private:
         void blend(AVFrame* frame);
+        void blendPlane(TaskGroup &frameDone, TaskGroup &planeDone, PooledBuffer &scratch, const PlaneView &plane);
+        void blendPlaneInPlace(TaskGroup &frameDone, PooledBuffer &scratch, const PlaneView &plane);
+        void blendPlaneSeparable(TaskGroup &frameDone, PooledBuffer &scratch, const PlaneView &plane);
 
     private:
         virtual void init(std::shared_ptr<const PipelineContext> context) override;
         virtual std::unique_ptr<PipelinePacket> updatePacket(std::unique_ptr<PipelinePacket> packet) override;
                 
     private:
-        ThreadPool m_Pool;
+        Executor &m_Executor;
+        BlurOptions m_Options;
+        kernels::KernelSet m_Kernels;
+        kernels::GaussianKernel m_Gaussian;
 
-        int m_PlaneCount = -1;
-        int m_Log2ChromaHeight = 0;
+        PixelLayout m_Layout;
     };
 }
 
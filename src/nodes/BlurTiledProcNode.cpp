@@ -0,0 +1,51 @@
+#include "BlurTiledProcNode.h"
+
+#include "kernels/CpuDispatch.h"
+#include "kernels/TiledBlur.h"
+#include "utils/Executor.h"
+
+namespace media_proc {
+
+    BlurTiledProcNode::BlurTiledProcNode(const BlurOptions &options) : m_Options(options), m_Executor(Executor::withThreads(options.threads)) { }
+    BlurTiledProcNode::~BlurTiledProcNode() { 
+        
+    }
+
+    void BlurTiledProcNode::blend(AVFrame* frame) {
+        TRACE_SPAN("blur tiled");
+        if (!frame || !frame->data[0]) throw std::runtime_error("Invalid frame data");
+        
+        int width = frame->width;
+        int height = frame->height;
+        if (width <= 0 || height <= 0) throw std::runtime_error("Invalid frame dimensions");
+
+        const kernels::KernelSet &simd = kernels::activeKernels();
+        kernels::BlurRowFn blurRow = simd.blurRow(m_Options.precision);
+
+        m_Layout.swapByteOrder(frame);
+        for (int index = 0; index < m_Layout.planeCount(); ++index) {
+            PlaneView plane = m_Layout.plane(frame, index);
+            if (!plane.data || plane.height <= 0) continue;
+            TRACE_SPAN_ARG("plane", "index", index);
+
+            // The tile blocks are 8-bit; wider samples take the rolling in-place rows instead
+            if (plane.type != kernels::SampleType::U8) {
+                kernels::blurPlaneWide(plane.data, plane.stride, plane.width, plane.height, plane.step, plane.type, plane.shift, simd.wide);
+                continue;
+            }
+
+            // Bands of one plane run in parallel; each band walks its tiles left to right
+            kernels::blurPlaneTiled(plane.data, plane.stride, plane.width, plane.height, plane.step, m_Options.tile, blurRow, &m_Executor);
+        }
+        m_Layout.swapByteOrder(frame);
+    }
+
+    void BlurTiledProcNode::init(std::shared_ptr<const PipelineContext> context) {
+        m_Layout.init(context->pixelFormat);
+    }
+
+    std::unique_ptr<PipelinePacket> BlurTiledProcNode::updatePacket(std::unique_ptr<PipelinePacket> packet) {
+        if(packet) blend(packet->frame);
+        return std::move(packet);
+    };
+}
@@ -0,0 +1,45 @@
+/*
+ * Blur Tiled Processor Node
+ * ==========================
+ * 
+ * Cache-blocked CPU blur. Every plane is blurred in place tile by tile
+ * through the tiled engine, with bands of tiles spread over the shared
+ * executor. Uses the best row kernel the CPU supports.
+ * 
+ * Author: Finoshkin Aleksei
+ * License: MIT
+ */
+
+#ifndef IMG_DEINT_TILED_PROCESSOR_NODE_H
+#define IMG_DEINT_TILED_PROCESSOR_NODE_H
+
+
+#include "base/Processor.h"
+#include "base/PixelLayout.h"
+#include "BlurOptions.h"
+
+namespace media_proc {
+
+    class Executor;
+
+    class BlurTiledProcNode : public Processor {
+    public:
+        BlurTiledProcNode(const BlurOptions &options = {});
+        ~BlurTiledProcNode();
+        
+    private:
+        void blend(AVFrame* frame);
+
+    private:
+        virtual void init(std::shared_ptr<const PipelineContext> context) override;
+        virtual std::unique_ptr<PipelinePacket> updatePacket(std::unique_ptr<PipelinePacket> packet) override;
+        
+    private:
+        BlurOptions m_Options;
+        Executor &m_Executor;
+        PixelLayout m_Layout;
+    };
+}
+
+
+#endif //!IMG_DEINT_TILED_PROCESSOR_NODE_H
@@ -0,0 +1,39 @@
+#include "CodecOptions.h"
+
+#include <algorithm>
+#include <sstream>
+#include <thread>
+
+namespace media_proc {
+
+    unsigned int autoCodecThreads(unsigned int processorThreads, bool concurrent) {
+        unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+        if(!concurrent) return cores;
+
+        // Decoder and encoder split the cores the processor leaves, but get a quarter of them at
+        // least: a processor on every core still waits for its input and output
+        unsigned int spare = cores - std::min(processorThreads, cores);
+        return std::max({ 1u, spare / 2, cores / 4 });
+    }
+
+    bool parseThreadTypes(const std::string &list, int &types) {
+        int parsed = 0;
+        std::stringstream stream(list);
+        std::string item;
+        while(std::getline(stream, item, ',')) {
+            if(item == "frame") parsed |= FF_THREAD_FRAME;
+            else if(item == "slice") parsed |= FF_THREAD_SLICE;
+            else return false;
+        }
+        if(!parsed) return false;
+        types = parsed;
+        return true;
+    }
+
+    std::string threadTypesName(int types) {
+        if((types & FF_THREAD_FRAME) && (types & FF_THREAD_SLICE)) return "frame,slice";
+        if(types & FF_THREAD_FRAME) return "frame";
+        if(types & FF_THREAD_SLICE) return "slice";
+        return "none";
+    }
+}
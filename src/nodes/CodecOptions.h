@@ -0,0 +1,49 @@
+/*
+ * Codec Options
+ * =============
+ *
+ * Threading of the FFmpeg decoder and encoder nodes, filled from the command line.
+ *
+ * Author: Finoshkin Aleksei
+ * License: MIT
+ */
+
+#ifndef IMG_DEINT_CODEC_OPTIONS_H
+#define IMG_DEINT_CODEC_OPTIONS_H
+
+
+#include <StdAfx.h>
+
+namespace media_proc {
+
+    struct CodecThreading {
+        // thread_count of the codec context; FFmpeg's default of 1 keeps the codec on one core
+        int threads = 1;
+
+        // thread_type: FF_THREAD_FRAME and/or FF_THREAD_SLICE. Codecs use the kinds they support,
+        // frame threading adds a frame of delay per thread, slice threading none
+        int types = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
+        // Before avcodec_open2(), the context ignores later changes
+        void apply(AVCodecContext* context) const {
+            context->thread_count = threads;
+            context->thread_type = types;
+        }
+    };
+
+    struct CodecOptions {
+        CodecThreading decoder;
+        CodecThreading encoder;
+    };
+
+    // Threads for each codec when left at auto. A sequential pipeline runs one stage at a time,
+    // so the codec may use every core; in a concurrent one it shares them with the processor.
+    unsigned int autoCodecThreads(unsigned int processorThreads, bool concurrent);
+
+    // "frame", "slice" or "frame,slice"
+    bool parseThreadTypes(const std::string &list, int &types);
+    std::string threadTypesName(int types);
+}
+
+
+#endif //!IMG_DEINT_CODEC_OPTIONS_H
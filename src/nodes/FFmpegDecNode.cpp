@@ -1,57 +1,107 @@
 #include "FFmpegDecNode.h"
 
+#include <mutex>
+
 namespace media_proc {
 
     FFmpegDecNode::~FFmpegDecNode() {
         av_packet_free(&m_Packet);
         avcodec_free_context(&m_DecoderContext);
+        closeInput();
+    }
+
+    void FFmpegDecNode::closeInput() {
         avformat_close_input(&m_FormatContext);
+        m_Input.close();
+    }
+
+    void FFmpegDecNode::setInput(const std::string &fileName) {
+        closeInput();
+        m_FileName = fileName;
+        m_Buffer = nullptr;
+        m_BufferSize = 0;
+        m_ValidateContext = true;
+        restart();
+    }
+
+    void FFmpegDecNode::setInputBuffer(const uint8_t* data, size_t size) {
+        setInput("");
+        m_Buffer = data;
+        m_BufferSize = size;
     }
 
     void FFmpegDecNode::init() {
-        avformat_network_init();
+        static std::once_flag networkInitFlag;
+        std::call_once(networkInitFlag, []() { avformat_network_init(); });
         
-        if (avformat_open_input(&m_FormatContext, m_FileName.c_str(), nullptr, nullptr) != 0) {
+        m_FormatContext = avformat_alloc_context();
+        if (!m_FormatContext) {
+            throw std::runtime_error("Failed to allocate input format context\n");
+        }
+        // "-" streams from stdin: frames are decoded as the data comes in, and stream probing stops
+        // once the codec parameters are known instead of buffering frames to guess a frame rate
+        bool streaming = m_FileName == "-";
+        AVDictionary* options = nullptr;
+        if (streaming) av_dict_set(&options, "fpsprobesize", "0", 0);
+
+        // Regular files are demuxed straight from a mapping, pipes and URLs through FFmpeg's own protocols
+        if (m_Buffer) {
+            if (!m_Input.openMemory(m_Buffer, m_BufferSize)) {
+                avformat_free_context(m_FormatContext);
+                m_FormatContext = nullptr;
+                throw std::runtime_error("Input buffer is empty\n");
+            }
+            m_FormatContext->pb = m_Input.context();
+        }
+        else if (!streaming && m_Input.open(m_FileName)) m_FormatContext->pb = m_Input.context();
+
+        // On failure FFmpeg frees the format context, the mapping is ours to release
+        int ret = avformat_open_input(&m_FormatContext, streaming ? "pipe:0" : m_FileName.c_str(), nullptr, &options);
+        av_dict_free(&options);
+        if (ret != 0) {
+            m_Input.close();
             throw std::runtime_error("Failed to open input file\n");
         }
 
-        int ret = avformat_find_stream_info(m_FormatContext, nullptr);
+        ret = avformat_find_stream_info(m_FormatContext, nullptr);
         if (ret < 0) {
             char errbuf[AV_ERROR_MAX_STRING_SIZE];
             av_strerror(ret, errbuf, AV_ERROR_MAX_STRING_SIZE);
-            avformat_close_input(&m_FormatContext);
+            closeInput();
             throw std::runtime_error("Failed to get stream info: " + std::string(errbuf) + "\n");
         }
 
         if (m_FormatContext->nb_streams == 0) {
-            avformat_close_input(&m_FormatContext);
+            closeInput();
             throw std::runtime_error("No streams found in file\n");
         }
 
-        // Find the first video stream
-        int videoStreamIndex = -1;
-        for (unsigned int i = 0; i < m_FormatContext->nb_streams; ++i) {
-            if (m_FormatContext->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-                videoStreamIndex = i;
-                break;
-            }
+        // The stream FFmpeg itself would pick: skips cover art and thumbnails, prefers the main video
+        const AVCodec* decoder = nullptr;
+        m_StreamIndex = av_find_best_stream(m_FormatContext, AVMEDIA_TYPE_VIDEO, -1, -1, &decoder, 0);
+        if (m_StreamIndex < 0) {
+            closeInput();
+            throw std::runtime_error(m_StreamIndex == AVERROR_DECODER_NOT_FOUND ? "No decoder for the video stream\n" : "No video stream found in file\n");
         }
-
-        if (videoStreamIndex == -1) {
-            avformat_close_input(&m_FormatContext);
-            throw std::runtime_error("No video stream found in file\n");
-        }
-
-        AVCodecParameters* codecpar = m_FormatContext->streams[videoStreamIndex]->codecpar;
-        const AVCodec* decoder = avcodec_find_decoder(codecpar->codec_id);
-        if (!decoder) {
-            avformat_close_input(&m_FormatContext);
-            throw std::runtime_error("Failed to find decoder for codec ID " + std::to_string(codecpar->codec_id));
+        m_Draining = false;
+
+        AVStream* stream = m_FormatContext->streams[m_StreamIndex];
+        AVCodecParameters* codecpar = stream->codecpar;
+
+        // Reuse the decoder opened for the previous input when the stream is the same kind
+        if (m_DecoderContext) {
+            if (m_DecoderContext->codec_id == codecpar->codec_id && m_DecoderContext->width == codecpar->width &&
+                m_DecoderContext->height == codecpar->height && m_DecoderContext->pix_fmt == codecpar->format) {
+                avcodec_flush_buffers(m_DecoderContext);
+                m_DecoderContext->pkt_timebase = stream->time_base;
+                return;
+            }
+            avcodec_free_context(&m_DecoderContext);
         }
 
         m_DecoderContext = avcodec_alloc_context3(decoder);
         if (!m_DecoderContext) {
-            avformat_close_input(&m_FormatContext);
+            closeInput();
             throw std::runtime_error("Failed to allocate decoder context\n");
         }
 
@@ -60,59 +110,91 @@ namespace media_proc {
             char errbuf[AV_ERROR_MAX_STRING_SIZE];
             av_strerror(ret, errbuf, AV_ERROR_MAX_STRING_SIZE);
             avcodec_free_context(&m_DecoderContext);
-            avformat_close_input(&m_FormatContext);
+            closeInput();
             throw std::runtime_error("Failed to copy codec parameters to decoder context: " + std::string(errbuf) + "\n");
         }
 
+        // Timestamps of the frames stay in the stream's time base
+        m_DecoderContext->pkt_timebase = stream->time_base;
+
+        // Decoded planes come from pooled, 64-byte aligned buffers. FramePool::getBuffer is
+        // thread-safe, as frame threading calls it from the decoder's workers.
+        m_DecoderContext->get_buffer2 = FramePool::getBuffer;
+        m_Threading.apply(m_DecoderContext);
+
         ret = avcodec_open2(m_DecoderContext, decoder, nullptr);
         if (ret < 0) {
             char errbuf[AV_ERROR_MAX_STRING_SIZE];
             av_strerror(ret, errbuf, AV_ERROR_MAX_STRING_SIZE);
             avcodec_free_context(&m_DecoderContext);
-            avformat_close_input(&m_FormatContext);
+            closeInput();
             throw std::runtime_error("Failed to open decoder: " + std::string(errbuf) + "\n");
         }
     }
 
-    std::unique_ptr<PipelinePacket> FFmpegDecNode::getPacket() {
-        int video_stream_index = 0;
-        AVStream* video_stream = m_FormatContext->streams[video_stream_index];
-        AVFrame *frame = av_frame_alloc();
-
-        if (!frame) {
-            throw std::runtime_error("Failed to allocate frame");
-        }
+    bool FFmpegDecNode::receiveFrame(AVFrame* frame) {
+        while (true) {
+            int ret = avcodec_receive_frame(m_DecoderContext, frame);
+            if (ret == 0) return true;
+            if (ret == AVERROR_EOF || (ret == AVERROR(EAGAIN) && m_Draining)) return false;
+            if (ret != AVERROR(EAGAIN)) {
+                char errbuf[AV_ERROR_MAX_STRING_SIZE];
+                av_strerror(ret, errbuf, AV_ERROR_MAX_STRING_SIZE);
+                throw std::runtime_error("Error while decoding: " + std::string(errbuf));
+            }
 
-        bool got_frame = false;
-        if(av_read_frame(m_FormatContext, m_Packet) >= 0) {
-            if (m_Packet->stream_index == video_stream_index) {
-                int ret = avcodec_send_packet(m_DecoderContext, m_Packet);
-                if (ret == 0) {
-                    ret = avcodec_receive_frame(m_DecoderContext, frame);
-                    if (ret == 0) { got_frame = true; }
-                    else if(frame) av_frame_free(&frame);
-                }
+            // A read error past the last good packet ends the input like EOF does, the decoder is still drained
+            if (av_read_frame(m_FormatContext, m_Packet) < 0) {
+                m_Draining = true;
+                avcodec_send_packet(m_DecoderContext, nullptr);
+                continue;
+            }
+            if (m_Packet->stream_index != m_StreamIndex) {
+                av_packet_unref(m_Packet);
+                continue;
             }
+
+            ret = avcodec_send_packet(m_DecoderContext, m_Packet);
             av_packet_unref(m_Packet);
+            // A corrupt packet costs its frames, not the rest of the stream
+            if (ret < 0 && ret != AVERROR_INVALIDDATA) {
+                char errbuf[AV_ERROR_MAX_STRING_SIZE];
+                av_strerror(ret, errbuf, AV_ERROR_MAX_STRING_SIZE);
+                throw std::runtime_error("Error sending a packet for decoding: " + std::string(errbuf));
+            }
         }
-        if(!got_frame) {
-            av_frame_free(&frame);
+    }
+
+    std::unique_ptr<PipelinePacket> FFmpegDecNode::getPacket() {
+        AVFrame *frame = FramePool::global().acquireFrame();
+        if(!receiveFrame(frame)) {
+            FramePool::global().releaseFrame(frame);
             return nullptr;
         }
+        frame->pts = frame->best_effort_timestamp;
 
-        if(!m_PipelineContext) {
-            const AVPixFmtDescriptor *pixelFormatDesc = av_pix_fmt_desc_get(m_DecoderContext->pix_fmt);
+        bool geometryChanged = m_PipelineContext && (frame->width != m_PipelineContext->width || frame->height != m_PipelineContext->height
+                                                     || frame->format != m_PipelineContext->pixelFormat);
+        if(!m_PipelineContext || m_ValidateContext || geometryChanged) {
+            const AVPixFmtDescriptor *pixelFormatDesc = av_pix_fmt_desc_get(static_cast<AVPixelFormat>(frame->format));
             if (!pixelFormatDesc) throw std::runtime_error("Pixel Format Descriptor not found");
             std::vector<int> linesizes(pixelFormatDesc->nb_components);
-            for(int i = 0; i < linesizes.size(); i++) linesizes.at(i) = frame->linesize[i];
+            for(size_t i = 0; i < linesizes.size(); i++) linesizes.at(i) = frame->linesize[i];
 
-            m_PipelineContext = std::make_shared<PipelineContext>(
+            AVStream* stream = m_FormatContext->streams[m_StreamIndex];
+            auto pipelineContext = std::make_shared<PipelineContext>(
                 linesizes,
                 frame->width,
                 frame->height,
-                m_DecoderContext->pix_fmt,
-                m_DecoderContext->time_base,
-                m_DecoderContext->framerate );
+                static_cast<AVPixelFormat>(frame->format),
+                stream->time_base,
+                av_guess_frame_rate(m_FormatContext, stream, frame) );
+            pipelineContext->sampleAspectRatio = frame->sample_aspect_ratio;
+
+            // Downstream nodes compare the geometry themselves and only re-init when it changed,
+            // while the timing of every input has to reach the encoder
+            m_PipelineContext = pipelineContext;
+            m_ValidateContext = false;
         }
 
         return std::make_unique<PipelinePacket>(frame, m_PipelineContext); 
@@ -2,8 +2,9 @@
  * FFmpeg Decoder Node
  * ===================
  * 
- * FFmpeg-based image decoder implementation using libavcodec and libavformat.
- * Supports various image formats through FFmpeg's decoding capabilities.
+ * FFmpeg-based decoder implementation using libavcodec and libavformat.
+ * Decodes the best video stream of an image or video file, or of stdin for "-", one
+ * frame per call.
  * 
  * Author: Finoshkin Aleksei
  * License: MIT
@@ -14,25 +15,47 @@
 
 
 #include "base/Decoder.h"
+#include "CodecOptions.h"
+#include "io/MappedInput.h"
 
 namespace media_proc {
 
     class FFmpegDecNode : public Decoder {
     public:
-        FFmpegDecNode(const std::string &fileName) : m_FileName(fileName), m_Packet(av_packet_alloc()) { }
+        FFmpegDecNode(const std::string &fileName, const CodecThreading &threading = {}) : m_FileName(fileName), m_Threading(threading), m_Packet(av_packet_alloc()) { }
         ~FFmpegDecNode();
+
+        // Points the node at another file. The open decoder context is kept when the new
+        // stream uses the same codec and geometry, so batch jobs skip codec setup.
+        void setInput(const std::string &fileName);
+        // Decodes an encoded image or video held in memory. The buffer must stay alive until
+        // the node is pointed at the next input.
+        void setInputBuffer(const uint8_t* data, size_t size);
         
     private:
         virtual void init() override;
         virtual std::unique_ptr<PipelinePacket> getPacket() override;
 
+        // Next frame of the video stream: feeds packets until the decoder has output, then
+        // drains it once the input ends. False when the decoder is fully drained.
+        bool receiveFrame(AVFrame* frame);
+        // Closes the demuxer, then the mapping it read from
+        void closeInput();
+
     private:
         std::string m_FileName;
+        CodecThreading m_Threading;
+        MappedInput m_Input;
+        const uint8_t* m_Buffer = nullptr;
+        size_t m_BufferSize = 0;
 
         AVPacket* m_Packet = nullptr;
         AVCodecContext* m_DecoderContext = nullptr;
         AVFormatContext* m_FormatContext = nullptr;
         std::shared_ptr<const PipelineContext> m_PipelineContext = nullptr;
+        int m_StreamIndex = -1;
+        bool m_Draining = false;
+        bool m_ValidateContext = false;
     };
 }
 
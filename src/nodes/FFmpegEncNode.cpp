@@ -1,8 +1,14 @@
 #include "FFmpegEncNode.h"
+#include "io/AsyncFileWriter.h"
+
+extern "C" {
+#include <libavutil/opt.h>
+}
 
 #include <algorithm>
 
-static AVCodecID codecIdFromExtension(const std::string& filename) {
+// Image files get an explicit codec; AV_CODEC_ID_NONE leaves the choice to the container's muxer
+static AVCodecID imageCodecFromExtension(const std::string& filename) {
     std::string ext = filename.substr(filename.find_last_of('.') + 1);
     std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
 
@@ -15,25 +21,131 @@ static AVCodecID codecIdFromExtension(const std::string& filename) {
     if (ext == "ppm")  return AV_CODEC_ID_PPM;
     if (ext == "exr")  return AV_CODEC_ID_EXR;
 
-    throw std::runtime_error("Unknown image extension: " + ext);
+    return AV_CODEC_ID_NONE;
+}
+
+static std::string ffmpegError(int error) {
+    char errbuf[AV_ERROR_MAX_STRING_SIZE];
+    av_strerror(error, errbuf, AV_ERROR_MAX_STRING_SIZE);
+    return errbuf;
+}
+
+// The inverse frame rate like the ffmpeg CLI, a time base every encoder accepts (MPEG-4 rejects 1/90000)
+static AVRational encoderTimeBase(const media_proc::PipelineContext &context) {
+    if (context.frameRate.num > 0 && context.frameRate.den > 0) return av_inv_q(context.frameRate);
+    if (context.timeBase.num > 0 && context.timeBase.den > 0) return context.timeBase;
+    return { 1, 25 };
+}
+
+// The source format when the encoder takes it, otherwise the closest one it does
+static AVPixelFormat encoderPixelFormat(const AVCodecContext* context, const AVCodec* encoder, AVPixelFormat source) {
+    const void* configs = nullptr;
+    int count = 0;
+    if (avcodec_get_supported_config(context, encoder, AV_CODEC_CONFIG_PIX_FORMAT, 0, &configs, &count) < 0 || !configs) return source;
+
+    const AVPixelFormat* formats = static_cast<const AVPixelFormat*>(configs);
+    if (std::find(formats, formats + count, source) != formats + count) return source;
+
+    const AVPixFmtDescriptor* descriptor = av_pix_fmt_desc_get(source);
+    bool alpha = descriptor && (descriptor->flags & AV_PIX_FMT_FLAG_ALPHA);
+    return avcodec_find_best_pix_fmt_of_list(formats, source, alpha, nullptr);
 }
 
 namespace media_proc {
 
     FFmpegEncNode::~FFmpegEncNode() {
+        closeOutput();
         av_packet_free(&m_Packet);
+        av_frame_free(&m_Converted);
+        sws_freeContext(m_Scaler);
         avcodec_free_context(&m_EncoderContext);
-        avformat_close_input(&m_FormatContext);
-        if (m_File.is_open()) { m_File.close(); }
+    }
+
+    void FFmpegEncNode::setOutput(const std::string &fileName) {
+        // The previous output did not reach its end, e.g. its job failed: frames an encoder
+        // with delay still holds must not leak into the next file
+        if (m_FormatContext) {
+            closeOutput();
+            if (m_EncoderContext && hasDelay()) avcodec_free_context(&m_EncoderContext);
+        }
+        m_FileName = fileName;
+        m_Sink = nullptr;
+        restart();
+    }
+
+    void FFmpegEncNode::setOutputBuffer(std::vector<uint8_t>* sink) {
+        setOutput("");
+        m_Sink = sink;
     }
 
     void FFmpegEncNode::init(std::shared_ptr<const PipelineContext> context) {
-        avformat_alloc_output_context2(&m_FormatContext,nullptr, nullptr, m_FileName.c_str());
+        // A new context in the middle of an output is fine as long as the frames still fit the stream
+        if (m_FormatContext) {
+            if (context->width != m_EncoderContext->width || context->height != m_EncoderContext->height || context->pixelFormat != m_SourceFormat) {
+                throw std::runtime_error("Frame size or pixel format changed in the middle of " + m_FileName);
+            }
+            m_SourceTimeBase = context->timeBase;
+            return;
+        }
+
+        // stdout and memory take a single stream of images, not a file per frame
+        bool streaming = m_FileName == "-" || m_Sink;
+        std::string url = m_FileName == "-" ? "pipe:1" : m_FileName;
+        if (m_Sink && m_Format.empty()) throw std::runtime_error("An output to memory needs a format");
+
+        // An explicit format wins over the extension: an image format (png) goes through the image
+        // muxers, anything else names a muxer (matroska, nut) or a container extension (mkv)
+        const AVOutputFormat* format = nullptr;
+        AVCodecID codecId = imageCodecFromExtension(m_Format.empty() ? m_FileName : "." + m_Format);
+        if (!m_Format.empty()) {
+            if (codecId != AV_CODEC_ID_NONE) format = av_guess_format(streaming ? "image2pipe" : "image2", nullptr, nullptr);
+            else {
+                format = av_guess_format(m_Format.c_str(), nullptr, nullptr);
+                if (!format) format = av_guess_format(nullptr, ("." + m_Format).c_str(), nullptr);
+            }
+            if (!format) throw std::runtime_error("Unknown output format: " + m_Format);
+        }
+
+        avformat_alloc_output_context2(&m_FormatContext, format, nullptr, url.c_str());
         if (!m_FormatContext) {
             throw std::runtime_error("Failed to detect output format\n");
         }
 
-        AVCodecID codecId = codecIdFromExtension(m_FileName);
+        if (codecId == AV_CODEC_ID_NONE) codecId = av_guess_codec(m_FormatContext->oformat, nullptr, url.c_str(), nullptr, AVMEDIA_TYPE_VIDEO);
+
+        try {
+            if (codecId == AV_CODEC_ID_NONE) throw std::runtime_error("No video codec for output " + m_FileName);
+            openEncoder(*context, codecId);
+            openOutput();
+        }
+        catch (...) {
+            closeOutput();
+            throw;
+        }
+        m_SourceTimeBase = context->timeBase;
+        m_NextPts = 0;
+    }
+
+    void FFmpegEncNode::openEncoder(const PipelineContext &context, AVCodecID codecId) {
+        bool globalHeader = m_FormatContext->oformat->flags & AVFMT_GLOBALHEADER;
+
+        // Reuse the encoder of the previous output when it takes the frames as they are. One that
+        // was drained at the end of that output can only go on if it supports flushing.
+        if (m_EncoderContext) {
+            bool compatible = m_EncoderContext->codec_id == codecId && m_EncoderContext->width == context.width &&
+                              m_EncoderContext->height == context.height && m_SourceFormat == context.pixelFormat &&
+                              av_cmp_q(m_EncoderContext->time_base, encoderTimeBase(context)) == 0 &&
+                              globalHeader == (bool)(m_EncoderContext->flags & AV_CODEC_FLAG_GLOBAL_HEADER);
+            bool reusable = !m_Drained || (m_EncoderContext->codec->capabilities & AV_CODEC_CAP_ENCODER_FLUSH);
+            if (compatible && reusable) {
+                if (m_Drained) avcodec_flush_buffers(m_EncoderContext);
+                m_Drained = false;
+                return;
+            }
+            avcodec_free_context(&m_EncoderContext);
+        }
+        m_Drained = false;
+
         const AVCodec* encoder = avcodec_find_encoder(codecId);
         if (!encoder) {
             throw std::runtime_error("Encoder not found for codec ID: " + std::to_string(codecId));
@@ -44,58 +156,178 @@ namespace media_proc {
             throw std::runtime_error("Failed to allocate encoder context");
         }
 
-        m_EncoderContext->width = context->width;
-        m_EncoderContext->height = context->height;
-        m_EncoderContext->coded_width = context->width;
-        m_EncoderContext->coded_height = context->height;
-        m_EncoderContext->sample_aspect_ratio = context->aspectRatio;
-        m_EncoderContext->pix_fmt = context->pixelFormat;
-        m_EncoderContext->time_base = {1, 25};
+        m_SourceFormat = context.pixelFormat;
+        m_EncoderContext->width = context.width;
+        m_EncoderContext->height = context.height;
+        m_EncoderContext->coded_width = context.width;
+        m_EncoderContext->coded_height = context.height;
+        m_EncoderContext->sample_aspect_ratio = context.sampleAspectRatio;
+        m_EncoderContext->pix_fmt = encoderPixelFormat(m_EncoderContext, encoder, context.pixelFormat);
+        m_EncoderContext->time_base = encoderTimeBase(context);
+        if (context.frameRate.num > 0 && context.frameRate.den > 0) m_EncoderContext->framerate = context.frameRate;
+
+        // Native MPEG-4 is what MP4, MKV and AVI get without libx264; its default of 200 kb/s
+        // would bury the blur in block artifacts, so it gets a fixed quantizer instead
+        if (codecId == AV_CODEC_ID_MPEG4) {
+            m_EncoderContext->flags |= AV_CODEC_FLAG_QSCALE;
+            m_EncoderContext->global_quality = FF_QP2LAMBDA * 3;
+        }
 
-        if (m_FormatContext->oformat->flags & AVFMT_GLOBALHEADER) {
+        if (globalHeader) {
             m_EncoderContext->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
         }
+        m_Threading.apply(m_EncoderContext);
 
         int ret = avcodec_open2(m_EncoderContext, encoder, nullptr);
         if (ret < 0) {
-            char errbuf[256]; av_strerror(ret, errbuf, sizeof(errbuf));
-            throw std::runtime_error(std::string("Failed to open encoder: ") + errbuf);
+            avcodec_free_context(&m_EncoderContext);
+            throw std::runtime_error("Failed to open encoder: " + ffmpegError(ret));
         }
+    }
 
-        AVStream* outputStream = avformat_new_stream(m_FormatContext, encoder);
-        if (!outputStream) {
+    void FFmpegEncNode::openOutput() {
+        m_Stream = avformat_new_stream(m_FormatContext, nullptr);
+        if (!m_Stream) {
             throw std::runtime_error("Could not create output stream");
         }
+        m_Stream->time_base = m_EncoderContext->time_base;
 
-        ret = avcodec_parameters_from_context(outputStream->codecpar, m_EncoderContext);
+        int ret = avcodec_parameters_from_context(m_Stream->codecpar, m_EncoderContext);
         if (ret < 0) {
             throw std::runtime_error("Failed to copy encoder parameters to stream");
         }
+
+        // image2 writes a numbered file per frame; for a plain file name it rewrites that one
+        // file, so a video blurred into an image keeps its last frame
+        std::string muxer = m_FormatContext->oformat->name;
+        if (muxer == "image2") av_opt_set(m_FormatContext->priv_data, "update", "1", 0);
+
+        // stdout can't seek: MP4/MOV are written fragmented, and every packet leaves as soon as
+        // it is muxed instead of waiting for the AVIO buffer to fill
+        if (m_FileName == "-") {
+            if (muxer == "mp4" || muxer == "mov") av_opt_set(m_FormatContext->priv_data, "movflags", "frag_keyframe+empty_moov", 0);
+            m_FormatContext->flush_packets = 1;
+        }
+
+        // Output goes through AsyncFileWriter, also for files the muxer opens itself (image2)
+        m_WriteError = 0;
+        m_FormatContext->opaque = &m_WriteError;
+        m_FormatContext->io_open = AsyncFileWriter::openFormatIO;
+        m_FormatContext->io_close2 = AsyncFileWriter::closeFormatIO;
+        if (m_Sink) {
+            ret = avio_open_dyn_buf(&m_FormatContext->pb);
+            if (ret < 0) throw std::runtime_error("Failed to open the output buffer: " + ffmpegError(ret));
+        }
+        else if (!(m_FormatContext->oformat->flags & AVFMT_NOFILE)) {
+            ret = AsyncFileWriter::openFormatIO(m_FormatContext, &m_FormatContext->pb, m_FormatContext->url, AVIO_FLAG_WRITE, nullptr);
+            if (ret < 0) throw std::runtime_error("Failed to open output file: " + m_FileName + ": " + ffmpegError(ret));
+        }
+
+        ret = avformat_write_header(m_FormatContext, nullptr);
+        if (ret < 0) throw std::runtime_error("Failed to write the header of " + m_FileName + ": " + ffmpegError(ret));
+        m_HeaderWritten = true;
+    }
+
+    void FFmpegEncNode::closeOutput() {
+        if (!m_FormatContext) return;
+        if (m_HeaderWritten) av_write_trailer(m_FormatContext);
+        if (m_Sink && m_FormatContext->pb) {
+            uint8_t* data = nullptr;
+            int size = avio_close_dyn_buf(m_FormatContext->pb, &data);
+            m_Sink->assign(data, data + std::max(size, 0));
+            av_free(data);
+            m_FormatContext->pb = nullptr;
+        }
+        else if (!(m_FormatContext->oformat->flags & AVFMT_NOFILE)) {
+            AsyncFileWriter::closeFormatIO(m_FormatContext, m_FormatContext->pb);
+            m_FormatContext->pb = nullptr;
+        }
+        avformat_free_context(m_FormatContext);
+        m_FormatContext = nullptr;
+        m_Stream = nullptr;
+        m_HeaderWritten = false;
     }
-    
+
+    bool FFmpegEncNode::hasDelay() const {
+        return (m_EncoderContext->codec->capabilities & AV_CODEC_CAP_DELAY) || (m_EncoderContext->active_thread_type & FF_THREAD_FRAME);
+    }
+
     void FFmpegEncNode::writePacket(std::unique_ptr<PipelinePacket> packet) {
-        if(!packet) return; 
+        if(!packet) {
+            if (!m_FormatContext) return;
+            if (hasDelay()) {
+                encode(nullptr);
+                m_Drained = true;
+            }
+            closeOutput();
+            // Batches are written in the background, a failed one only shows up here
+            if (m_WriteError < 0) throw std::runtime_error("Failed to write " + m_FileName + ": " + ffmpegError(m_WriteError));
+            return;
+        }
+
+        // Timestamps go to the encoder's time base and strictly increase, as encoders require
+        AVFrame* frame = packet->frame;
+        int64_t pts = m_NextPts;
+        if (frame->pts != AV_NOPTS_VALUE && m_SourceTimeBase.num > 0 && m_SourceTimeBase.den > 0) {
+            pts = std::max(av_rescale_q(frame->pts, m_SourceTimeBase, m_EncoderContext->time_base), m_NextPts);
+        }
+        frame->pts = pts;
+        m_NextPts = pts + 1;
+        // The encoder picks its own keyframes instead of copying the source's
+        frame->pict_type = AV_PICTURE_TYPE_NONE;
+
+        encode(convert(frame));
+    }
+
+    const AVFrame* FFmpegEncNode::convert(const AVFrame* frame) {
+        AVPixelFormat target = m_EncoderContext->pix_fmt;
+        if (frame->format == target) return frame;
+
+        if (!m_Converted || m_Converted->width != frame->width || m_Converted->height != frame->height || m_Converted->format != target) {
+            av_frame_free(&m_Converted);
+            m_Converted = av_frame_alloc();
+            if (!m_Converted) throw std::runtime_error("Failed to allocate a frame for pixel format conversion");
+            m_Converted->format = target;
+            m_Converted->width = frame->width;
+            m_Converted->height = frame->height;
+            if (av_frame_get_buffer(m_Converted, 0) < 0) throw std::runtime_error("Failed to allocate a frame for pixel format conversion");
+        }
+        // The encoder may still hold a reference to the previous copy
+        if (av_frame_make_writable(m_Converted) < 0) throw std::runtime_error("Failed to allocate a frame for pixel format conversion");
 
-        int ret = avcodec_send_frame(m_EncoderContext, packet->frame);
-        if (ret < 0) { 
-            char errbuf[AV_ERROR_MAX_STRING_SIZE];
-            av_strerror(ret, errbuf, AV_ERROR_MAX_STRING_SIZE);
-            throw std::runtime_error("Error sending a frame for encoding: " + std::string(errbuf)); 
+        m_Scaler = sws_getCachedContext(m_Scaler, frame->width, frame->height, static_cast<AVPixelFormat>(frame->format),
+                                        frame->width, frame->height, target, SWS_BICUBIC, nullptr, nullptr, nullptr);
+        if (!m_Scaler) throw std::runtime_error(std::string("No conversion from ") + av_get_pix_fmt_name(static_cast<AVPixelFormat>(frame->format))
+                                                + " to " + av_get_pix_fmt_name(target));
+        sws_scale(m_Scaler, frame->data, frame->linesize, 0, frame->height, m_Converted->data, m_Converted->linesize);
+
+        m_Converted->pts = frame->pts;
+        m_Converted->sample_aspect_ratio = frame->sample_aspect_ratio;
+        return m_Converted;
+    }
+
+    void FFmpegEncNode::encode(const AVFrame* frame) {
+        int ret = avcodec_send_frame(m_EncoderContext, frame);
+        if (ret < 0) {
+            throw std::runtime_error("Error sending a frame for encoding: " + ffmpegError(ret));
         }
-    
-        while (ret >= 0) {
+
+        while (true) {
             ret = avcodec_receive_packet(m_EncoderContext, m_Packet);
             if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) return;
-            else if (ret < 0) { 
-                char errbuf[AV_ERROR_MAX_STRING_SIZE];
-                av_strerror(ret, errbuf, AV_ERROR_MAX_STRING_SIZE);
-                throw std::runtime_error("Error during encoding: " + std::string(errbuf)); 
+            else if (ret < 0) {
+                throw std::runtime_error("Error during encoding: " + ffmpegError(ret));
             }
-    
-            if (!m_File.write(reinterpret_cast<const char*>(m_Packet->data), m_Packet->size)) {
-                throw std::runtime_error("Failed to write packet to output file");
+
+            // The muxer may have changed the stream's time base in avformat_write_header()
+            av_packet_rescale_ts(m_Packet, m_EncoderContext->time_base, m_Stream->time_base);
+            m_Packet->stream_index = m_Stream->index;
+
+            // Takes over the packet's data and leaves m_Packet blank
+            ret = av_interleaved_write_frame(m_FormatContext, m_Packet);
+            if (ret < 0) {
+                throw std::runtime_error("Failed to write a packet to " + m_FileName + ": " + ffmpegError(ret));
             }
-            av_packet_unref(m_Packet);
         }
     }
-}
\ No newline at end of file
+}
@@ -1,10 +1,12 @@
 /*
  * FFmpeg Encoder Node
  * ===================
- * 
- * FFmpeg-based image encoder implementation using libavcodec and libavformat.
- * Supports various output formats through FFmpeg's encoding capabilities.
- * 
+ *
+ * FFmpeg-based encoder implementation using libavcodec and libavformat.
+ * Encodes frames into an image file or muxes them into a video container
+ * (MP4, MKV, ...), picked from the output file extension or an explicit format.
+ * "-" streams the output to stdout.
+ *
  * Author: Finoshkin Aleksei
  * License: MIT
  */
@@ -14,26 +16,63 @@
 
 
 #include "base/Encoder.h"
+#include "CodecOptions.h"
 
 namespace media_proc {
 
     class FFmpegEncNode : public Encoder {
     public:
-        FFmpegEncNode(const std::string &fileName) : m_FileName(fileName), m_Packet(av_packet_alloc()), m_File(fileName, std::ios::binary) { }
+        FFmpegEncNode(const std::string &fileName, const CodecThreading &threading = {}) : m_FileName(fileName), m_Threading(threading), m_Packet(av_packet_alloc()) { }
         ~FFmpegEncNode();
+
+        // Container or image format, for outputs whose name has no usable extension such as
+        // "-" (stdout): an image extension (png, jpg, ...), a muxer name or a container extension
+        void setFormat(const std::string &format) { m_Format = format; }
+
+        // Redirects output to another file. The open encoder context is kept when the codec
+        // and geometry of the next frame match, so batch jobs skip encoder setup.
+        void setOutput(const std::string &fileName);
+        // Encodes into `sink` instead of a file, replacing its contents when the output is
+        // finished. Needs setFormat(); the sink must outlive the output.
+        void setOutputBuffer(std::vector<uint8_t>* sink);
+
     private:
         virtual void init(std::shared_ptr<const PipelineContext> context) override;
+        // A null packet marks the end of the stream: the encoder is flushed and the file finished
         virtual void writePacket(std::unique_ptr<PipelinePacket> packet) override;
 
+        void openEncoder(const PipelineContext &context, AVCodecID codecId);
+        void openOutput();
+        // Writes the trailer when the header went out, then closes the file
+        void closeOutput();
+        // The encoder may hold frames back (B-frames, lookahead, frame threads) until it is drained
+        bool hasDelay() const;
+
+        // Sends `frame` (nullptr drains) and muxes every packet the encoder has ready
+        void encode(const AVFrame* frame);
+        // The frame itself, or a copy in the encoder's pixel format
+        const AVFrame* convert(const AVFrame* frame);
+
     private:
         std::string m_FileName;
-        std::ofstream m_File;
+        std::string m_Format;
+        std::vector<uint8_t>* m_Sink = nullptr;
+        CodecThreading m_Threading;
         AVPacket* m_Packet = nullptr;
         AVFormatContext* m_FormatContext = nullptr;
+        AVStream* m_Stream = nullptr;
         AVCodecContext* m_EncoderContext = nullptr;
+        AVPixelFormat m_SourceFormat = AV_PIX_FMT_NONE;
+        SwsContext* m_Scaler = nullptr;
+        AVFrame* m_Converted = nullptr;
+        AVRational m_SourceTimeBase = { 0, 1 };
+        int64_t m_NextPts = 0;
+        bool m_HeaderWritten = false;
+        bool m_Drained = false;
+        int m_WriteError = 0;           // First write error of the output's files, set on close
     };
 
 }
 
 
-#endif //!IMG_DEINT_FFMPEG_ENC_NODE_H
\ No newline at end of file
+#endif //!IMG_DEINT_FFMPEG_ENC_NODE_H
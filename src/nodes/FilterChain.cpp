@@ -0,0 +1,133 @@
+#include "FilterChain.h"
+
+#include "StencilProcNode.h"
+#include "kernels/CpuDispatch.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace media_proc {
+
+    static std::vector<std::string> split(const std::string &text, char separator) {
+        std::vector<std::string> parts;
+        size_t start = 0;
+        while (true) {
+            size_t end = text.find(separator, start);
+            parts.push_back(text.substr(start, end == std::string::npos ? std::string::npos : end - start));
+            if (end == std::string::npos) return parts;
+            start = end + 1;
+        }
+    }
+
+    static std::string trim(const std::string &text) {
+        size_t first = text.find_first_not_of(" \t");
+        if (first == std::string::npos) return "";
+        return text.substr(first, text.find_last_not_of(" \t") - first + 1);
+    }
+
+    static bool parseNumber(const std::string &text, float &value) {
+        char* end = nullptr;
+        value = std::strtof(text.c_str(), &end);
+        return !text.empty() && end == text.c_str() + text.size() && std::isfinite(value);
+    }
+
+    static FilterStage parseFilter(const std::string &text) {
+        FilterStage stage;
+        stage.name = text;
+
+        size_t equals = text.find('=');
+        std::string name = text.substr(0, equals);
+        std::vector<std::string> options;
+        if (equals != std::string::npos) options = split(text.substr(equals + 1), ':');
+
+        // Every option of the filter as key and number; an option without a key is the filter's first one
+        std::string firstOption = name == "blur" ? "sigma" : name == "sharpen" ? "amount" : "";
+        if (firstOption.empty()) throw std::runtime_error("Unknown filter \"" + name + "\", filters are [blur, sharpen]");
+
+        float sigma = 0.0f, radius = 0.0f, amount = 1.0f;
+        for (const std::string &option : options) {
+            size_t separator = option.find('=');
+            std::string key = separator == std::string::npos ? firstOption : option.substr(0, separator);
+            std::string value = separator == std::string::npos ? option : option.substr(separator + 1);
+
+            float* target = (name == "blur" && key == "sigma") ? &sigma : (name == "blur" && key == "radius") ? &radius
+                          : (name == "sharpen" && key == "amount") ? &amount : nullptr;
+            if (!target) throw std::runtime_error("Unknown option \"" + key + "\" of " + name + " in " + text);
+            if (!parseNumber(value, *target)) throw std::runtime_error("Option " + key + " of " + name + " should be a number in " + text);
+        }
+
+        if (name == "blur") {
+            if (sigma < 0.0f || radius < 0.0f || radius != std::floor(radius)) throw std::runtime_error("Blur sigma should be positive and radius a whole number in " + text);
+            if (sigma == 0.0f && radius == 0.0f) stage.stencil.op = kernels::Stencil::Op::Blur;
+            else {
+                stage.stencil.op = kernels::Stencil::Op::Gaussian;
+                try { stage.stencil.gaussian = kernels::GaussianKernel::create(sigma, (int)radius); }
+                catch (const std::exception &e) { throw std::runtime_error(std::string(e.what()) + " in " + text); }
+            }
+        }
+        else {
+            if (amount < 0.0f || amount > 8.0f) throw std::runtime_error("Sharpen amount should be between 0 and 8 in " + text);
+            stage.stencil.op = kernels::Stencil::Op::Sharpen;
+            stage.stencil.amount = (int)std::lround(amount * (1 << kernels::SharpenShift));
+        }
+        return stage;
+    }
+
+    std::vector<FilterStage> parseFilterChain(const std::string &chain) {
+        std::vector<FilterStage> filters;
+        for (const std::string &part : split(chain, ',')) {
+            std::string text = trim(part);
+            if (text.empty()) throw std::runtime_error("Empty filter in chain \"" + chain + "\"");
+            filters.push_back(parseFilter(text));
+        }
+        return filters;
+    }
+
+    std::vector<std::vector<FilterStage>> fuseFilters(const std::vector<FilterStage> &filters, bool fuse) {
+        std::vector<std::vector<FilterStage>> runs;
+        int halo = 0;
+        for (const FilterStage &filter : filters) {
+            int radius = filter.stencil.radius();
+            // A filter wider than the limit still runs, in a run of its own
+            if (runs.empty() || !fuse || halo + radius > MaxFusedHalo) {
+                runs.emplace_back();
+                halo = 0;
+            }
+            runs.back().push_back(filter);
+            halo += radius;
+        }
+        return runs;
+    }
+
+    bool supportsFilterChain(const std::string &mode) {
+        return mode == "default" || mode == "threads" || mode == "simd" || mode == "simd-threads" || mode == "tiled";
+    }
+
+    std::unique_ptr<PipelineNode> createFilterChain(const std::string &mode, const BlurOptions &options) {
+        if (!supportsFilterChain(mode) || options.filters.empty()) return nullptr;
+
+        // The scalar modes keep the scalar kernels, the others take the ones CpuDispatch picked
+        const kernels::KernelSet &kernels = (mode == "default" || mode == "threads") ? kernels::scalarKernels() : kernels::activeKernels();
+        bool threaded = mode == "threads" || mode == "simd-threads" || mode == "tiled";
+
+        std::unique_ptr<PipelineNode> head;
+        PipelineNode* last = nullptr;
+        for (const std::vector<FilterStage> &run : fuseFilters(options.filters, options.fuse)) {
+            std::vector<kernels::Stencil> stages;
+            std::string name;
+            for (const FilterStage &filter : run) {
+                stages.push_back(filter.stencil);
+                name += (name.empty() ? "" : ",") + filter.name;
+            }
+
+            auto node = std::make_unique<StencilProcNode>(stages, options, kernels, threaded);
+            node->setName("filter " + name);
+            PipelineNode* current = node.get();
+            if (last) last->setNext(std::move(node));
+            else head = std::move(node);
+            last = current;
+        }
+        return head;
+    }
+}
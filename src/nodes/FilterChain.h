@@ -0,0 +1,49 @@
+/*
+ * Filter Chain
+ * ============
+ *
+ * The -f option: a chain of neighbourhood filters such as
+ * "blur=sigma=2,sharpen=0.5,blur" instead of the mode's single blur. The
+ * fusion pass merges adjacent filters into runs, and each run becomes one
+ * StencilProcNode that reads and writes every plane once, so three filters
+ * no longer cost three full sweeps over the frame.
+ *
+ * Author: Finoshkin Aleksei
+ * License: MIT
+ */
+
+#ifndef IMG_DEINT_FILTER_CHAIN_H
+#define IMG_DEINT_FILTER_CHAIN_H
+
+
+#include "base/Pipeline.h"
+#include "BlurOptions.h"
+
+namespace media_proc {
+
+    // Largest halo of a fused run. A run keeps about two rows per halo row in its rings, so beyond
+    // this those of a 4K RGBA plane outgrow a 2 MB L2 and every stage would miss on its input.
+    constexpr int MaxFusedHalo = 64;
+
+    // Filters are separated by commas, a filter's options follow '=' and are separated by colons,
+    // each as key=value or as the value of the filter's first option:
+    //   blur                    3x3 kernel at --precision
+    //   blur=sigma=2:radius=6   separable Gaussian, either option alone is enough; blur=2 is sigma 2
+    //   sharpen=0.5             unsharp mask of the given amount (default 1, at most 8)
+    // Throws std::runtime_error naming the filter that does not parse.
+    std::vector<FilterStage> parseFilterChain(const std::string &chain);
+
+    // Fusion pass: cuts the chain into runs of adjacent filters that one sweep applies together. A run
+    // ends before its halo would exceed MaxFusedHalo; without `fuse` every filter is a run of its own.
+    std::vector<std::vector<FilterStage>> fuseFilters(const std::vector<FilterStage> &filters, bool fuse);
+
+    // Modes whose kernels and threads a chain can run on: every CPU mode but async
+    bool supportsFilterChain(const std::string &mode);
+
+    // Head of a chain of StencilProcNodes, one per run of fuseFilters(options.filters, options.fuse),
+    // named "filter <filters>"; nullptr for a mode without filter chains
+    std::unique_ptr<PipelineNode> createFilterChain(const std::string &mode, const BlurOptions &options);
+}
+
+
+#endif //!IMG_DEINT_FILTER_CHAIN_H
@@ -0,0 +1,93 @@
+#include "GpuBackend.h"
+
+#include <cstdlib>
+#include <mutex>
+#include <stdexcept>
+
+#if defined(LINUX) && !defined(DISABLE_GPU) && !defined(GPU_BUILTIN)
+#include <dlfcn.h>
+#include <unistd.h>
+#endif
+
+#ifdef GPU_BUILTIN
+extern "C" media_proc::PipelineNode* img_blur_create_gpu_processor();
+#endif
+
+namespace media_proc {
+
+    using CreateGpuProcessor = PipelineNode* (*)();
+    using GpuPluginVersionQuery = int (*)();
+
+#if defined(LINUX) && !defined(DISABLE_GPU) && !defined(GPU_BUILTIN)
+    static std::string executableDirectory() {
+        char path[4096];
+        ssize_t length = readlink("/proc/self/exe", path, sizeof(path) - 1);
+        if (length <= 0) return "";
+        std::string executable(path, (size_t)length);
+        size_t slash = executable.find_last_of('/');
+        return slash == std::string::npos ? "" : executable.substr(0, slash + 1);
+    }
+
+    // Loaded once and never unloaded: nodes, their vtables and GL state live in it until exit
+    static CreateGpuProcessor loadPlugin() {
+        static std::once_flag loaded;
+        static CreateGpuProcessor factory = nullptr;
+        static std::string error;
+
+        std::call_once(loaded, []() {
+            const char* library = "libimg_blur_gpu.so";
+            std::vector<std::string> candidates;
+            if (const char* path = std::getenv("IMG_BLUR_GPU_PLUGIN")) candidates.push_back(path);
+            std::string directory = executableDirectory();
+            if (!directory.empty()) {
+                candidates.push_back(directory + library);
+                candidates.push_back(directory + "../img_blur_gpu/" + library);  // bin/<config>/img_blur_gpu of a premake build
+            }
+            candidates.push_back(library);
+
+            void* handle = nullptr;
+            for (const std::string &candidate : candidates) {
+                // RTLD_NOW: a plugin missing a symbol fails here, not in the middle of a frame
+                handle = dlopen(candidate.c_str(), RTLD_NOW | RTLD_LOCAL);
+                if (handle) break;
+                error += (error.empty() ? "" : "; ") + std::string(dlerror());
+            }
+            if (!handle) {
+                error = "Cannot load the GPU plugin: " + error;
+                return;
+            }
+
+            auto version = reinterpret_cast<GpuPluginVersionQuery>(dlsym(handle, "img_blur_gpu_plugin_version"));
+            auto create = reinterpret_cast<CreateGpuProcessor>(dlsym(handle, "img_blur_create_gpu_processor"));
+            if (!version || !create) error = "The GPU plugin has no img_blur entry points";
+            else if (version() != GpuPluginVersion) error = "The GPU plugin was built from another version of img_blur";
+            else factory = create;
+        });
+
+        if (!factory) throw std::runtime_error(error);
+        return factory;
+    }
+#endif
+
+    void loadGpuBackend() {
+    #if defined(DISABLE_GPU)
+        throw std::runtime_error("gpu mode is not available in this build (premake5 --cpu-only)");
+    #elif defined(LINUX) && !defined(GPU_BUILTIN)
+        loadPlugin();
+    #elif !defined(GPU_BUILTIN)
+        throw std::runtime_error("gpu mode is not available on this platform");
+    #endif
+    }
+
+    std::unique_ptr<PipelineNode> createGpuProcessor() {
+    #if defined(DISABLE_GPU)
+        throw std::runtime_error("gpu mode is not available in this build (premake5 --cpu-only)");
+    #elif defined(GPU_BUILTIN)
+        return std::unique_ptr<PipelineNode>(img_blur_create_gpu_processor());
+    #elif defined(LINUX)
+        return std::unique_ptr<PipelineNode>(loadPlugin()());
+    #else
+        throw std::runtime_error("gpu mode is not available on this platform");
+    #endif
+    }
+}
@@ -0,0 +1,44 @@
+/*
+ * GPU Backend
+ * ===========
+ *
+ * Loads the OpenGL blur from the img_blur_gpu plugin the first time gpu mode asks
+ * for a processor. Only the plugin links GL, X11 and GLFW, so CPU modes never map
+ * them and the tool starts without their relocations. The plugin resolves FFmpeg
+ * and the pipeline's pools and metrics against the executable, which exports them.
+ *
+ * The plugin is searched as $IMG_BLUR_GPU_PLUGIN, then next to the executable, then
+ * in the build tree's img_blur_gpu directory, then on the loader's search path.
+ *
+ * Author: Finoshkin Aleksei
+ * License: MIT
+ */
+
+#ifndef IMG_DEINT_GPU_BACKEND_H
+#define IMG_DEINT_GPU_BACKEND_H
+
+
+#include "base/Pipeline.h"
+
+#if defined(WINDOWS)
+#define GPU_PLUGIN_EXPORT __declspec(dllexport)
+#else
+#define GPU_PLUGIN_EXPORT __attribute__((visibility("default")))
+#endif
+
+namespace media_proc {
+
+    // Bumped whenever PipelineNode or the pools change layout, a stale plugin is refused
+    constexpr int GpuPluginVersion = 1;
+
+    // A new GPU blur node. Throws std::runtime_error when the build has no GPU backend or
+    // the plugin can't be loaded, with the loader's reason.
+    std::unique_ptr<PipelineNode> createGpuProcessor();
+
+    // Loads the plugin right away, so a missing one is reported before any work starts.
+    // Throws like createGpuProcessor().
+    void loadGpuBackend();
+}
+
+
+#endif //!IMG_DEINT_GPU_BACKEND_H
@@ -0,0 +1,40 @@
+#include "StencilProcNode.h"
+
+#include "utils/Executor.h"
+
+namespace media_proc {
+
+    StencilProcNode::StencilProcNode(const std::vector<kernels::Stencil> &stages, const BlurOptions &options, const kernels::KernelSet &kernels, bool threaded)
+        : m_Stages(stages), m_Kernels{ kernels.blurRow(options.precision), kernels.gaussianTaps, kernels.sharpenRow } {
+        if (threaded) m_Executor = &Executor::withThreads(options.threads);
+    }
+    StencilProcNode::~StencilProcNode() { }
+
+    void StencilProcNode::filter(AVFrame* frame) {
+        TRACE_SPAN("filter");
+        if (!frame || !frame->data[0]) throw std::runtime_error("Invalid frame data");
+
+        int width = frame->width;
+        int height = frame->height;
+        if (width <= 0 || height <= 0) throw std::runtime_error("Invalid frame dimensions");
+
+        for (int index = 0; index < m_Layout.planeCount(); ++index) {
+            PlaneView plane = m_Layout.plane(frame, index);
+            if (!plane.data || plane.height <= 0) continue;
+            TRACE_SPAN_ARG("plane", "index", index);
+
+            kernels::filterPlaneFused(plane.data, plane.stride, plane.width, plane.height, plane.step, m_Stages.data(), (int)m_Stages.size(),
+                                      m_Kernels, m_Executor);
+        }
+    }
+
+    void StencilProcNode::init(std::shared_ptr<const PipelineContext> context) {
+        m_Layout.init(context->pixelFormat);
+        if (m_Layout.hasWideSamples()) throw std::runtime_error("Filter chains support 8-bit samples only");
+    }
+
+    std::unique_ptr<PipelinePacket> StencilProcNode::updatePacket(std::unique_ptr<PipelinePacket> packet) {
+        if(packet) filter(packet->frame);
+        return std::move(packet);
+    };
+}
@@ -0,0 +1,48 @@
+/*
+ * Stencil Processor Node
+ * ======================
+ *
+ * One link of a -f filter chain: applies a run of filters the fusion pass
+ * merged to every plane in a single streamed sweep through the stencil chain
+ * engine. Runs the kernels and threads of the mode it was built for.
+ *
+ * Author: Finoshkin Aleksei
+ * License: MIT
+ */
+
+#ifndef IMG_DEINT_STENCIL_PROCESSOR_NODE_H
+#define IMG_DEINT_STENCIL_PROCESSOR_NODE_H
+
+
+#include "base/Processor.h"
+#include "base/PixelLayout.h"
+#include "BlurOptions.h"
+#include "kernels/CpuDispatch.h"
+
+namespace media_proc {
+
+    class Executor;
+
+    class StencilProcNode : public Processor {
+    public:
+        // Strips run on the executor of `options.threads` when `threaded`, otherwise on the pipeline's thread
+        StencilProcNode(const std::vector<kernels::Stencil> &stages, const BlurOptions &options, const kernels::KernelSet &kernels, bool threaded);
+        ~StencilProcNode();
+
+    private:
+        void filter(AVFrame* frame);
+
+    private:
+        virtual void init(std::shared_ptr<const PipelineContext> context) override;
+        virtual std::unique_ptr<PipelinePacket> updatePacket(std::unique_ptr<PipelinePacket> packet) override;
+
+    private:
+        std::vector<kernels::Stencil> m_Stages;
+        kernels::StencilKernels m_Kernels;
+        Executor* m_Executor = nullptr;
+        PixelLayout m_Layout;
+    };
+}
+
+
+#endif //!IMG_DEINT_STENCIL_PROCESSOR_NODE_H
@@ -21,21 +21,30 @@ namespace media_proc {
     //Template Method
     class Decoder : public PipelineNode {
     public:
+        Decoder() { setName("decoder"); }
         virtual ~Decoder() = default;
         
     public:
         virtual std::unique_ptr<PipelinePacket> onPacket(std::unique_ptr<PipelinePacket> packet = nullptr) final override {
+            TRACE_SPAN("decode");
+            MEMORY_TAG_SCOPE(Decoder);
+            auto start = std::chrono::steady_clock::now();
             if(!m_NodeInit) { init(); m_NodeInit = true; }
             
             packet = getPacket();
             if(!packet) m_EOS = true;
 
+            recordCall(start, packet ? packet->frame : nullptr);
             return std::move(packet);
         }
         virtual bool isComplete() final override { 
             return m_EOS;
         };
 
+    protected:
+        // Rewinds the node so the next onPacket() calls init() again, e.g. after a new input was set
+        void restart() { m_EOS = false; m_NodeInit = false; }
+
     private:
         virtual void init() = 0;
         virtual std::unique_ptr<PipelinePacket> getPacket() = 0;
@@ -21,20 +21,34 @@ namespace media_proc {
     //Template Method
     class Encoder : public PipelineNode {
     public:
+        Encoder() { setName("encoder"); }
         virtual ~Encoder() = default;
 
     public:
         virtual std::unique_ptr<PipelinePacket> onPacket(std::unique_ptr<PipelinePacket> packet = nullptr) final {
-            if(!m_NodeInit) { init(packet->context); m_NodeInit = true; }
+            TRACE_SPAN("encode");
+            MEMORY_TAG_SCOPE(Encoder);
+            auto start = std::chrono::steady_clock::now();
+            if(packet && packet->context != m_Context) { init(packet->context); m_Context = packet->context; }
+
+            // The packet is gone after writePacket(), so its size is taken first
+            bool handledFrame = packet != nullptr;
+            uint64_t bytes = frameBytes(packet ? packet->frame : nullptr);
             writePacket(std::move(packet));
+            recordCall(start, handledFrame, bytes);
+            if(handledFrame) MEMORY_FRAME_DONE();
             return nullptr;
         }
 
+    protected:
+        // Forces init() on the next packet, e.g. after the node was pointed at a new output
+        void restart() { m_Context = nullptr; }
+
     private:
         virtual void init(std::shared_ptr<const PipelineContext> context) = 0;
         virtual void writePacket(std::unique_ptr<PipelinePacket> packet) = 0;
 
-        bool m_NodeInit = false;
+        std::shared_ptr<const PipelineContext> m_Context = nullptr;
     };
 }
 
@@ -0,0 +1,155 @@
+/*
+ * Frame Pool
+ * ==========
+ *
+ * Recycles AVFrame shells and provides a get_buffer2 callback that serves decoder
+ * planes from aligned buffer pools keyed by (codec, pixel format, width, height).
+ *
+ * Author: Finoshkin Aleksei
+ * License: MIT
+ */
+
+#ifndef IMG_DEINT_FRAME_POOL_H
+#define IMG_DEINT_FRAME_POOL_H
+
+
+#include <StdAfx.h>
+#include "utils/BufferPool.h"
+
+#include <map>
+#include <mutex>
+#include <tuple>
+
+namespace media_proc {
+
+    class FramePool {
+    public:
+        static FramePool& global() {
+            static FramePool pool;
+            return pool;
+        }
+
+        ~FramePool() {
+            for (AVFrame* frame : m_Frames) av_frame_free(&frame);
+            for (auto &[key, layout] : m_Layouts) {
+                for (AVBufferPool* &pool : layout.pools) av_buffer_pool_uninit(&pool);
+            }
+        }
+
+        AVFrame* acquireFrame() {
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                if (!m_Frames.empty()) {
+                    AVFrame* frame = m_Frames.back();
+                    m_Frames.pop_back();
+                    return frame;
+                }
+            }
+            AVFrame* frame = av_frame_alloc();
+            if (!frame) throw std::runtime_error("Failed to allocate frame");
+            return frame;
+        }
+
+        // Frame shells waiting for reuse
+        size_t cachedFrames() {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            return m_Frames.size();
+        }
+
+        // Drops the frame's buffer references (planes go back to their pool) and keeps the shell
+        void releaseFrame(AVFrame* frame) {
+            if (!frame) return;
+            av_frame_unref(frame);
+
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            if (m_Frames.size() < MaxCachedFrames) m_Frames.push_back(frame);
+            else av_frame_free(&frame);
+        }
+
+        // AVCodecContext::get_buffer2 replacement: 64-byte aligned planes and linesizes from pooled memory
+        static int getBuffer(AVCodecContext *context, AVFrame *frame, int flags) {
+            const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(static_cast<AVPixelFormat>(frame->format));
+            if (!(context->codec->capabilities & AV_CODEC_CAP_DR1) || !desc ||
+                (desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM))) {
+                return avcodec_default_get_buffer2(context, frame, flags);
+            }
+            return global().allocateBuffers(context, frame);
+        }
+
+    private:
+        static constexpr size_t MaxCachedFrames = 64;
+
+        struct FrameLayout {
+            int linesizes[4] = {};
+            AVBufferPool* pools[4] = {};
+        };
+        using LayoutKey = std::tuple<int, int, int, int>;
+
+        static AVBufferRef* allocatePlane(void*, size_t size) {
+            uint8_t* data = static_cast<uint8_t*>(BufferPool::allocateAligned(size, BufferPool::global().hugePages()));
+            // The opaque pointer carries the size back to the free callback
+            AVBufferRef* buffer = av_buffer_create(data, size, [](void* size, uint8_t* data) { BufferPool::freeAligned(data, (size_t)(uintptr_t)size); },
+                                                   (void*)(uintptr_t)size, 0);
+            if (!buffer) BufferPool::freeAligned(data, size);
+            return buffer;
+        }
+
+        FrameLayout* getLayout(AVCodecContext *context, AVPixelFormat format, int width, int height) {
+            LayoutKey key { context->codec_id, format, width, height };
+            auto it = m_Layouts.find(key);
+            if (it != m_Layouts.end()) return &it->second;
+
+            // Same padding rules as avcodec_default_get_buffer2, with linesizes rounded up to the pool alignment
+            int alignedWidth = width, alignedHeight = height;
+            int linesizeAlign[AV_NUM_DATA_POINTERS];
+            avcodec_align_dimensions2(context, &alignedWidth, &alignedHeight, linesizeAlign);
+
+            FrameLayout layout;
+            if (av_image_fill_linesizes(layout.linesizes, format, alignedWidth) < 0) return nullptr;
+
+            ptrdiff_t linesizes[4];
+            for (int i = 0; i < 4; ++i) {
+                layout.linesizes[i] = FFALIGN(layout.linesizes[i], (int)BufferPool::Alignment);
+                linesizes[i] = layout.linesizes[i];
+            }
+
+            size_t planeSizes[4];
+            if (av_image_fill_plane_sizes(planeSizes, format, alignedHeight, linesizes) < 0) return nullptr;
+
+            for (int i = 0; i < 4 && planeSizes[i]; ++i) {
+                layout.pools[i] = av_buffer_pool_init2(planeSizes[i] + BufferPool::Alignment, nullptr, allocatePlane, nullptr);
+                if (!layout.pools[i]) return nullptr;
+            }
+            return &m_Layouts.emplace(key, layout).first->second;
+        }
+
+        int allocateBuffers(AVCodecContext *context, AVFrame *frame) {
+            FrameLayout* layout = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                layout = getLayout(context, static_cast<AVPixelFormat>(frame->format), frame->width, frame->height);
+            }
+            if (!layout) return AVERROR(EINVAL);
+
+            for (int i = 0; i < 4 && layout->pools[i]; ++i) {
+                frame->buf[i] = av_buffer_pool_get(layout->pools[i]);
+                if (!frame->buf[i]) {
+                    av_frame_unref(frame);
+                    return AVERROR(ENOMEM);
+                }
+                frame->data[i] = frame->buf[i]->data;
+                frame->linesize[i] = layout->linesizes[i];
+            }
+            frame->extended_data = frame->data;
+            return 0;
+        }
+
+    private:
+        std::mutex m_Mutex;
+        std::vector<AVFrame*> m_Frames;
+        std::map<LayoutKey, FrameLayout> m_Layouts;
+    };
+}
+
+
+#endif //!IMG_DEINT_FRAME_POOL_H
@@ -14,6 +14,14 @@
 
 
 #include <StdAfx.h>
+#include "utils/SPSCQueue.h"
+#include "utils/Metrics.h"
+#include "FramePool.h"
+
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <exception>
 
 namespace media_proc {
     class PipelineContext {
@@ -22,12 +30,18 @@ namespace media_proc {
         int width = 0, height = 0;
         AVPixelFormat pixelFormat;
         AVRational timeBase, aspectRatio, frameRate;
+        AVRational sampleAspectRatio = { 0, 1 };   // Of the source pixels, 0/1 when unknown
 
     public:
         PipelineContext(const std::vector<int> &linesizes, int width, int height, AVPixelFormat pixelFormat, AVRational timeBase, AVRational frameRate):
             linesizes(linesizes), width(width), height(height), pixelFormat(pixelFormat), timeBase(timeBase), frameRate(frameRate) {
             aspectRatio = { width, height };
         };
+
+        // Same geometry and layout, so nodes initialized for one can process the other
+        bool isCompatible(const PipelineContext &other) const {
+            return width == other.width && height == other.height && pixelFormat == other.pixelFormat && linesizes == other.linesizes;
+        }
     };
 
     class PipelinePacket {
@@ -36,7 +50,38 @@ namespace media_proc {
         std::shared_ptr<const PipelineContext> context;
 
     public:
-        PipelinePacket(AVFrame *frame, std::shared_ptr<const PipelineContext> ctx) : frame(frame), context(ctx) {}
+        PipelinePacket(AVFrame *frame, std::shared_ptr<const PipelineContext> ctx) : frame(frame), context(ctx) { inFlight().add(1); }
+        PipelinePacket(const PipelinePacket&) = delete;
+        PipelinePacket& operator=(const PipelinePacket&) = delete;
+
+        // The packet owns its frame; the shell and its planes go back to the pools
+        ~PipelinePacket() {
+            FramePool::global().releaseFrame(frame);
+            inFlight().add(-1);
+        }
+
+        static Gauge& inFlight() {
+            static Gauge &gauge = MetricsRegistry::global().gauge("img_blur_packets_in_flight", "Packets created and not yet destroyed");
+            return gauge;
+        }
+
+        // One packet per frame is created and destroyed, keep them off the heap
+        static void* operator new(size_t size) { return BufferPool::global().allocate(size); }
+        static void operator delete(void* ptr, size_t size) { BufferPool::global().release(ptr, size); }
+    };
+
+    using PacketQueue = SPSCQueue<std::unique_ptr<PipelinePacket>>;
+
+    // Series of one node in the metrics registry, labelled with the node's name
+    struct NodeMetrics {
+        explicit NodeMetrics(const std::string &node) :
+            latency(MetricsRegistry::global().histogram("img_blur_node_latency_seconds", "Duration of one call into a pipeline node", MetricsRegistry::label("node", node))),
+            frames(MetricsRegistry::global().counter("img_blur_node_frames_total", "Frames a pipeline node has handled", MetricsRegistry::label("node", node))),
+            bytes(MetricsRegistry::global().counter("img_blur_node_bytes_total", "Plane bytes of the frames a pipeline node has handled", MetricsRegistry::label("node", node))) { }
+
+        Histogram &latency;
+        Counter &frames;
+        Counter &bytes;
     };
 
     //Chain of Responsibilities
@@ -45,9 +90,29 @@ namespace media_proc {
         std::unique_ptr<PipelineNode> m_NextNode;
 
     public: 
+        virtual ~PipelineNode() = default;
+
         void setNext(std::unique_ptr<PipelineNode> nextNode) { 
             m_NextNode = std::move(nextNode); 
         }
+
+        // Last node of the chain starting here; a processor can be a chain of several nodes (-f)
+        PipelineNode& tail() {
+            PipelineNode* node = this;
+            while (node->m_NextNode) node = node->m_NextNode.get();
+            return *node;
+        }
+
+        // Hands one packet to this node and every node after it, for callers that drive a processor
+        // chain frame by frame without a decoder or encoder around it
+        std::unique_ptr<PipelinePacket> processChain(std::unique_ptr<PipelinePacket> packet) {
+            for (PipelineNode* node = this; node && packet; node = node->m_NextNode.get()) packet = node->onPacket(std::move(packet));
+            return packet;
+        }
+
+        // Label of the node's metrics; takes effect if set before the first packet
+        void setName(const std::string &name) { m_Name = name; }
+        const std::string& name() const { return m_Name; }
         virtual std::unique_ptr<PipelinePacket> onPacket(std::unique_ptr<PipelinePacket> packet = nullptr) { 
             return nullptr; 
         };
@@ -59,6 +124,97 @@ namespace media_proc {
                 if (m_NextNode) m_NextNode->execute(std::move(packet));
             } while(!isComplete());
         }
+
+        // Runs every node of the chain on its own worker thread. Neighbouring nodes are
+        // connected by bounded SPSC queues, so a slow stage applies backpressure upstream
+        // and the wall time approaches the slowest stage instead of the sum of all stages.
+        void executeConcurrent(size_t queueDepth = 4) {
+            std::vector<PipelineNode*> nodes;
+            for (PipelineNode* node = this; node; node = node->m_NextNode.get()) nodes.push_back(node);
+
+            std::vector<std::unique_ptr<PacketQueue>> queues;
+            for (size_t i = 1; i < nodes.size(); ++i) queues.push_back(std::make_unique<PacketQueue>(std::max<size_t>(queueDepth, 1)));
+
+            // Declared after the queues, so the gauges are gone before the queues they read
+            std::vector<std::unique_ptr<ScopedMetric>> queueDepths;
+            for (size_t i = 0; i < queues.size(); ++i) {
+                PacketQueue* queue = queues[i].get();
+                queueDepths.push_back(std::make_unique<ScopedMetric>("img_blur_queue_depth", "Packets waiting between two concurrent pipeline stages",
+                                                                     MetricsRegistry::label("queue", nodes[i]->name() + " -> " + nodes[i + 1]->name()),
+                                                                     [queue]() { return (double)queue->size(); }));
+            }
+
+            std::vector<std::exception_ptr> errors(nodes.size());
+            std::vector<std::thread> workers;
+            for (size_t i = 0; i < nodes.size(); ++i) {
+                PacketQueue* input = i > 0 ? queues[i - 1].get() : nullptr;
+                PacketQueue* output = i + 1 < nodes.size() ? queues[i].get() : nullptr;
+
+                workers.emplace_back([&nodes, &queues, &errors, i, input, output]() {
+                    TRACE_THREAD_NAME("pipeline stage " + std::to_string(i));
+                    try { nodes[i]->runStage(input, output); }
+                    catch (...) {
+                        errors[i] = std::current_exception();
+                        for (auto &queue : queues) queue->abort();
+                    }
+                });
+            }
+
+            for (auto &worker : workers) worker.join();
+            for (auto &error : errors) if (error) std::rethrow_exception(error);
+        }
+
+    protected:
+        static uint64_t frameBytes(const AVFrame* frame) {
+            if (!frame) return 0;
+            int bytes = av_image_get_buffer_size(static_cast<AVPixelFormat>(frame->format), frame->width, frame->height, 1);
+            return bytes > 0 ? (uint64_t)bytes : 0;
+        }
+
+        // Records one onPacket() call that started at `start` and handled a frame of `bytes`, if any
+        void recordCall(std::chrono::steady_clock::time_point start, bool handledFrame, uint64_t bytes) {
+            if (!m_Metrics) m_Metrics = std::make_unique<NodeMetrics>(m_Name);
+            m_Metrics->latency.observeNs(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+            if (!handledFrame) return;
+            m_Metrics->frames.add();
+            m_Metrics->bytes.add(bytes);
+        }
+
+        void recordCall(std::chrono::steady_clock::time_point start, const AVFrame* frame) {
+            recordCall(start, frame != nullptr, frameBytes(frame));
+        }
+
+    private:
+        std::string m_Name = "node";
+        std::unique_ptr<NodeMetrics> m_Metrics;
+
+        // Mirrors execute(): the source node is polled until isComplete(), every other node
+        // gets one call per input packet plus a final nullptr once upstream reaches EOS
+        void runStage(PacketQueue* input, PacketQueue* output) {
+            auto forward = [output](std::unique_ptr<PipelinePacket> packet) {
+                if (!output || !packet) return true;
+                return output->push(std::move(packet));
+            };
+
+            if (!input) {
+                do {
+                    if (!forward(onPacket(nullptr))) return;
+                } while (!isComplete());
+            }
+            else {
+                std::unique_ptr<PipelinePacket> packet;
+                while (input->pop(packet)) {
+                    if (!forward(onPacket(std::move(packet)))) return;
+                    while (!isComplete()) {
+                        if (!forward(onPacket(nullptr))) return;
+                    }
+                }
+                if (input->isAborted()) return;
+                if (!forward(onPacket(nullptr))) return;
+            }
+
+            if (output) output->close();
+        }
     };
 }
 
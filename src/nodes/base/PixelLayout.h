@@ -0,0 +1,162 @@
+/*
+ * Pixel Layout
+ * ============
+ *
+ * Tells the CPU blur nodes how to walk the planes of a frame, read once from the
+ * AVPixFmtDescriptor in init(). Packed RGB and semi-planar chroma stay where
+ * they are: the distance between two pixels of one channel becomes the kernel
+ * step, so interleaved data is blurred natively without going through swscale.
+ * The component depth and flags pick the sample type, so 16-bit, half and
+ * float planes are blurred in their own precision as well. Big-endian formats
+ * (16-bit PNG, Motorola TIFF) are swapped to host order around the blur.
+ *
+ * Author: Finoshkin Aleksei
+ * License: MIT
+ */
+
+#ifndef IMG_DEINT_PIXEL_LAYOUT_H
+#define IMG_DEINT_PIXEL_LAYOUT_H
+
+
+#include <StdAfx.h>
+#include "kernels/BlurKernels.h"
+
+#include <algorithm>
+
+namespace media_proc {
+
+    // One plane of a frame as the row kernels see it
+    struct PlaneView {
+        uint8_t* data = nullptr;
+        int stride = 0;      // Bytes between rows
+        int width = 0;       // Samples in a row, all interleaved channels counted, linesize padding excluded
+        int height = 0;
+        int step = 1;        // Samples between horizontally neighbouring pixels of one channel
+        kernels::SampleType type = kernels::SampleType::U8;
+        int shift = 0;       // Unused low bits of a 16-bit sample (6 for P010)
+    };
+
+    class PixelLayout {
+    public:
+        void init(AVPixelFormat format) {
+            m_Format = format;
+            m_PlaneCount = 0;
+
+            const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format);
+            if (!desc) return;
+
+            m_PlaneCount = av_pix_fmt_count_planes(format);
+            m_Log2ChromaHeight = desc->log2_chroma_h;
+
+            for (PlaneFormat &plane : m_Planes) plane = PlaneFormat{};
+            m_Native = readComponents(desc);
+
+            // Palette, bitstream and mixed layouts like YUYV: every plane is a run of bytes, which is
+            // what the blur always did for them
+            if (!m_Native) for (PlaneFormat &plane : m_Planes) plane = PlaneFormat{};
+            m_SwapBytes = m_Native && (desc->flags & AV_PIX_FMT_FLAG_BE) && hasWideSamples();
+        }
+
+        int planeCount() const { return m_PlaneCount; }
+
+        // False when the format fell back to blurring raw bytes
+        bool isNative() const { return m_Native; }
+
+        // True when any plane holds samples wider than 8 bits
+        bool hasWideSamples() const {
+            return std::any_of(m_Planes, m_Planes + MaxPlanes, [](const PlaneFormat &plane) { return plane.type != kernels::SampleType::U8; });
+        }
+
+        // Big-endian wide samples: the nodes call this before blurring a frame and again once every
+        // plane is done, so the kernels see host order and the frame leaves in its own. No-op otherwise.
+        void swapByteOrder(AVFrame* frame) const {
+            if (!m_SwapBytes) return;
+            for (int index = 0; index < m_PlaneCount; ++index) {
+                PlaneView view = plane(frame, index);
+                int size = kernels::sampleSize(view.type);
+                if (!view.data || size == 1) continue;
+
+                for (int y = 0; y < view.height; ++y) {
+                    uint8_t* row = view.data + (size_t)y * view.stride;
+                    for (int x = 0; x < view.width * size; x += size) std::reverse(row + x, row + x + size);
+                }
+            }
+        }
+
+        // Plane `index` of a frame in this format; data is null when the frame does not carry it
+        PlaneView plane(const AVFrame* frame, int index) const {
+            PlaneView view;
+            if (index >= m_PlaneCount || !frame->data[index] || frame->linesize[index] <= 0) return view;
+
+            const PlaneFormat &format = m_Planes[index];
+            view.data = frame->data[index];
+            view.stride = frame->linesize[index];
+            view.height = (index == 1 || index == 2) ? AV_CEIL_RSHIFT(frame->height, m_Log2ChromaHeight) : frame->height;
+            view.step = format.step;
+            view.type = format.type;
+            view.shift = format.shift;
+
+            int rowBytes = view.stride;
+            if (m_Native) rowBytes = std::min(rowBytes, av_image_get_linesize(m_Format, frame->width, index));
+            view.width = rowBytes / kernels::sampleSize(format.type);
+            return view;
+        }
+
+    private:
+        static constexpr int MaxPlanes = 4;
+
+        struct PlaneFormat {
+            int step = 1;
+            kernels::SampleType type = kernels::SampleType::U8;
+            int shift = 0;
+        };
+
+        static bool sampleType(const AVPixFmtDescriptor *desc, const AVComponentDescriptor &comp, kernels::SampleType &type) {
+            if (desc->flags & AV_PIX_FMT_FLAG_FLOAT) {
+                if (comp.shift != 0) return false;
+                if (comp.depth == 32) type = kernels::SampleType::Float;
+                else if (comp.depth == 16) type = kernels::SampleType::Half;
+                else return false;
+            }
+            else if (comp.depth == 8 && comp.shift == 0) type = kernels::SampleType::U8;
+            else if (comp.depth > 8 && comp.depth + comp.shift <= 16) type = kernels::SampleType::U16;
+            else return false;
+            return true;
+        }
+
+        // Components sharing a plane must agree on type, step and shift; their byte step becomes the sample step
+        bool readComponents(const AVPixFmtDescriptor *desc) {
+            if (desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_BITSTREAM | AV_PIX_FMT_FLAG_HWACCEL)) return false;
+
+            bool seen[MaxPlanes] = {};
+            for (int c = 0; c < desc->nb_components; ++c) {
+                const AVComponentDescriptor &comp = desc->comp[c];
+                kernels::SampleType type;
+                if (comp.plane >= MaxPlanes || !sampleType(desc, comp, type)) return false;
+
+                int size = kernels::sampleSize(type);
+                if (comp.step % size != 0 || comp.offset % size != 0) return false;
+
+                PlaneFormat format{ comp.step / size, type, comp.shift };
+                PlaneFormat &planeFormat = m_Planes[comp.plane];
+                if (!seen[comp.plane]) {
+                    planeFormat = format;
+                    seen[comp.plane] = true;
+                }
+                else if (planeFormat.step != format.step || planeFormat.type != format.type || planeFormat.shift != format.shift) return false;
+            }
+            return true;
+        }
+
+    private:
+        AVPixelFormat m_Format = AV_PIX_FMT_NONE;
+        int m_PlaneCount = 0;
+        int m_Log2ChromaHeight = 0;
+        bool m_Native = false;
+        bool m_SwapBytes = false;
+        PlaneFormat m_Planes[MaxPlanes];
+    };
+}
+
+
+#endif //!IMG_DEINT_PIXEL_LAYOUT_H
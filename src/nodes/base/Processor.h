@@ -21,19 +21,29 @@ namespace media_proc {
     //Template Method
     class Processor : public PipelineNode {
     public:
+        Processor() { setName("processor"); }
         virtual ~Processor() = default;
 
     public:
         virtual std::unique_ptr<PipelinePacket> onPacket(std::unique_ptr<PipelinePacket> packet = nullptr) final {
-            if(!m_NodeInit) { init(packet->context); m_NodeInit = true; }
-            return updatePacket(std::move(packet));
+            TRACE_SPAN("process");
+            MEMORY_TAG_SCOPE(Processor);
+            auto start = std::chrono::steady_clock::now();
+            if(packet && packet->context != m_Context) {
+                // Nodes reused across inputs (batch mode) only re-init when the geometry changes
+                if(!m_Context || !m_Context->isCompatible(*packet->context)) init(packet->context);
+                m_Context = packet->context;
+            }
+            packet = updatePacket(std::move(packet));
+            recordCall(start, packet ? packet->frame : nullptr);
+            return packet;
         }
 
     private:
         virtual void init(std::shared_ptr<const PipelineContext> context) {};
         virtual std::unique_ptr<PipelinePacket> updatePacket(std::unique_ptr<PipelinePacket> packet) = 0;
 
-        bool m_NodeInit = false;
+        std::shared_ptr<const PipelineContext> m_Context = nullptr;
     };
 }
 
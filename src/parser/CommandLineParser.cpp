@@ -4,12 +4,17 @@
 #include <regex>
 
 namespace media_proc {
+	// A lone "-" is a value, the usual name for stdin/stdout
+	static bool isOptionName(const std::string& arg) {
+		return arg.rfind("-", 0) == 0 && arg != "-";
+	}
+
 	class DoubleDashExpression : public Expression {
 	public:
 		void interpret(Context& ctx, const std::vector<std::string>& args) override {
 			for (size_t i = 0; i < args.size(); ++i) {
 				if (args[i].rfind("--", 0) == 0) {
-					if (i + 1 < args.size() && args[i + 1].rfind("-", 0) != 0) {
+					if (i + 1 < args.size() && !isOptionName(args[i + 1])) {
 						ctx.set(args[i], args[i + 1]);
 						++i; // Skip the value in next iteration
 					} else {
@@ -25,8 +30,8 @@ namespace media_proc {
 		void interpret(Context& ctx, const std::vector<std::string>& args) override {
 			for (size_t i = 0; i < args.size(); ++i) {
 				const std::string& arg = args[i];
-				if (arg.rfind("-", 0) == 0 && arg.rfind("--", 0) != 0) {
-					if (i + 1 < args.size() && args[i + 1].rfind("-", 0) != 0) {
+				if (isOptionName(arg) && arg.rfind("--", 0) != 0) {
+					if (i + 1 < args.size() && !isOptionName(args[i + 1])) {
 						ctx.set(arg, args[i + 1]);
 						++i; // skip value
 					} else {
@@ -0,0 +1,420 @@
+#include "BlurServer.h"
+
+#include "nodes/BlurModes.h"
+#include "nodes/FFmpegDecNode.h"
+#include "nodes/FFmpegEncNode.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef LINUX
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace media_proc {
+
+    // Chains of one lane, one per mode it has served, kept warm between jobs
+    class ServerLane {
+    public:
+        ServerLane(const ProcessorFactory &factory, const CodecOptions &codecs) : m_Factory(factory), m_Codecs(codecs) { }
+
+        // Runs the job on the chain of its mode; true when that chain was already set up
+        bool process(ServerJob &job, bool concurrent, int queueDepth) {
+            Chain &chain = m_Chains[job.mode];
+            bool warm = chain.root != nullptr;
+            if (!warm) {
+                std::unique_ptr<PipelineNode> processor = m_Factory(job.mode);
+                if (!processor) {
+                    m_Chains.erase(job.mode);
+                    throw std::runtime_error("Unsupported mode: " + job.mode);
+                }
+                auto decoder = std::make_unique<FFmpegDecNode>("", m_Codecs.decoder);
+                auto encoder = std::make_unique<FFmpegEncNode>("", m_Codecs.encoder);
+                chain.decoder = decoder.get();
+                chain.encoder = encoder.get();
+
+                processor->tail().setNext(std::move(encoder));
+                decoder->setNext(std::move(processor));
+                chain.root = std::move(decoder);
+            }
+
+            if (job.input.empty()) chain.decoder->setInputBuffer(job.inputData.data(), job.inputData.size());
+            else chain.decoder->setInput(job.input);
+            // Results sent back land in the lane's buffer, which outlives any job that fails halfway
+            if (job.output.empty()) chain.encoder->setOutputBuffer(&m_Output);
+            else chain.encoder->setOutput(job.output);
+            chain.encoder->setFormat(job.format);
+
+            if (concurrent) chain.root->executeConcurrent(queueDepth);
+            else chain.root->execute();
+
+            if (job.output.empty()) job.outputData.swap(m_Output);
+            return warm;
+        }
+
+    private:
+        struct Chain {
+            std::unique_ptr<PipelineNode> root;
+            FFmpegDecNode* decoder = nullptr;
+            FFmpegEncNode* encoder = nullptr;
+        };
+
+        const ProcessorFactory &m_Factory;
+        CodecOptions m_Codecs;
+        std::map<std::string, Chain> m_Chains;
+        std::vector<uint8_t> m_Output;
+    };
+
+    static double millisecondsBetween(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+        return std::chrono::duration<double, std::milli>(to - from).count();
+    }
+
+    static bool parsePriority(const std::string &value, int &priority) {
+        if (value == "high") priority = 10;
+        else if (value == "normal") priority = 0;
+        else if (value == "low") priority = -10;
+        else {
+            char* end = nullptr;
+            long number = std::strtol(value.c_str(), &end, 10);
+            if (value.empty() || *end != '\0') return false;
+            priority = (int)number;
+        }
+        return true;
+    }
+
+#ifdef LINUX
+    // Buffered reads of request lines and inline inputs from a client socket
+    class SocketReader {
+    public:
+        static constexpr size_t MaxLineLength = 4096;
+
+        explicit SocketReader(int socket) : m_Socket(socket) { }
+
+        // False on end of stream, a read error or an overlong line
+        bool readLine(std::string &line) {
+            line.clear();
+            while (true) {
+                if (m_Begin == m_End && !fill()) return false;
+                char* newline = static_cast<char*>(std::memchr(m_Buffer + m_Begin, '\n', m_End - m_Begin));
+                size_t count = newline ? (size_t)(newline - (m_Buffer + m_Begin)) : m_End - m_Begin;
+                line.append(m_Buffer + m_Begin, count);
+                m_Begin += count;
+                if (line.size() > MaxLineLength) return false;
+                if (newline) {
+                    ++m_Begin;
+                    if (!line.empty() && line.back() == '\r') line.pop_back();
+                    return true;
+                }
+            }
+        }
+
+        bool readBytes(uint8_t* data, size_t size) {
+            while (size > 0) {
+                if (m_Begin == m_End && !fill()) return false;
+                size_t count = std::min(size, m_End - m_Begin);
+                std::memcpy(data, m_Buffer + m_Begin, count);
+                m_Begin += count;
+                data += count;
+                size -= count;
+            }
+            return true;
+        }
+
+        // Reads past an inline input that is not going to be used, keeping the stream in step
+        bool skipBytes(size_t size) {
+            while (size > 0) {
+                if (m_Begin == m_End && !fill()) return false;
+                size_t count = std::min(size, m_End - m_Begin);
+                m_Begin += count;
+                size -= count;
+            }
+            return true;
+        }
+
+    private:
+        bool fill() {
+            while (true) {
+                ssize_t received = recv(m_Socket, m_Buffer, sizeof(m_Buffer), 0);
+                if (received < 0 && errno == EINTR) continue;
+                if (received <= 0) return false;
+                m_Begin = 0;
+                m_End = (size_t)received;
+                return true;
+            }
+        }
+
+    private:
+        int m_Socket;
+        char m_Buffer[64 << 10];
+        size_t m_Begin = 0, m_End = 0;
+    };
+
+    static bool sendAll(int socket, const void* data, size_t size) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        while (size > 0) {
+            ssize_t sent = send(socket, bytes, size, MSG_NOSIGNAL);
+            if (sent < 0 && errno == EINTR) continue;
+            if (sent <= 0) return false;
+            bytes += sent;
+            size -= (size_t)sent;
+        }
+        return true;
+    }
+
+    static bool sendReply(int socket, const std::string &status, const std::string &error, const ServerJob* job) {
+        std::ostringstream head;
+        head << std::fixed << std::setprecision(3) << "status=" << status << "\n";
+        if (!error.empty()) head << "error=" << error << "\n";
+        if (job) {
+            head << "lane=" << job->lane << "\nwarm=" << (job->warm ? 1 : 0) << "\n"
+                 << "queue-ms=" << millisecondsBetween(job->received, job->started) << "\n"
+                 << "run-ms=" << millisecondsBetween(job->started, job->finished) << "\n"
+                 << "total-ms=" << millisecondsBetween(job->received, std::chrono::steady_clock::now()) << "\n";
+            if (status == "ok" && job->output.empty()) head << "output-size=" << job->outputData.size() << "\n";
+        }
+        head << "\n";
+
+        std::string text = head.str();
+        if (!sendAll(socket, text.data(), text.size())) return false;
+        if (job && status == "ok" && job->output.empty()) return sendAll(socket, job->outputData.data(), job->outputData.size());
+        return true;
+    }
+#endif
+
+    BlurServer::BlurServer(const ServerOptions &options, ProcessorFactory factory) : m_Options(options), m_Factory(std::move(factory)) { }
+
+    BlurServer::~BlurServer() {
+        {
+            std::lock_guard<std::mutex> lock(m_QueueMutex);
+            m_Closed = true;
+        }
+        m_QueueReady.notify_all();
+        for (auto &lane : m_Lanes) if (lane.joinable()) lane.join();
+    }
+
+    bool BlurServer::reserve(std::string &error) {
+        std::lock_guard<std::mutex> lock(m_QueueMutex);
+        if (m_Closed) {
+            error = "server is stopping";
+            return false;
+        }
+        if (m_Queue.size() + m_Reserved >= m_Options.queueSize) {
+            error = "admission queue is full";
+            return false;
+        }
+        ++m_Reserved;
+        return true;
+    }
+
+    void BlurServer::release() {
+        std::lock_guard<std::mutex> lock(m_QueueMutex);
+        --m_Reserved;
+    }
+
+    bool BlurServer::admit(std::shared_ptr<ServerJob> job) {
+        {
+            std::lock_guard<std::mutex> lock(m_QueueMutex);
+            --m_Reserved;
+            if (m_Closed) {
+                job->error = "server is stopping";
+                return false;
+            }
+            job->sequence = m_NextSequence++;
+            m_Queue.push(std::move(job));
+        }
+        m_QueueReady.notify_one();
+        return true;
+    }
+
+    std::shared_ptr<ServerJob> BlurServer::nextJob() {
+        std::unique_lock<std::mutex> lock(m_QueueMutex);
+        m_QueueReady.wait(lock, [this]() { return m_Closed || !m_Queue.empty(); });
+        // Closing still drains what was admitted, every client gets its reply
+        if (m_Queue.empty()) return nullptr;
+        std::shared_ptr<ServerJob> job = m_Queue.top();
+        m_Queue.pop();
+        return job;
+    }
+
+    void BlurServer::runLane(unsigned int index) {
+        ServerLane lane(m_Factory, m_Options.codecs);
+        while (std::shared_ptr<ServerJob> job = nextJob()) {
+            job->lane = index;
+            job->started = std::chrono::steady_clock::now();
+            try {
+                job->warm = lane.process(*job, m_Options.concurrent, m_Options.queueDepth);
+            } catch (const std::exception &e) {
+                job->error = e.what();
+                // Messages end in a newline here and there, the reply is line based
+                job->error.erase(job->error.find_last_not_of("\r\n") + 1);
+                std::replace(job->error.begin(), job->error.end(), '\n', ' ');
+            }
+            job->finished = std::chrono::steady_clock::now();
+            job->done.set_value();
+        }
+    }
+
+    void BlurServer::serveConnection(int client) {
+    #ifdef LINUX
+        SocketReader reader(client);
+        while (true) {
+            auto job = std::make_shared<ServerJob>();
+            job->mode = m_Options.mode;
+            std::string error;
+            size_t inputSize = 0;
+            bool inlineInput = false;
+
+            // Header lines up to the empty line; empty lines before the first key are skipped
+            std::string line;
+            bool started = false;
+            while (true) {
+                if (!reader.readLine(line)) return;
+                if (line.empty()) {
+                    if (started) break;
+                    continue;
+                }
+                started = true;
+
+                size_t equals = line.find('=');
+                std::string key = line.substr(0, equals);
+                std::string value = equals == std::string::npos ? "" : line.substr(equals + 1);
+                if (key == "input") job->input = value;
+                else if (key == "output") job->output = value;
+                else if (key == "format") job->format = value;
+                else if (key == "mode") job->mode = value;
+                else if (key == "priority") {
+                    if (!parsePriority(value, job->priority) && error.empty()) error = "priority should be high, normal, low or a number";
+                }
+                else if (key == "input-size") {
+                    char* end = nullptr;
+                    inputSize = (size_t)std::strtoull(value.c_str(), &end, 10);
+                    inlineInput = true;
+                    if ((value.empty() || *end != '\0') && error.empty()) error = "input-size should be a number of bytes";
+                }
+                else if (error.empty()) error = "unknown key: " + key;
+            }
+            job->received = std::chrono::steady_clock::now();
+
+            // An inline input whose size can't be trusted leaves the stream out of step: answer, then hang up
+            if (inlineInput && (!error.empty() || inputSize > m_Options.maxInputBytes)) {
+                sendReply(client, "error", error.empty() ? "input-size is larger than " + std::to_string(m_Options.maxInputBytes) + " bytes" : error, nullptr);
+                return;
+            }
+
+            if (error.empty()) {
+                if (job->input.empty() == !inlineInput) error = "a request needs exactly one of input and input-size";
+                else if (job->output.empty() && job->format.empty()) error = "a result sent back needs a format";
+                else if (!isSupportedMode(job->mode)) error = "unsupported mode: " + job->mode;
+                else if (job->mode == "gpu" && m_Options.mode != "gpu") error = "gpu jobs need a server started with --mode gpu";
+            }
+
+            // The queue slot is taken before the inline input is buffered, so a full queue turns
+            // requests away without holding their bytes; a rejected input is read past, not kept
+            std::string status = error.empty() ? "ok" : "error";
+            if (error.empty() && !reserve(error)) status = "busy";
+            if (status != "ok") {
+                if (inlineInput && !reader.skipBytes(inputSize)) return;
+                if (!sendReply(client, status, error, nullptr)) return;
+                continue;
+            }
+            if (inlineInput) {
+                job->inputData.resize(inputSize);
+                if (!reader.readBytes(job->inputData.data(), inputSize)) {
+                    release();
+                    return;
+                }
+            }
+
+            std::future<void> done = job->done.get_future();
+            if (!admit(job)) {
+                if (!sendReply(client, "busy", job->error, nullptr)) return;
+                continue;
+            }
+            done.wait();
+            if (!sendReply(client, job->error.empty() ? "ok" : "error", job->error, job.get())) return;
+        }
+    #else
+        (void)client;
+    #endif
+    }
+
+    void BlurServer::run(const std::atomic<bool> &stop) {
+    #ifdef LINUX
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (m_Options.socketPath.empty() || m_Options.socketPath.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("Socket path should be 1 to " + std::to_string(sizeof(address.sun_path) - 1) + " characters: " + m_Options.socketPath);
+        }
+        std::strcpy(address.sun_path, m_Options.socketPath.c_str());
+
+        int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (listener < 0) throw std::runtime_error("Cannot create server socket");
+        // A socket file left behind by a previous run would fail the bind
+        unlink(m_Options.socketPath.c_str());
+        if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(listener, 64) < 0) {
+            close(listener);
+            throw std::runtime_error("Cannot listen on " + m_Options.socketPath + ": " + std::strerror(errno));
+        }
+
+        // One GL context serves every job in gpu mode
+        unsigned int lanes = m_Options.mode == "gpu" ? 1 : m_Options.lanes ? m_Options.lanes : std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned int i = 0; i < lanes; ++i) m_Lanes.emplace_back([this, i]() { runLane(i); });
+        std::cerr << "[Server] listening on " << m_Options.socketPath << " with " << lanes << " lanes\n";
+
+        while (!stop.load()) {
+            pollfd pending{ listener, POLLIN, 0 };
+            if (poll(&pending, 1, 200) <= 0) continue;
+
+            int client = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client < 0) continue;
+
+            for (auto it = m_Connections.begin(); it != m_Connections.end();) {
+                if (!it->finished.load()) { ++it; continue; }
+                it->thread.join();
+                close(it->socket);
+                it = m_Connections.erase(it);
+            }
+            if (m_Connections.size() >= m_Options.maxClients) {
+                sendReply(client, "busy", "too many connections", nullptr);
+                close(client);
+                continue;
+            }
+
+            Connection &connection = m_Connections.emplace_back();
+            connection.socket = client;
+            connection.thread = std::thread([this, &connection]() {
+                serveConnection(connection.socket);
+                connection.finished.store(true);
+            });
+        }
+
+        close(listener);
+        unlink(m_Options.socketPath.c_str());
+
+        // Idle clients stop being read; those waiting on a job still get their reply
+        for (auto &connection : m_Connections) shutdown(connection.socket, SHUT_RD);
+        {
+            std::lock_guard<std::mutex> lock(m_QueueMutex);
+            m_Closed = true;
+        }
+        m_QueueReady.notify_all();
+        for (auto &lane : m_Lanes) lane.join();
+        m_Lanes.clear();
+        for (auto &connection : m_Connections) {
+            connection.thread.join();
+            close(connection.socket);
+        }
+        m_Connections.clear();
+    #else
+        (void)stop;
+        throw std::runtime_error("Server mode needs Unix domain sockets and is only available on Linux");
+    #endif
+    }
+}
@@ -0,0 +1,124 @@
+/*
+ * Blur Server
+ * ===========
+ *
+ * Long-lived daemon serving blur jobs over a Unix domain socket. Lanes keep their
+ * decoder -> processor -> encoder chains, codec contexts, thread pools and GL context
+ * alive between jobs, so a request pays for the blur and not for process startup.
+ *
+ * Protocol, one request at a time per connection: `key=value` lines ended by an empty
+ * line, followed by `input-size` bytes when the input is sent inline.
+ *
+ *   input=<path> | input-size=<bytes>    Input file on the server, or inline bytes
+ *   output=<path>                        Output file; without it the result is sent back
+ *   format=<format>                      Output format (png, jpg, matroska, ...), required
+ *                                        for results sent back
+ *   mode=<mode>                          Processing mode (default: the server's --mode)
+ *   priority=high|normal|low|<number>    Higher runs first (default: normal)
+ *
+ * A full queue is checked before an inline input is read, and its bytes are skipped, not kept.
+ *
+ * The reply has the same shape: `status=ok|error|busy`, `error=<message>`, `lane`, `warm`
+ * (1 when the lane already had a chain for the mode), `queue-ms`, `run-ms`, `total-ms`,
+ * and `output-size=<bytes>` followed by the result when it is sent back.
+ *
+ * Author: Finoshkin Aleksei
+ * License: MIT
+ */
+
+#ifndef IMG_DEINT_BLUR_SERVER_H
+#define IMG_DEINT_BLUR_SERVER_H
+
+
+#include "batch/BatchRunner.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <future>
+#include <list>
+#include <mutex>
+#include <queue>
+#include <thread>
+
+namespace media_proc {
+
+    struct ServerOptions {
+        std::string socketPath;
+        std::string mode = "threads";        // mode of jobs that name none
+        unsigned int lanes = 0;              // 0 = std::thread::hardware_concurrency()
+        size_t queueSize = 64;               // jobs waiting for a lane; past that requests get status=busy
+        size_t maxClients = 128;             // connections past that get status=busy and are closed
+        size_t maxInputBytes = 256 << 20;    // largest inline input accepted
+        bool concurrent = false;
+        int queueDepth = 4;
+        CodecOptions codecs;
+    };
+
+    struct ServerJob {
+        std::string input, output, format, mode;
+        std::vector<uint8_t> inputData;      // inline input, when `input` is empty
+        std::vector<uint8_t> outputData;     // result sent back, when `output` is empty
+        int priority = 0;
+        uint64_t sequence = 0;
+
+        std::chrono::steady_clock::time_point received, started, finished;
+        unsigned int lane = 0;
+        bool warm = false;
+        std::string error;
+        std::promise<void> done;
+    };
+
+    class BlurServer {
+    public:
+        BlurServer(const ServerOptions &options, ProcessorFactory factory);
+        ~BlurServer();
+
+        BlurServer(const BlurServer&) = delete;
+        BlurServer& operator=(const BlurServer&) = delete;
+
+        // Serves until `stop` is set (e.g. from a SIGINT/SIGTERM handler). Jobs already admitted
+        // are finished and answered before it returns; the socket file is removed.
+        void run(const std::atomic<bool> &stop);
+
+    private:
+        // Takes a slot of the admission queue before a request's input is read; false with `error`
+        // set when the queue is full. Every slot is given back by admit() or release().
+        bool reserve(std::string &error);
+        void release();
+        // Queues a job in its reserved slot; false when the server is stopping
+        bool admit(std::shared_ptr<ServerJob> job);
+        std::shared_ptr<ServerJob> nextJob();
+        void runLane(unsigned int index);
+        void serveConnection(int client);
+
+    private:
+        struct JobOrder {
+            bool operator()(const std::shared_ptr<ServerJob> &a, const std::shared_ptr<ServerJob> &b) const {
+                return a->priority != b->priority ? a->priority < b->priority : a->sequence > b->sequence;
+            }
+        };
+
+        struct Connection {
+            int socket = -1;
+            std::thread thread;
+            std::atomic<bool> finished{false};
+        };
+
+        ServerOptions m_Options;
+        ProcessorFactory m_Factory;
+
+        std::mutex m_QueueMutex;
+        std::condition_variable m_QueueReady;
+        std::priority_queue<std::shared_ptr<ServerJob>, std::vector<std::shared_ptr<ServerJob>>, JobOrder> m_Queue;
+        uint64_t m_NextSequence = 0;
+        size_t m_Reserved = 0;
+        bool m_Closed = false;
+
+        std::vector<std::thread> m_Lanes;
+        std::list<Connection> m_Connections;
+    };
+}
+
+
+#endif //!IMG_DEINT_BLUR_SERVER_H
@@ -0,0 +1,240 @@
+#include "FrameRingServer.h"
+
+#include "nodes/BlurModes.h"
+
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef LINUX
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace media_proc {
+
+#ifdef LINUX
+    static bool sendReply(int socket, int status, const std::string &error) {
+        FrameRingReply reply{};
+        reply.status = status;
+        std::strncpy(reply.error, error.c_str(), sizeof(reply.error) - 1);
+        return send(socket, &reply, sizeof(reply), MSG_NOSIGNAL) == (ssize_t)sizeof(reply);
+    }
+
+    // Receives the hello and the descriptor that comes with it; -1 when there is none
+    static int receiveHello(int socket, FrameRingHello &hello, ssize_t &received) {
+        iovec part{ &hello, sizeof(hello) };
+        alignas(cmsghdr) char control[CMSG_SPACE(4 * sizeof(int))] = {};
+        msghdr message{};
+        message.msg_iov = &part;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+
+        do received = recvmsg(socket, &message, MSG_CMSG_CLOEXEC);
+        while (received < 0 && errno == EINTR);
+        if (received < 0) return -1;
+
+        // Keeps the first descriptor, a client sending more only gets them closed
+        int fd = -1;
+        for (cmsghdr* header = CMSG_FIRSTHDR(&message); header; header = CMSG_NXTHDR(&message, header)) {
+            if (header->cmsg_level != SOL_SOCKET || header->cmsg_type != SCM_RIGHTS) continue;
+            size_t count = (header->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            for (size_t i = 0; i < count; ++i) {
+                int extra;
+                std::memcpy(&extra, CMSG_DATA(header) + i * sizeof(int), sizeof(int));
+                if (fd < 0) fd = extra;
+                else close(extra);
+            }
+        }
+        return fd;
+    }
+#endif
+
+    FrameRingServer::FrameRingServer(const FrameRingServerOptions &options, ProcessorFactory factory) : m_Options(options), m_Factory(std::move(factory)) { }
+
+    FrameRingServer::~FrameRingServer() {
+    #ifdef LINUX
+        if (m_Listener >= 0) {
+            close(m_Listener);
+            unlink(m_Options.socketPath.c_str());
+        }
+    #endif
+    }
+
+    bool FrameRingServer::processSlot(FrameRing &ring, uint32_t index, PipelineNode &processor, std::shared_ptr<const PipelineContext> &context) {
+        FrameSlot &slot = ring.slot(index);
+        if (slot.state.load(std::memory_order_acquire) != (uint32_t)SlotState::Submitted) return false;
+
+        // Checked and used as copied here; the client rewriting the header meanwhile only hurts its own frame
+        FrameLayout layout = slot.layout;
+        std::string error;
+        auto start = std::chrono::steady_clock::now();
+        if (ring.validate(layout, error)) {
+            try {
+                auto packet = std::make_unique<PipelinePacket>(FramePool::global().acquireFrame(), context);
+                ring.wrap(index, layout, packet->frame);
+
+                std::vector<int> linesizes(packet->frame->linesize, packet->frame->linesize + av_pix_fmt_count_planes(static_cast<AVPixelFormat>(layout.format)));
+                auto current = std::make_shared<const PipelineContext>(linesizes, layout.width, layout.height, static_cast<AVPixelFormat>(layout.format),
+                                                                       AVRational{ 1, 25 }, AVRational{ 25, 1 });
+                // The processor only re-inits for another geometry
+                if (!context || !context->isCompatible(*current)) context = current;
+                packet->context = context;
+
+                // Every mode and filter blurs the packet's planes in place, so the result is already in the slot
+                packet = processor.processChain(std::move(packet));
+            } catch (const std::exception &e) {
+                error = e.what();
+            }
+        }
+
+        slot.processMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::memset(slot.error, 0, sizeof(slot.error));
+        std::strncpy(slot.error, error.c_str(), sizeof(slot.error) - 1);
+        slot.state.store((uint32_t)(error.empty() ? SlotState::Done : SlotState::Failed), std::memory_order_release);
+        return true;
+    }
+
+    void FrameRingServer::serveClient(int client) {
+    #ifdef LINUX
+        FrameRingHello hello{};
+        ssize_t received = 0;
+        int fd = receiveHello(client, hello, received);
+        if (received != (ssize_t)sizeof(hello) || hello.magic != FrameRing::Magic || hello.version != FrameRing::Version || fd < 0) {
+            if (fd >= 0) close(fd);
+            sendReply(client, EPROTO, "expected a version " + std::to_string(FrameRing::Version) + " hello with the ring's memfd");
+            return;
+        }
+
+        hello.mode[sizeof(hello.mode) - 1] = '\0';
+        std::string mode = hello.mode[0] ? hello.mode : m_Options.mode;
+        std::string error;
+        if (!isSupportedMode(mode)) error = "unsupported mode: " + mode;
+        else if (mode == "gpu" && m_Options.mode != "gpu") error = "gpu clients need a server started with --mode gpu";
+        if (!error.empty()) {
+            close(fd);
+            sendReply(client, EINVAL, error);
+            return;
+        }
+
+        // Released after the processor and its GL context are gone
+        struct GpuClaim {
+            std::atomic<bool>* busy = nullptr;
+            ~GpuClaim() { if (busy) busy->store(false); }
+        } gpu;
+        if (mode == "gpu") {
+            if (m_GpuBusy.exchange(true)) {
+                close(fd);
+                sendReply(client, EBUSY, "the GPU is serving another client");
+                return;
+            }
+            gpu.busy = &m_GpuBusy;
+        }
+
+        FrameRing ring;
+        std::unique_ptr<PipelineNode> processor;
+        try {
+            ring.attach(fd);
+            processor = m_Factory(mode);
+            if (!processor) throw std::runtime_error("unsupported mode: " + mode);
+        } catch (const std::exception &e) {
+            sendReply(client, EINVAL, e.what());
+            return;
+        }
+        if (!sendReply(client, 0, "")) return;
+
+        std::shared_ptr<const PipelineContext> context;
+        while (true) {
+            uint32_t indices[64];
+            received = recv(client, indices, sizeof(indices), 0);
+            if (received < 0 && errno == EINTR) continue;
+            if (received <= 0 || received % sizeof(uint32_t) != 0) return;
+
+            for (ssize_t i = 0; i < received / (ssize_t)sizeof(uint32_t); ++i) {
+                // A slot that was not submitted means the client and the server disagree on who owns what
+                if (indices[i] >= ring.slotCount() || !processSlot(ring, indices[i], *processor, context)) return;
+                if (send(client, &indices[i], sizeof(uint32_t), MSG_NOSIGNAL) != (ssize_t)sizeof(uint32_t)) return;
+            }
+        }
+    #else
+        (void)client;
+    #endif
+    }
+
+    void FrameRingServer::listen() {
+    #ifdef LINUX
+        if (m_Listener >= 0) return;
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (m_Options.socketPath.empty() || m_Options.socketPath.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("Socket path should be 1 to " + std::to_string(sizeof(address.sun_path) - 1) + " characters: " + m_Options.socketPath);
+        }
+        std::strcpy(address.sun_path, m_Options.socketPath.c_str());
+
+        int listener = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        if (listener < 0) throw std::runtime_error("Cannot create server socket");
+        // A socket file left behind by a previous run would fail the bind
+        unlink(m_Options.socketPath.c_str());
+        if (bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || ::listen(listener, 64) < 0) {
+            close(listener);
+            throw std::runtime_error("Cannot listen on " + m_Options.socketPath + ": " + std::strerror(errno));
+        }
+        m_Listener = listener;
+    #else
+        throw std::runtime_error("Shared-memory frames need memfd and Unix domain sockets and are only available on Linux");
+    #endif
+    }
+
+    void FrameRingServer::run(const std::atomic<bool> &stop) {
+    #ifdef LINUX
+        listen();
+        std::cerr << "[Server] shared-memory frames on " << m_Options.socketPath << ", mode " << m_Options.mode << "\n";
+
+        while (!stop.load()) {
+            pollfd pending{ m_Listener, POLLIN, 0 };
+            if (poll(&pending, 1, 200) <= 0) continue;
+
+            int client = accept4(m_Listener, nullptr, nullptr, SOCK_CLOEXEC);
+            if (client < 0) continue;
+
+            for (auto it = m_Connections.begin(); it != m_Connections.end();) {
+                if (!it->finished.load()) { ++it; continue; }
+                it->thread.join();
+                close(it->socket);
+                it = m_Connections.erase(it);
+            }
+            if (m_Connections.size() >= m_Options.maxClients) {
+                sendReply(client, EBUSY, "too many clients");
+                close(client);
+                continue;
+            }
+
+            Connection &connection = m_Connections.emplace_back();
+            connection.socket = client;
+            connection.thread = std::thread([this, &connection]() {
+                TRACE_THREAD_NAME("shm client");
+                serveClient(connection.socket);
+                connection.finished.store(true);
+            });
+        }
+
+        close(m_Listener);
+        m_Listener = -1;
+        unlink(m_Options.socketPath.c_str());
+
+        // Clients stop being read, the frame each one is blurring is still given back
+        for (auto &connection : m_Connections) shutdown(connection.socket, SHUT_RD);
+        for (auto &connection : m_Connections) {
+            connection.thread.join();
+            close(connection.socket);
+        }
+        m_Connections.clear();
+    #else
+        (void)stop;
+        throw std::runtime_error("Shared-memory frames need memfd and Unix domain sockets and are only available on Linux");
+    #endif
+    }
+}
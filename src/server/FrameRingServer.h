@@ -0,0 +1,70 @@
+/*
+ * Frame Ring Server
+ * =================
+ *
+ * Serves the shared-memory transport of shm/FrameRing.h on a Unix socket: every client
+ * connection brings its own ring of frame slots and gets a processor of its mode, kept for
+ * the whole connection. Submitted slots are blurred in place in submission order and given
+ * back one by one; there is no decoder, encoder or copy of the planes on the way.
+ *
+ * Author: Finoshkin Aleksei
+ * License: MIT
+ */
+
+#ifndef IMG_DEINT_FRAME_RING_SERVER_H
+#define IMG_DEINT_FRAME_RING_SERVER_H
+
+
+#include "batch/BatchRunner.h"
+#include "shm/FrameRing.h"
+
+#include <atomic>
+#include <list>
+#include <thread>
+
+namespace media_proc {
+
+    struct FrameRingServerOptions {
+        std::string socketPath;
+        std::string mode = "threads";        // mode of clients that name none
+        size_t maxClients = 64;              // connections past that are turned down
+    };
+
+    class FrameRingServer {
+    public:
+        FrameRingServer(const FrameRingServerOptions &options, ProcessorFactory factory);
+        ~FrameRingServer();
+
+        FrameRingServer(const FrameRingServer&) = delete;
+        FrameRingServer& operator=(const FrameRingServer&) = delete;
+
+        // Binds the socket; run() does it when it was not called before. Lets a client in the
+        // same process connect as soon as it returns. Throws std::runtime_error.
+        void listen();
+        // Serves until `stop` is set. Frames being blurred are finished and given back before it
+        // returns; the socket file is removed.
+        void run(const std::atomic<bool> &stop);
+
+    private:
+        void serveClient(int client);
+        // Blurs one submitted slot; false when the client broke the protocol
+        bool processSlot(FrameRing &ring, uint32_t index, PipelineNode &processor, std::shared_ptr<const PipelineContext> &context);
+
+    private:
+        struct Connection {
+            int socket = -1;
+            std::thread thread;
+            std::atomic<bool> finished{false};
+        };
+
+        FrameRingServerOptions m_Options;
+        ProcessorFactory m_Factory;
+        int m_Listener = -1;
+        // One GL context at a time in gpu mode
+        std::atomic<bool> m_GpuBusy{false};
+        std::list<Connection> m_Connections;
+    };
+}
+
+
+#endif //!IMG_DEINT_FRAME_RING_SERVER_H
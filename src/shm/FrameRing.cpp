@@ -0,0 +1,214 @@
+#include "FrameRing.h"
+
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#ifdef LINUX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace media_proc {
+
+    static size_t alignUp(size_t value, size_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    size_t FrameRing::mappingSize(uint32_t slotCount, size_t slotBytes, size_t &dataOffset, size_t &slotStride) {
+        const size_t page = 4096;
+        dataOffset = alignUp(sizeof(FrameRingHeader), alignof(FrameSlot)) + (size_t)slotCount * sizeof(FrameSlot);
+        dataOffset = alignUp(dataOffset, page);
+        slotStride = alignUp(slotBytes, page);
+        return dataOffset + (size_t)slotCount * slotStride;
+    }
+
+    void FrameRing::create(uint32_t slotCount, size_t slotBytes) {
+        close();
+        if (slotCount == 0 || slotCount > MaxSlots || slotBytes == 0 || slotBytes > MaxSlotBytes) {
+            throw std::runtime_error("A frame ring has 1 to " + std::to_string(MaxSlots) + " slots of at most " + std::to_string(MaxSlotBytes >> 20) + " MiB");
+        }
+    #ifdef LINUX
+        size_t dataOffset = 0, slotStride = 0;
+        size_t size = mappingSize(slotCount, slotBytes, dataOffset, slotStride);
+
+        int fd = memfd_create("img_blur-frames", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+        if (fd < 0) throw std::runtime_error(std::string("Cannot create the frame ring: ") + std::strerror(errno));
+        if (ftruncate(fd, (off_t)size) != 0 || fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0) {
+            int error = errno;
+            ::close(fd);
+            throw std::runtime_error(std::string("Cannot size the frame ring: ") + std::strerror(error));
+        }
+        map(fd, size);
+
+        FrameRingHeader* header = reinterpret_cast<FrameRingHeader*>(m_Base);
+        header->magic = Magic;
+        header->version = Version;
+        header->slotCount = slotCount;
+        header->reserved = 0;
+        header->slotBytes = slotBytes;
+        header->dataOffset = dataOffset;
+
+        m_SlotCount = slotCount;
+        m_SlotBytes = slotBytes;
+        m_SlotStride = slotStride;
+        m_Slots = reinterpret_cast<FrameSlot*>(m_Base + alignUp(sizeof(FrameRingHeader), alignof(FrameSlot)));
+        m_Data = m_Base + dataOffset;
+        for (uint32_t i = 0; i < slotCount; ++i) new (&m_Slots[i]) FrameSlot();
+    #else
+        throw std::runtime_error("Frame rings need memfd and are only available on Linux");
+    #endif
+    }
+
+    void FrameRing::attach(int fd) {
+        close();
+    #ifdef LINUX
+        struct stat info;
+        int seals = fcntl(fd, F_GET_SEALS);
+        if (fstat(fd, &info) != 0 || seals < 0 || !(seals & F_SEAL_SHRINK) || (size_t)info.st_size < sizeof(FrameRingHeader)) {
+            ::close(fd);
+            throw std::runtime_error("The frame ring should be a memfd sealed against shrinking");
+        }
+        map(fd, (size_t)info.st_size);
+
+        FrameRingHeader header;
+        std::memcpy(&header, m_Base, sizeof(header));
+        size_t dataOffset = 0, slotStride = 0;
+        bool valid = header.magic == Magic && header.version == Version && header.slotCount > 0 && header.slotCount <= MaxSlots
+                     && header.slotBytes > 0 && header.slotBytes <= MaxSlotBytes
+                     && mappingSize(header.slotCount, header.slotBytes, dataOffset, slotStride) == m_Size && header.dataOffset == dataOffset;
+        if (!valid) {
+            close();
+            throw std::runtime_error("Not a frame ring of version " + std::to_string(Version) + ", or its size does not match its header");
+        }
+
+        m_SlotCount = header.slotCount;
+        m_SlotBytes = header.slotBytes;
+        m_SlotStride = slotStride;
+        m_Slots = reinterpret_cast<FrameSlot*>(m_Base + alignUp(sizeof(FrameRingHeader), alignof(FrameSlot)));
+        m_Data = m_Base + dataOffset;
+    #else
+        (void)fd;
+        throw std::runtime_error("Frame rings need memfd and are only available on Linux");
+    #endif
+    }
+
+    void FrameRing::map(int fd, size_t size) {
+    #ifdef LINUX
+        void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (base == MAP_FAILED) {
+            int error = errno;
+            ::close(fd);
+            throw std::runtime_error(std::string("Cannot map the frame ring: ") + std::strerror(error));
+        }
+        m_File = fd;
+        m_Base = static_cast<uint8_t*>(base);
+        m_Size = size;
+    #endif
+    }
+
+    void FrameRing::close() {
+    #ifdef LINUX
+        if (m_Base) munmap(m_Base, m_Size);
+        if (m_File >= 0) ::close(m_File);
+    #endif
+        m_File = -1;
+        m_Base = nullptr;
+        m_Size = 0;
+        m_SlotCount = 0;
+        m_SlotBytes = m_SlotStride = 0;
+        m_Slots = nullptr;
+        m_Data = nullptr;
+    }
+
+    bool FrameRing::computeLayout(int width, int height, AVPixelFormat format, FrameLayout &layout, size_t &bytes) {
+        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format);
+        // Palettes would need a second buffer, hardware and bitstream formats have no planes to blur
+        if (width <= 0 || height <= 0 || !desc || (desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM))) return false;
+
+        layout = FrameLayout{};
+        layout.width = width;
+        layout.height = height;
+        layout.format = format;
+
+        int linesizes[4] = {};
+        if (av_image_fill_linesizes(linesizes, format, width) < 0) return false;
+        ptrdiff_t strides[4] = {};
+        for (int i = 0; i < 4; ++i) strides[i] = (ptrdiff_t)alignUp((size_t)linesizes[i], PlaneAlignment);
+
+        size_t sizes[4] = {};
+        if (av_image_fill_plane_sizes(sizes, format, height, strides) < 0) return false;
+
+        bytes = 0;
+        for (int i = 0; i < 4 && sizes[i] > 0; ++i) {
+            layout.linesize[i] = (int32_t)strides[i];
+            layout.offset[i] = bytes;
+            bytes = alignUp(bytes + sizes[i], PlaneAlignment);
+        }
+        return bytes > 0;
+    }
+
+    size_t FrameRing::frameBytes(int width, int height, AVPixelFormat format) {
+        FrameLayout layout;
+        size_t bytes = 0;
+        return computeLayout(width, height, format, layout, bytes) ? bytes : 0;
+    }
+
+    bool FrameRing::prepare(uint32_t index, int width, int height, AVPixelFormat format) {
+        FrameLayout layout;
+        size_t bytes = 0;
+        if (index >= m_SlotCount || !computeLayout(width, height, format, layout, bytes) || bytes > m_SlotBytes) return false;
+        m_Slots[index].layout = layout;
+        return true;
+    }
+
+    bool FrameRing::validate(const FrameLayout &layout, std::string &error) const {
+        AVPixelFormat format = static_cast<AVPixelFormat>(layout.format);
+        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(format);
+        if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM))) {
+            error = "unsupported pixel format " + std::to_string(layout.format);
+            return false;
+        }
+        if (layout.width <= 0 || layout.height <= 0 || av_image_check_size((unsigned)layout.width, (unsigned)layout.height, 0, nullptr) < 0) {
+            error = "invalid frame size " + std::to_string(layout.width) + "x" + std::to_string(layout.height);
+            return false;
+        }
+
+        int planes = av_pix_fmt_count_planes(format);
+        ptrdiff_t strides[4] = {};
+        for (int i = 0; i < planes; ++i) {
+            if (layout.linesize[i] < av_image_get_linesize(format, layout.width, i)) {
+                error = "linesize of plane " + std::to_string(i) + " is narrower than a row";
+                return false;
+            }
+            strides[i] = layout.linesize[i];
+        }
+
+        size_t sizes[4] = {};
+        if (av_image_fill_plane_sizes(sizes, format, layout.height, strides) < 0) {
+            error = "cannot size the planes";
+            return false;
+        }
+        for (int i = 0; i < planes; ++i) {
+            if (layout.offset[i] > m_SlotBytes || sizes[i] > m_SlotBytes - layout.offset[i]) {
+                error = "plane " + std::to_string(i) + " ends past the slot's " + std::to_string(m_SlotBytes) + " bytes";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void FrameRing::wrap(uint32_t index, const FrameLayout &layout, AVFrame* frame) const {
+        AVPixelFormat format = static_cast<AVPixelFormat>(layout.format);
+        int planes = av_pix_fmt_count_planes(format);
+        frame->format = format;
+        frame->width = layout.width;
+        frame->height = layout.height;
+        for (int i = 0; i < 4; ++i) {
+            frame->data[i] = i < planes ? slotData(index) + layout.offset[i] : nullptr;
+            frame->linesize[i] = i < planes ? layout.linesize[i] : 0;
+        }
+    }
+}
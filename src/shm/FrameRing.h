@@ -0,0 +1,149 @@
+/*
+ * Frame Ring
+ * ==========
+ *
+ * Ring of raw frame slots in shared memory, exchanged between img_blur and a client process.
+ * The client creates the ring in a sealed memfd and hands the descriptor over a Unix socket;
+ * from then on a frame is a slot index. The client describes the frame in the slot's header
+ * (width, height, AVPixelFormat, linesizes, plane offsets), writes the planes into the slot
+ * and sends the index. The server blurs the planes where they lie, marks the slot done and
+ * sends the index back. Pixels never cross the socket and no codec touches them.
+ *
+ * Memory layout: FrameRingHeader, `slotCount` FrameSlot headers, then the plane memory of
+ * every slot, `slotBytes` each and page aligned.
+ *
+ * Control socket (SOCK_SEQPACKET), one message each:
+ *   client -> server   FrameRingHello with the memfd attached (SCM_RIGHTS)
+ *   server -> client   FrameRingReply, status 0 when the ring was accepted
+ *   client -> server   one or more uint32_t slot indices, slots set to Submitted
+ *   server -> client   one uint32_t slot index per finished frame, in submission order,
+ *                      slot set to Done or Failed
+ *
+ * Author: Finoshkin Aleksei
+ * License: MIT
+ */
+
+#ifndef IMG_DEINT_FRAME_RING_H
+#define IMG_DEINT_FRAME_RING_H
+
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+namespace media_proc {
+
+    // Who owns a slot: the client while Free, Done or Failed, the server while Submitted
+    enum class SlotState : uint32_t { Free = 0, Submitted, Done, Failed };
+
+    // Geometry of the frame in a slot; offsets are from the start of the slot's plane memory
+    struct FrameLayout {
+        int32_t width = 0, height = 0;
+        int32_t format = AV_PIX_FMT_NONE;
+        int32_t linesize[4] = {};
+        uint64_t offset[4] = {};
+    };
+
+    struct FrameRingHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t slotCount;
+        uint32_t reserved;
+        uint64_t slotBytes;
+        uint64_t dataOffset;        // Start of the first slot's plane memory
+    };
+
+    struct alignas(64) FrameSlot {
+        std::atomic<uint32_t> state{ (uint32_t)SlotState::Free };
+        FrameLayout layout;         // Written by the client before submitting
+        uint64_t sequence = 0;      // Client's tag, left as it is
+        double processMs = 0.0;     // Blur time of the last frame, set by the server
+        char error[128] = {};       // Reason of a Failed slot
+    };
+
+    struct FrameRingHello {
+        uint32_t magic;
+        uint32_t version;
+        char mode[32];              // Processing mode, empty for the server's --mode
+    };
+
+    struct FrameRingReply {
+        int32_t status;             // 0 or an errno value
+        char error[124];
+    };
+
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "slot states are shared between processes");
+
+    class FrameRing {
+    public:
+        static constexpr uint32_t Magic = 0x52464249;  // "IBFR"
+        static constexpr uint32_t Version = 1;
+        static constexpr uint32_t MaxSlots = 256;
+        static constexpr uint64_t MaxSlotBytes = 1ull << 30;
+        // Linesizes and plane offsets of layouts made by prepare()
+        static constexpr size_t PlaneAlignment = 64;
+
+        FrameRing() = default;
+        FrameRing(const FrameRing&) = delete;
+        FrameRing& operator=(const FrameRing&) = delete;
+
+        ~FrameRing() { close(); }
+
+        // Client side: a new ring in a memfd sealed against shrinking, so the server can map it
+        // without risking SIGBUS. Throws std::runtime_error.
+        void create(uint32_t slotCount, size_t slotBytes);
+        // Server side: maps a ring received from a client and takes ownership of `fd`. Throws
+        // std::runtime_error when it is not a sealed ring of this version.
+        void attach(int fd);
+        void close();
+
+        int fd() const { return m_File; }
+        uint32_t slotCount() const { return m_SlotCount; }
+        size_t slotBytes() const { return m_SlotBytes; }
+
+        FrameSlot& slot(uint32_t index) const { return m_Slots[index]; }
+        uint8_t* slotData(uint32_t index) const { return m_Data + (size_t)index * m_SlotStride; }
+
+        // Client side: lays out a frame in the slot with aligned linesizes and planes; false when
+        // the format is not supported or the frame does not fit
+        bool prepare(uint32_t index, int width, int height, AVPixelFormat format);
+        uint8_t* plane(uint32_t index, int plane) const { return slotData(index) + m_Slots[index].layout.offset[plane]; }
+        int linesize(uint32_t index, int plane) const { return m_Slots[index].layout.linesize[plane]; }
+
+        // Server side: checks a layout copied out of a slot, the client may still change the slot's own
+        bool validate(const FrameLayout &layout, std::string &error) const;
+        // Points the frame at the slot's planes without a copy or a buffer reference
+        void wrap(uint32_t index, const FrameLayout &layout, AVFrame* frame) const;
+
+        // Bytes a slot needs for a frame laid out by prepare(); 0 when the format is not supported
+        static size_t frameBytes(int width, int height, AVPixelFormat format);
+
+    private:
+        static bool computeLayout(int width, int height, AVPixelFormat format, FrameLayout &layout, size_t &bytes);
+        static size_t mappingSize(uint32_t slotCount, size_t slotBytes, size_t &dataOffset, size_t &slotStride);
+
+        void map(int fd, size_t size);
+
+    private:
+        int m_File = -1;
+        uint8_t* m_Base = nullptr;
+        size_t m_Size = 0;
+
+        // Copied out of the header once, the other side can't move them afterwards
+        uint32_t m_SlotCount = 0;
+        size_t m_SlotBytes = 0;
+        size_t m_SlotStride = 0;
+        FrameSlot* m_Slots = nullptr;
+        uint8_t* m_Data = nullptr;
+    };
+}
+
+
+#endif //!IMG_DEINT_FRAME_RING_H
@@ -0,0 +1,133 @@
+#include "FrameRingClient.h"
+
+#include <cstring>
+#include <stdexcept>
+
+#ifdef LINUX
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace media_proc {
+
+    void FrameRingClient::connect(const std::string &socketPath, uint32_t slotCount, size_t slotBytes, const std::string &mode) {
+        close();
+    #ifdef LINUX
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (socketPath.empty() || socketPath.size() >= sizeof(address.sun_path)) throw std::runtime_error("Invalid socket path: " + socketPath);
+        std::strcpy(address.sun_path, socketPath.c_str());
+
+        FrameRingHello hello{};
+        hello.magic = FrameRing::Magic;
+        hello.version = FrameRing::Version;
+        if (mode.size() >= sizeof(hello.mode)) throw std::runtime_error("Unknown mode: " + mode);
+        std::strcpy(hello.mode, mode.c_str());
+
+        m_Ring.create(slotCount, slotBytes);
+
+        m_Socket = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+        if (m_Socket < 0 || ::connect(m_Socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+            std::string error = std::strerror(errno);
+            close();
+            throw std::runtime_error("Cannot connect to " + socketPath + ": " + error);
+        }
+
+        // The hello carries the ring's descriptor
+        iovec part{ &hello, sizeof(hello) };
+        alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))] = {};
+        msghdr message{};
+        message.msg_iov = &part;
+        message.msg_iovlen = 1;
+        message.msg_control = control;
+        message.msg_controllen = sizeof(control);
+        cmsghdr* rights = CMSG_FIRSTHDR(&message);
+        rights->cmsg_level = SOL_SOCKET;
+        rights->cmsg_type = SCM_RIGHTS;
+        rights->cmsg_len = CMSG_LEN(sizeof(int));
+        int fd = m_Ring.fd();
+        std::memcpy(CMSG_DATA(rights), &fd, sizeof(fd));
+
+        FrameRingReply reply{};
+        if (sendmsg(m_Socket, &message, MSG_NOSIGNAL) != (ssize_t)sizeof(hello) || recv(m_Socket, &reply, sizeof(reply), 0) != (ssize_t)sizeof(reply)) {
+            close();
+            throw std::runtime_error("The server at " + socketPath + " did not answer the ring handshake");
+        }
+        if (reply.status != 0) {
+            reply.error[sizeof(reply.error) - 1] = '\0';
+            close();
+            throw std::runtime_error(std::string("The server turned the frame ring down: ") + reply.error);
+        }
+
+        for (uint32_t i = slotCount; i > 0; --i) m_Free.push_back(i - 1);
+    #else
+        (void)socketPath; (void)slotCount; (void)slotBytes; (void)mode;
+        throw std::runtime_error("Frame rings need memfd and are only available on Linux");
+    #endif
+    }
+
+    void FrameRingClient::close() {
+    #ifdef LINUX
+        if (m_Socket >= 0) ::close(m_Socket);
+    #endif
+        m_Socket = -1;
+        m_Ring.close();
+        m_Free.clear();
+        m_Finished.clear();
+        m_Submitted = 0;
+    }
+
+    bool FrameRingClient::acquire(uint32_t &index) {
+        if (m_Free.empty()) return false;
+        index = m_Free.back();
+        m_Free.pop_back();
+        return true;
+    }
+
+    void FrameRingClient::release(uint32_t index) {
+        m_Free.push_back(index);
+    }
+
+    void FrameRingClient::submit(uint32_t index) {
+    #ifdef LINUX
+        FrameSlot &slot = m_Ring.slot(index);
+        slot.error[0] = '\0';
+        // Publishes the layout and the planes to the server
+        slot.state.store((uint32_t)SlotState::Submitted, std::memory_order_release);
+        while (true) {
+            ssize_t sent = send(m_Socket, &index, sizeof(index), MSG_NOSIGNAL);
+            if (sent < 0 && errno == EINTR) continue;
+            if (sent != (ssize_t)sizeof(index)) throw std::runtime_error("The frame ring server closed the connection");
+            break;
+        }
+        ++m_Submitted;
+    #else
+        (void)index;
+    #endif
+    }
+
+    uint32_t FrameRingClient::wait() {
+    #ifdef LINUX
+        if (m_Submitted == 0) throw std::runtime_error("No frame is submitted");
+        while (m_Finished.empty()) {
+            uint32_t indices[64];
+            ssize_t received = recv(m_Socket, indices, sizeof(indices), 0);
+            if (received < 0 && errno == EINTR) continue;
+            if (received <= 0 || received % sizeof(uint32_t) != 0) throw std::runtime_error("The frame ring server closed the connection");
+            for (ssize_t i = 0; i < received / (ssize_t)sizeof(uint32_t); ++i) {
+                if (indices[i] >= m_Ring.slotCount()) throw std::runtime_error("The frame ring server sent an invalid slot");
+                m_Finished.push_back(indices[i]);
+            }
+        }
+        uint32_t index = m_Finished.front();
+        m_Finished.pop_front();
+        --m_Submitted;
+        // Makes the server's writes to the planes visible here
+        m_Ring.slot(index).state.load(std::memory_order_acquire);
+        return index;
+    #else
+        throw std::runtime_error("Frame rings need memfd and are only available on Linux");
+    #endif
+    }
+}
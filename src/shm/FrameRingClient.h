@@ -0,0 +1,73 @@
+/*
+ * Frame Ring Client
+ * =================
+ *
+ * Reference client of the shared-memory transport (see FrameRing.h): creates a ring,
+ * hands it to an img_blur --serve-shm server and keeps track of which slots it owns.
+ * Frames are pipelined: while the server blurs one slot the client fills the next.
+ *
+ *   FrameRingClient client;
+ *   client.connect("/run/img_blur-shm.sock", 4, FrameRing::frameBytes(1920, 1080, AV_PIX_FMT_YUV420P));
+ *   uint32_t slot;
+ *   if (!client.acquire(slot)) slot = client.wait();   // read the blurred frame out first
+ *   client.ring().prepare(slot, 1920, 1080, AV_PIX_FMT_YUV420P);
+ *   // write rows to client.ring().plane(slot, i), client.ring().linesize(slot, i) apart
+ *   client.submit(slot);
+ *
+ * Only depends on libavutil, so it links into client processes on its own.
+ *
+ * Author: Finoshkin Aleksei
+ * License: MIT
+ */
+
+#ifndef IMG_DEINT_FRAME_RING_CLIENT_H
+#define IMG_DEINT_FRAME_RING_CLIENT_H
+
+
+#include "FrameRing.h"
+
+#include <deque>
+#include <vector>
+
+namespace media_proc {
+
+    class FrameRingClient {
+    public:
+        FrameRingClient() = default;
+        FrameRingClient(const FrameRingClient&) = delete;
+        FrameRingClient& operator=(const FrameRingClient&) = delete;
+
+        ~FrameRingClient() { close(); }
+
+        // Creates a ring of `slotCount` slots and hands it to the server on `socketPath`, which
+        // blurs its frames in `mode` (empty: the server's). Throws std::runtime_error when the
+        // server can't be reached or turns the ring down.
+        void connect(const std::string &socketPath, uint32_t slotCount, size_t slotBytes, const std::string &mode = "");
+        void close();
+
+        FrameRing& ring() { return m_Ring; }
+
+        // A slot the client owns and may fill; false when every slot is submitted
+        bool acquire(uint32_t &index);
+        // Gives a slot the client is done with back to acquire()
+        void release(uint32_t index);
+
+        // Hands a prepared and filled slot to the server. Throws when the server is gone.
+        void submit(uint32_t index);
+        // Waits for the oldest submitted slot to come back and returns it; the slot's state is
+        // Done or Failed, with the reason in its error. Throws when the server is gone.
+        uint32_t wait();
+
+        size_t inFlight() const { return m_Submitted; }
+
+    private:
+        int m_Socket = -1;
+        FrameRing m_Ring;
+        std::vector<uint32_t> m_Free;
+        std::deque<uint32_t> m_Finished;    // Indices received and not yet returned by wait()
+        size_t m_Submitted = 0;
+    };
+}
+
+
+#endif //!IMG_DEINT_FRAME_RING_CLIENT_H
@@ -0,0 +1,177 @@
+#ifndef BUFFER_POOL_H
+#define BUFFER_POOL_H
+
+#include <atomic>
+#include <mutex>
+#include <new>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <unordered_map>
+
+#include "MemoryProfiler.h"
+
+#ifdef LINUX
+#include <sys/mman.h>
+#endif
+#ifdef WINDOWS
+#include <malloc.h>
+#endif
+
+
+namespace media_proc
+{
+    class PooledBuffer;
+
+    // Process-wide cache of 64-byte aligned blocks, keyed by their rounded size.
+    // Per-frame scratch buffers go back to the pool instead of the heap, so after the
+    // first frame of a given geometry no allocation or page fault happens per frame.
+    class BufferPool {
+    public:
+        static constexpr size_t Alignment = 64;
+        static constexpr size_t HugePageSize = 2 << 20;
+
+        static BufferPool& global() {
+            static BufferPool pool;
+            return pool;
+        }
+
+        ~BufferPool() { trim(); }
+
+        // Back blocks of at least 2 MiB with transparent huge pages (Linux only)
+        void setHugePages(bool enabled) { m_HugePages.store(enabled); }
+        bool hugePages() const { return m_HugePages.load(std::memory_order_relaxed); }
+
+        static void* allocateAligned(size_t size, bool hugePages) {
+            size_t alignment = Alignment;
+        #ifdef LINUX
+            if (hugePages && size >= HugePageSize) alignment = HugePageSize;
+        #endif
+            void* ptr = nullptr;
+        #ifdef WINDOWS
+            ptr = _aligned_malloc(roundUp(size, alignment), alignment);
+            if (!ptr) throw std::bad_alloc();
+        #else
+            if (posix_memalign(&ptr, alignment, roundUp(size, alignment)) != 0) throw std::bad_alloc();
+        #endif
+        #ifdef LINUX
+            if (alignment == HugePageSize) madvise(ptr, roundUp(size, alignment), MADV_HUGEPAGE);
+        #endif
+            MEMORY_RECORD_ALLOC(Pool, size);
+            return ptr;
+        }
+        // `size` is the one passed to allocateAligned()
+        static void freeAligned(void* ptr, size_t size) {
+            MEMORY_RECORD_FREE(Pool, size);
+        #ifdef WINDOWS
+            _aligned_free(ptr);
+        #else
+            std::free(ptr);
+        #endif
+        }
+
+        void* allocate(size_t size) {
+            size = roundUp(size, Alignment);
+            void* ptr = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                auto it = m_FreeLists.find(size);
+                if (it != m_FreeLists.end() && !it->second.empty()) {
+                    ptr = it->second.back();
+                    it->second.pop_back();
+                }
+            }
+            // Counted once the block exists, a throwing allocation hands nothing out
+            if (!ptr) ptr = allocateAligned(size, hugePages());
+            trackInUse(size);
+            return ptr;
+        }
+
+        void release(void* ptr, size_t size) {
+            if (!ptr) return;
+            size = roundUp(size, Alignment);
+            m_InUse.fetch_sub(size, std::memory_order_relaxed);
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_FreeLists[size].push_back(ptr);
+        }
+
+        // Bytes handed out and not yet released, and the highest value since the last resetPeak()
+        size_t inUse() const { return m_InUse.load(std::memory_order_relaxed); }
+        size_t peakInUse() const { return m_PeakInUse.load(std::memory_order_relaxed); }
+        void resetPeak() { m_PeakInUse.store(inUse(), std::memory_order_relaxed); }
+
+        // Bytes released and kept for reuse
+        size_t cachedBytes() {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            size_t bytes = 0;
+            for (const auto &[size, blocks] : m_FreeLists) bytes += size * blocks.size();
+            return bytes;
+        }
+
+        PooledBuffer acquire(size_t size);
+
+        // Returns every cached block to the system
+        void trim() {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            for (auto &[size, blocks] : m_FreeLists) {
+                for (void* ptr : blocks) freeAligned(ptr, size);
+            }
+            m_FreeLists.clear();
+        }
+
+        static size_t roundUp(size_t size, size_t alignment) { return (size + alignment - 1) / alignment * alignment; }
+
+    private:
+        void trackInUse(size_t size) {
+            size_t inUse = m_InUse.fetch_add(size, std::memory_order_relaxed) + size;
+            size_t peak = m_PeakInUse.load(std::memory_order_relaxed);
+            while (inUse > peak && !m_PeakInUse.compare_exchange_weak(peak, inUse, std::memory_order_relaxed)) { }
+        }
+
+    private:
+        std::mutex m_Mutex;
+        std::unordered_map<size_t, std::vector<void*>> m_FreeLists;
+        std::atomic<bool> m_HugePages{false};
+        std::atomic<size_t> m_InUse{0};
+        std::atomic<size_t> m_PeakInUse{0};
+    };
+
+    // Move-only handle to a pooled block, returned to the pool on destruction
+    class PooledBuffer {
+    public:
+        PooledBuffer() = default;
+        PooledBuffer(uint8_t* data, size_t size) : m_Data(data), m_Size(size) { }
+        PooledBuffer(PooledBuffer &&other) noexcept : m_Data(other.m_Data), m_Size(other.m_Size) { other.m_Data = nullptr; other.m_Size = 0; }
+        PooledBuffer& operator=(PooledBuffer &&other) noexcept {
+            if (this != &other) {
+                reset();
+                std::swap(m_Data, other.m_Data);
+                std::swap(m_Size, other.m_Size);
+            }
+            return *this;
+        }
+        PooledBuffer(const PooledBuffer&) = delete;
+        PooledBuffer& operator=(const PooledBuffer&) = delete;
+        ~PooledBuffer() { reset(); }
+
+        void reset() {
+            BufferPool::global().release(m_Data, m_Size);
+            m_Data = nullptr;
+            m_Size = 0;
+        }
+
+        uint8_t* data() const { return m_Data; }
+        size_t size() const { return m_Size; }
+
+    private:
+        uint8_t* m_Data = nullptr;
+        size_t m_Size = 0;
+    };
+
+    inline PooledBuffer BufferPool::acquire(size_t size) {
+        return PooledBuffer(static_cast<uint8_t*>(allocate(size)), size);
+    }
+}
+
+
+#endif //!BUFFER_POOL_H
@@ -0,0 +1,290 @@
+#ifndef EXECUTOR_H
+#define EXECUTOR_H
+
+#include <map>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <string>
+#include <condition_variable>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+#include "Trace.h"
+
+
+namespace media_proc
+{
+    // Completion counter for a set of tasks. A group starts open; work submitted into it keeps it
+    // pending, and it completes once close() was called and every task has finished. A group can
+    // carry a continuation that runs on completion and may submit more work into its parent group.
+    class TaskGroup {
+    public:
+        TaskGroup() = default;
+        TaskGroup(const TaskGroup&) = delete;
+        TaskGroup& operator=(const TaskGroup&) = delete;
+
+        // Keeps `parent` pending until this group completed and `continuation` ran
+        void then(TaskGroup* parent, std::function<void()> continuation) {
+            m_Parent = parent;
+            m_Continuation = std::move(continuation);
+            if (m_Parent) m_Parent->retain();
+        }
+
+        void retain() { m_Pending.fetch_add(1, std::memory_order_relaxed); }
+
+        void release() {
+            if (m_Pending.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+
+            if (m_Continuation) {
+                try { m_Continuation(); }
+                catch (...) { fail(std::current_exception()); }
+            }
+
+            // Nothing below may touch `this`: a waiter can destroy the group as soon as it is done
+            TaskGroup* parent = m_Parent;
+            std::exception_ptr error = m_Error;
+            if (parent && error) parent->fail(error);
+            m_Done.store(true, std::memory_order_release);
+            if (parent) parent->release();
+        }
+
+        // Drops the token the group was created with; call once all work was submitted
+        void close() { release(); }
+
+        bool done() const { return m_Done.load(std::memory_order_acquire); }
+
+        void fail(std::exception_ptr error) {
+            std::lock_guard<std::mutex> lock(m_ErrorMutex);
+            if (!m_Error) m_Error = error;
+        }
+        void rethrowIfFailed() {
+            std::lock_guard<std::mutex> lock(m_ErrorMutex);
+            if (m_Error) std::rethrow_exception(m_Error);
+        }
+
+    private:
+        std::atomic<size_t> m_Pending{1};
+        std::atomic<bool> m_Done{false};
+        TaskGroup* m_Parent = nullptr;
+        std::function<void()> m_Continuation;
+
+        std::mutex m_ErrorMutex;
+        std::exception_ptr m_Error;
+    };
+
+    // Process-wide work-stealing executor. Every worker owns a deque: it pushes and pops work at the
+    // back and idle workers steal from the front of the others. parallelFor() hands out ranges that
+    // split lazily in halves while they are larger than the grain, so the number of tasks adapts to
+    // how busy the workers are instead of being one task per row.
+    class Executor {
+    public:
+        static Executor& global() {
+            static Executor executor(std::max(1u, std::thread::hardware_concurrency()));
+            return executor;
+        }
+
+        // Process-wide executor with `numThreads` workers, shared by every node asking for that count.
+        // 0 means one worker per core, which is global().
+        static Executor& withThreads(size_t numThreads) {
+            if (numThreads == 0 || numThreads == global().size()) return global();
+
+            static std::mutex mutex;
+            static std::map<size_t, std::unique_ptr<Executor>> executors;
+            std::lock_guard<std::mutex> lock(mutex);
+            std::unique_ptr<Executor> &executor = executors[numThreads];
+            if (!executor) executor = std::make_unique<Executor>(numThreads);
+            return *executor;
+        }
+
+        explicit Executor(size_t numThreads) : m_Queues(numThreads + 1) {
+            for (size_t i = 0; i < numThreads; ++i) {
+                m_Workers.emplace_back([this, i]() { workerLoop(i); });
+            }
+        }
+
+        ~Executor() {
+            {
+                std::lock_guard<std::mutex> lock(m_SleepMutex);
+                m_Stop.store(true);
+            }
+            m_WakeUp.notify_all();
+            for (std::thread &worker : m_Workers) worker.join();
+        }
+
+        size_t size() const { return m_Workers.size(); }
+
+        // Schedules fn(begin, end) over sub-ranges of [begin, end) without waiting. A grain of 0 picks one
+        // from the range size and worker count. `group` completes once every sub-range has run.
+        template<typename F>
+        void parallelFor(TaskGroup &group, size_t begin, size_t end, F fn, size_t grain = 0) {
+            if (begin >= end) return;
+            if (grain == 0) grain = std::max<size_t>(1, (end - begin) / (8 * (size() + 1)));
+
+            group.retain();
+            push(Task{ new RangeJob<F>(std::move(fn), grain, &group), begin, end });
+        }
+
+        // Blocking form: the calling thread helps until the whole range is done
+        template<typename F>
+        void parallelFor(size_t begin, size_t end, F fn, size_t grain = 0) {
+            TaskGroup group;
+            parallelFor(group, begin, end, std::move(fn), grain);
+            group.close();
+            wait(group);
+        }
+
+        // Runs queued tasks on the calling thread until the group completed, then rethrows its first error
+        void wait(TaskGroup &group) {
+            for (unsigned int spins = 0; !group.done();) {
+                Task task;
+                if (tryPop(ownQueue(), task)) { execute(task); spins = 0; }
+                else if (++spins < 64) pause();
+                else std::this_thread::yield();
+            }
+            group.rethrowIfFailed();
+        }
+
+    private:
+        struct Job {
+            Job(size_t grain, TaskGroup* group) : grain(grain), group(group) { }
+            virtual ~Job() = default;
+            virtual void run(size_t begin, size_t end) = 0;
+
+            size_t grain;
+            TaskGroup* group;
+            std::atomic<size_t> pending{1};
+        };
+
+        template<typename F>
+        struct RangeJob : Job {
+            RangeJob(F fn, size_t grain, TaskGroup* group) : Job(grain, group), fn(std::move(fn)) { }
+            void run(size_t begin, size_t end) override { fn(begin, end); }
+            F fn;
+        };
+
+        struct Task {
+            Job* job = nullptr;
+            size_t begin = 0, end = 0;
+        };
+
+        class SpinLock {
+        public:
+            void lock() { while (m_Flag.test_and_set(std::memory_order_acquire)) pause(); }
+            void unlock() { m_Flag.clear(std::memory_order_release); }
+        private:
+            std::atomic_flag m_Flag = ATOMIC_FLAG_INIT;
+        };
+
+        struct alignas(64) WorkQueue {
+            SpinLock lock;
+            std::deque<Task> tasks;
+        };
+
+        static void pause() {
+        #if defined(__x86_64__) || defined(_M_X64)
+            _mm_pause();
+        #endif
+        }
+
+        // Workers own queues [0, size()); every other thread shares the last one
+        size_t ownQueue() const {
+            return (t_Owner == this) ? t_WorkerIndex : m_Workers.size();
+        }
+
+        void push(const Task &task) {
+            WorkQueue &queue = m_Queues[ownQueue()];
+            {
+                std::lock_guard<SpinLock> lock(queue.lock);
+                queue.tasks.push_back(task);
+            }
+            m_Queued.fetch_add(1);
+            if (m_Sleeping.load() > 0) {
+                std::lock_guard<std::mutex> lock(m_SleepMutex);
+                m_WakeUp.notify_one();
+            }
+        }
+
+        // Own queue from the back (hot in cache), then steal from the front of the others
+        bool tryPop(size_t index, Task &task) {
+            if (m_Queued.load(std::memory_order_relaxed) == 0) return false;
+
+            for (size_t i = 0; i < m_Queues.size(); ++i) {
+                size_t victim = (index + i) % m_Queues.size();
+                WorkQueue &queue = m_Queues[victim];
+
+                std::lock_guard<SpinLock> lock(queue.lock);
+                if (queue.tasks.empty()) continue;
+                if (victim == index) { task = queue.tasks.back(); queue.tasks.pop_back(); }
+                else { task = queue.tasks.front(); queue.tasks.pop_front(); }
+                m_Queued.fetch_sub(1);
+                return true;
+            }
+            return false;
+        }
+
+        void execute(Task task) {
+            Job* job = task.job;
+
+            // Lazy binary splitting: leave the upper half for thieves while the range exceeds the grain
+            while (task.end - task.begin > job->grain) {
+                size_t mid = task.begin + (task.end - task.begin) / 2;
+                job->pending.fetch_add(1, std::memory_order_relaxed);
+                push(Task{ job, mid, task.end });
+                task.end = mid;
+            }
+
+            try {
+                TRACE_SPAN_ARG("task", "begin", task.begin);
+                job->run(task.begin, task.end);
+            }
+            catch (...) { job->group->fail(std::current_exception()); }
+
+            if (job->pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                TaskGroup* group = job->group;
+                delete job;
+                group->release();
+            }
+        }
+
+        void workerLoop(size_t index) {
+            t_Owner = this;
+            t_WorkerIndex = index;
+            TRACE_THREAD_NAME("executor worker " + std::to_string(index));
+
+            while (!m_Stop.load()) {
+                Task task;
+                if (tryPop(index, task)) { execute(task); continue; }
+
+                std::unique_lock<std::mutex> lock(m_SleepMutex);
+                m_Sleeping.fetch_add(1);
+                m_WakeUp.wait(lock, [this]() { return m_Stop.load() || m_Queued.load() > 0; });
+                m_Sleeping.fetch_sub(1);
+            }
+        }
+
+    private:
+        std::vector<WorkQueue> m_Queues;
+        std::vector<std::thread> m_Workers;
+
+        std::atomic<size_t> m_Queued{0};
+        std::atomic<size_t> m_Sleeping{0};
+        std::atomic<bool> m_Stop{false};
+        std::mutex m_SleepMutex;
+        std::condition_variable m_WakeUp;
+
+        inline static thread_local const Executor* t_Owner = nullptr;
+        inline static thread_local size_t t_WorkerIndex = 0;
+    };
+}
+
+
+#endif //!EXECUTOR_H
@@ -0,0 +1,381 @@
+#include "MemoryProfiler.h"
+
+#ifdef TRACK_MEMORY
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <new>
+
+#ifdef LINUX
+#include <malloc.h>
+#endif
+
+namespace media_proc {
+
+    namespace {
+        constexpr size_t TagCount = MemoryProfiler::TagCount;
+
+        // Written by the owning thread only, read by report(). Blocks are never freed, so a report
+        // also sees the threads that have exited (std::async workers, concurrent pipeline stages).
+        struct ThreadCounters {
+            std::atomic<uint64_t> allocated[TagCount];
+            std::atomic<uint64_t> freed[TagCount];
+            std::atomic<uint64_t> allocations[TagCount];
+            std::atomic<uint64_t> frees[TagCount];
+            int64_t pending[TagCount];  // Change not yet added to g_Current
+            ThreadCounters* next;
+        };
+
+        std::atomic<ThreadCounters*> g_Threads{nullptr};
+        std::atomic<int64_t> g_Current[TagCount + 1];  // Last slot: all tags
+        std::atomic<int64_t> g_Peak[TagCount + 1];
+        std::atomic<bool> g_FrameReports{false};
+        std::atomic<uint64_t> g_Frames{0};
+        std::mutex g_ReportMutex;
+
+        thread_local ThreadCounters* t_Counters = nullptr;
+        thread_local MemoryTag t_Tag = MemoryTag::Other;
+
+        ThreadCounters& threadCounters() {
+            if (!t_Counters) {
+                // calloc keeps the profiler out of its own accounting
+                void* memory = std::calloc(1, sizeof(ThreadCounters));
+                if (!memory) std::abort();
+                ThreadCounters* counters = new (memory) ThreadCounters{};
+                counters->next = g_Threads.load(std::memory_order_relaxed);
+                while (!g_Threads.compare_exchange_weak(counters->next, counters, std::memory_order_release, std::memory_order_relaxed)) { }
+                t_Counters = counters;
+            }
+            return *t_Counters;
+        }
+
+        // Single writer per counter, so a relaxed load and store is enough
+        void bump(std::atomic<uint64_t> &counter, uint64_t value) {
+            counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+        }
+
+        void raisePeak(size_t slot, int64_t current) {
+            int64_t peak = g_Peak[slot].load(std::memory_order_relaxed);
+            while (current > peak && !g_Peak[slot].compare_exchange_weak(peak, current, std::memory_order_relaxed)) { }
+        }
+
+        void flush(ThreadCounters &counters, size_t tag) {
+            int64_t delta = counters.pending[tag];
+            counters.pending[tag] = 0;
+            raisePeak(tag, g_Current[tag].fetch_add(delta, std::memory_order_relaxed) + delta);
+            raisePeak(TagCount, g_Current[TagCount].fetch_add(delta, std::memory_order_relaxed) + delta);
+        }
+
+        MemoryUsage sum(size_t first, size_t last) {
+            MemoryUsage usage;
+            uint64_t freed = 0;
+            for (ThreadCounters* counters = g_Threads.load(std::memory_order_acquire); counters; counters = counters->next) {
+                for (size_t tag = first; tag < last; ++tag) {
+                    usage.allocated += counters->allocated[tag].load(std::memory_order_relaxed);
+                    freed += counters->freed[tag].load(std::memory_order_relaxed);
+                    usage.allocations += counters->allocations[tag].load(std::memory_order_relaxed);
+                    usage.frees += counters->frees[tag].load(std::memory_order_relaxed);
+                }
+            }
+            // A block allocated before the profiler could see it may still be freed through it
+            usage.current = std::max<int64_t>((int64_t)(usage.allocated - freed), 0);
+            return usage;
+        }
+    }
+
+    const char* memoryTagName(MemoryTag tag) {
+        switch (tag) {
+            case MemoryTag::Other:     return "other";
+            case MemoryTag::Decoder:   return "decoder";
+            case MemoryTag::Processor: return "processor";
+            case MemoryTag::Encoder:   return "encoder";
+            case MemoryTag::Pool:      return "pool";
+            case MemoryTag::FFmpeg:    return "ffmpeg";
+            case MemoryTag::Count:     break;
+        }
+        return "unknown";
+    }
+
+    void MemoryProfiler::recordAlloc(MemoryTag tag, size_t bytes) {
+        size_t slot = (size_t)tag;
+        ThreadCounters &counters = threadCounters();
+        bump(counters.allocated[slot], bytes);
+        bump(counters.allocations[slot], 1);
+        counters.pending[slot] += (int64_t)bytes;
+        if (counters.pending[slot] >= FlushBytes) flush(counters, slot);
+    }
+
+    void MemoryProfiler::recordFree(MemoryTag tag, size_t bytes) {
+        size_t slot = (size_t)tag;
+        ThreadCounters &counters = threadCounters();
+        bump(counters.freed[slot], bytes);
+        bump(counters.frees[slot], 1);
+        counters.pending[slot] -= (int64_t)bytes;
+        if (counters.pending[slot] <= -FlushBytes) flush(counters, slot);
+    }
+
+    MemoryTag MemoryProfiler::setThreadTag(MemoryTag tag) {
+        MemoryTag previous = t_Tag;
+        t_Tag = tag;
+        return previous;
+    }
+
+    MemoryTag MemoryProfiler::threadTag() { return t_Tag; }
+
+    MemoryUsage MemoryProfiler::usage(MemoryTag tag) {
+        MemoryUsage usage = sum((size_t)tag, (size_t)tag + 1);
+        usage.peak = std::max(g_Peak[(size_t)tag].load(std::memory_order_relaxed), usage.current);
+        return usage;
+    }
+
+    MemoryUsage MemoryProfiler::total() {
+        MemoryUsage usage = sum(0, TagCount);
+        usage.peak = std::max(g_Peak[TagCount].load(std::memory_order_relaxed), usage.current);
+        return usage;
+    }
+
+    void MemoryProfiler::resetPeak() {
+        for (size_t tag = 0; tag < TagCount; ++tag) g_Peak[tag].store(sum(tag, tag + 1).current, std::memory_order_relaxed);
+        g_Peak[TagCount].store(sum(0, TagCount).current, std::memory_order_relaxed);
+    }
+
+    void MemoryProfiler::report(std::ostream &out, const std::string &title) {
+        std::ios state(nullptr);
+        state.copyfmt(out);
+
+        auto row = [&out](const char* name, const MemoryUsage &usage) {
+            out << "  " << std::left << std::setw(11) << name << std::right << std::setw(15) << usage.current << std::setw(15) << usage.peak
+                << std::setw(17) << usage.allocated << std::setw(13) << usage.allocations << std::setw(13) << usage.frees << "\n";
+        };
+
+        out << "[Memory] " << title << "\n";
+        out << "  " << std::left << std::setw(11) << "tag" << std::right << std::setw(15) << "live bytes" << std::setw(15) << "peak bytes"
+            << std::setw(17) << "allocated bytes" << std::setw(13) << "allocs" << std::setw(13) << "frees" << "\n";
+        for (size_t tag = 0; tag < TagCount; ++tag) {
+            MemoryUsage tagUsage = usage((MemoryTag)tag);
+            if (tagUsage.allocations) row(memoryTagName((MemoryTag)tag), tagUsage);
+        }
+        row("total", total());
+        out.copyfmt(state);
+    }
+
+    void MemoryProfiler::setFrameReports(bool enabled) { g_FrameReports.store(enabled, std::memory_order_relaxed); }
+
+    void MemoryProfiler::frameDone() {
+        uint64_t frame = g_Frames.fetch_add(1, std::memory_order_relaxed) + 1;
+        if (!g_FrameReports.load(std::memory_order_relaxed)) return;
+
+        // Encoders of concurrent batch lanes report one at a time, and the report's own strings are not charged to them
+        MemoryTagScope scope(MemoryTag::Other);
+        std::lock_guard<std::mutex> lock(g_ReportMutex);
+        report(std::cout, "after frame " + std::to_string(frame));
+        resetPeak();
+    }
+}
+
+
+// Replacement operator new/delete. A 16-byte header in front of each block remembers its size and
+// tag, so a block freed on another thread (packets cross pipeline stages) is credited to the right tag.
+
+namespace {
+    struct alignas(16) BlockHeader {
+        size_t size;
+        uint32_t offset;  // From the start of the malloc'd block to the user pointer
+        media_proc::MemoryTag tag;
+    };
+    static_assert(sizeof(BlockHeader) == 16, "operator new must keep 16-byte alignment");
+
+    void* allocate(size_t size, size_t alignment, bool nothrow) {
+        alignment = std::max(alignment, alignof(BlockHeader));
+        size_t extra = sizeof(BlockHeader) + (alignment > alignof(std::max_align_t) ? alignment : 0);
+        uint8_t* raw = static_cast<uint8_t*>(std::malloc(size + extra));
+        if (!raw) {
+            if (nothrow) return nullptr;
+            throw std::bad_alloc();
+        }
+
+        uintptr_t user = ((uintptr_t)raw + sizeof(BlockHeader) + alignment - 1) / alignment * alignment;
+        BlockHeader* header = reinterpret_cast<BlockHeader*>(user) - 1;
+        header->size = size;
+        header->offset = (uint32_t)(user - (uintptr_t)raw);
+        header->tag = media_proc::MemoryProfiler::threadTag();
+        media_proc::MemoryProfiler::recordAlloc(header->tag, size);
+        return reinterpret_cast<void*>(user);
+    }
+
+    void release(void* ptr) noexcept {
+        if (!ptr) return;
+        BlockHeader* header = static_cast<BlockHeader*>(ptr) - 1;
+        media_proc::MemoryProfiler::recordFree(header->tag, header->size);
+        std::free(static_cast<uint8_t*>(ptr) - header->offset);
+    }
+}
+
+void* operator new(std::size_t size) { return allocate(size, alignof(std::max_align_t), false); }
+void* operator new[](std::size_t size) { return allocate(size, alignof(std::max_align_t), false); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return allocate(size, alignof(std::max_align_t), true); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return allocate(size, alignof(std::max_align_t), true); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return allocate(size, (size_t)alignment, false); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return allocate(size, (size_t)alignment, false); }
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocate(size, (size_t)alignment, true); }
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocate(size, (size_t)alignment, true); }
+
+void operator delete(void* ptr) noexcept { release(ptr); }
+void operator delete[](void* ptr) noexcept { release(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { release(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { release(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { release(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { release(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { release(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { release(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { release(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { release(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { release(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { release(ptr); }
+
+
+#ifdef LINUX
+// FFmpeg has no allocator hook (av_max_alloc only caps sizes), so with --track-memory the linker
+// redirects these entry points here (-Wl,--wrap, see premake5.lua) and __real_* reaches libavutil.
+// av_malloc uses posix_memalign, so malloc_usable_size() sizes a block when it is freed again.
+// Calls between functions inside libavutil/mem.c itself are not redirected, so every entry point
+// there that allocates (av_strndup and the av_dynarray*_add helpers too) is wrapped on its own.
+
+namespace {
+    size_t usableSize(const void* ptr) { return ptr ? malloc_usable_size(const_cast<void*>(ptr)) : 0; }
+
+    void trackAlloc(const void* ptr) {
+        if (ptr) media_proc::MemoryProfiler::recordAlloc(media_proc::MemoryTag::FFmpeg, usableSize(ptr));
+    }
+    void trackFree(const void* ptr) {
+        if (ptr) media_proc::MemoryProfiler::recordFree(media_proc::MemoryTag::FFmpeg, usableSize(ptr));
+    }
+    // `ptr` was replaced by `result`; a failed reallocation leaves ptr alone
+    void trackRealloc(const void* ptr, size_t oldSize, const void* result) {
+        if (!result || (result == ptr && usableSize(result) == oldSize)) return;
+        if (ptr) media_proc::MemoryProfiler::recordFree(media_proc::MemoryTag::FFmpeg, oldSize);
+        trackAlloc(result);
+    }
+    // A pointer updated in place: cleared means the old block was freed, otherwise it was reallocated
+    void trackArray(const void* old, size_t oldSize, const void* updated) {
+        if (!updated && old) media_proc::MemoryProfiler::recordFree(media_proc::MemoryTag::FFmpeg, oldSize);
+        else trackRealloc(old, oldSize, updated);
+    }
+}
+
+extern "C" {
+    void* __real_av_malloc(size_t size);
+    void* __real_av_mallocz(size_t size);
+    void* __real_av_calloc(size_t count, size_t size);
+    void* __real_av_malloc_array(size_t count, size_t size);
+    void* __real_av_realloc(void* ptr, size_t size);
+    void* __real_av_realloc_array(void* ptr, size_t count, size_t size);
+    void* __real_av_realloc_f(void* ptr, size_t count, size_t size);
+    int __real_av_reallocp(void* ptr, size_t size);
+    void* __real_av_fast_realloc(void* ptr, unsigned int* size, size_t minSize);
+    void __real_av_fast_malloc(void* ptr, unsigned int* size, size_t minSize);
+    void __real_av_fast_mallocz(void* ptr, unsigned int* size, size_t minSize);
+    char* __real_av_strdup(const char* string);
+    char* __real_av_strndup(const char* string, size_t length);
+    void* __real_av_memdup(const void* data, size_t size);
+    void __real_av_dynarray_add(void* table, int* count, void* element);
+    int __real_av_dynarray_add_nofree(void* table, int* count, void* element);
+    void* __real_av_dynarray2_add(void** table, int* count, size_t elementSize, const uint8_t* elementData);
+    void __real_av_free(void* ptr);
+    void __real_av_freep(void* ptr);
+
+    void* __wrap_av_malloc(size_t size) { void* ptr = __real_av_malloc(size); trackAlloc(ptr); return ptr; }
+    void* __wrap_av_mallocz(size_t size) { void* ptr = __real_av_mallocz(size); trackAlloc(ptr); return ptr; }
+    void* __wrap_av_calloc(size_t count, size_t size) { void* ptr = __real_av_calloc(count, size); trackAlloc(ptr); return ptr; }
+    void* __wrap_av_malloc_array(size_t count, size_t size) { void* ptr = __real_av_malloc_array(count, size); trackAlloc(ptr); return ptr; }
+    char* __wrap_av_strdup(const char* string) { char* ptr = __real_av_strdup(string); trackAlloc(ptr); return ptr; }
+    char* __wrap_av_strndup(const char* string, size_t length) { char* ptr = __real_av_strndup(string, length); trackAlloc(ptr); return ptr; }
+    void* __wrap_av_memdup(const void* data, size_t size) { void* ptr = __real_av_memdup(data, size); trackAlloc(ptr); return ptr; }
+
+    void* __wrap_av_realloc(void* ptr, size_t size) {
+        size_t oldSize = usableSize(ptr);
+        void* result = __real_av_realloc(ptr, size);
+        trackRealloc(ptr, oldSize, result);
+        return result;
+    }
+    void* __wrap_av_realloc_array(void* ptr, size_t count, size_t size) {
+        size_t oldSize = usableSize(ptr);
+        void* result = __real_av_realloc_array(ptr, count, size);
+        trackRealloc(ptr, oldSize, result);
+        return result;
+    }
+    void* __wrap_av_fast_realloc(void* ptr, unsigned int* size, size_t minSize) {
+        size_t oldSize = usableSize(ptr);
+        void* result = __real_av_fast_realloc(ptr, size, minSize);
+        trackRealloc(ptr, oldSize, result);
+        return result;
+    }
+
+    // Frees `ptr` when it fails
+    void* __wrap_av_realloc_f(void* ptr, size_t count, size_t size) {
+        size_t oldSize = usableSize(ptr);
+        void* result = __real_av_realloc_f(ptr, count, size);
+        if (!result && ptr) media_proc::MemoryProfiler::recordFree(media_proc::MemoryTag::FFmpeg, oldSize);
+        else trackRealloc(ptr, oldSize, result);
+        return result;
+    }
+
+    // These take the address of the caller's pointer and update it in place
+    int __wrap_av_reallocp(void* ptr, size_t size) {
+        void* old = *static_cast<void**>(ptr);
+        size_t oldSize = usableSize(old);
+        int result = __real_av_reallocp(ptr, size);
+        trackArray(old, oldSize, *static_cast<void**>(ptr));
+        return result;
+    }
+    // Grow the caller's array by one entry; all but _nofree free the array and clear it when that fails
+    void __wrap_av_dynarray_add(void* table, int* count, void* element) {
+        void* old = *static_cast<void**>(table);
+        size_t oldSize = usableSize(old);
+        __real_av_dynarray_add(table, count, element);
+        trackArray(old, oldSize, *static_cast<void**>(table));
+    }
+    int __wrap_av_dynarray_add_nofree(void* table, int* count, void* element) {
+        void* old = *static_cast<void**>(table);
+        size_t oldSize = usableSize(old);
+        int result = __real_av_dynarray_add_nofree(table, count, element);
+        trackArray(old, oldSize, *static_cast<void**>(table));
+        return result;
+    }
+    void* __wrap_av_dynarray2_add(void** table, int* count, size_t elementSize, const uint8_t* elementData) {
+        void* old = *table;
+        size_t oldSize = usableSize(old);
+        void* result = __real_av_dynarray2_add(table, count, elementSize, elementData);
+        trackArray(old, oldSize, *table);
+        return result;
+    }
+
+    void __wrap_av_fast_malloc(void* ptr, unsigned int* size, size_t minSize) {
+        void* old = *static_cast<void**>(ptr);
+        size_t oldSize = usableSize(old);
+        __real_av_fast_malloc(ptr, size, minSize);
+        void* updated = *static_cast<void**>(ptr);
+        if (updated == old) return;
+        if (old) media_proc::MemoryProfiler::recordFree(media_proc::MemoryTag::FFmpeg, oldSize);
+        trackAlloc(updated);
+    }
+    void __wrap_av_fast_mallocz(void* ptr, unsigned int* size, size_t minSize) {
+        void* old = *static_cast<void**>(ptr);
+        size_t oldSize = usableSize(old);
+        __real_av_fast_mallocz(ptr, size, minSize);
+        void* updated = *static_cast<void**>(ptr);
+        if (updated == old) return;
+        if (old) media_proc::MemoryProfiler::recordFree(media_proc::MemoryTag::FFmpeg, oldSize);
+        trackAlloc(updated);
+    }
+
+    void __wrap_av_free(void* ptr) { trackFree(ptr); __real_av_free(ptr); }
+    void __wrap_av_freep(void* ptr) { trackFree(*static_cast<void**>(ptr)); __real_av_freep(ptr); }
+}
+#endif //!LINUX
+
+#endif //!TRACK_MEMORY
@@ -1,56 +1,98 @@
 #ifndef MEMORY_PROFILER_H
 #define MEMORY_PROFILER_H
 
+// Byte-accurate heap accounting, compiled in with TRACK_MEMORY (premake5 --track-memory).
+// Every operator new/delete, every BufferPool block and, on Linux, every block handed out by an
+// entry point of libavutil/mem.c is counted in bytes against a tag: the subsystem whose code
+// is running on the calling thread. Counting is lock-free on thread-local counters, so the
+// profiler can stay on while the concurrent pipeline runs. Without TRACK_MEMORY the MEMORY_*
+// macros compile to nothing.
+
 #ifdef TRACK_MEMORY
 
-#include <cstdlib>
-#include <iostream>
-#include <unordered_map>
-#include <mutex>
-#include <new>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
 
-static size_t g_TotalAllocated = 0, g_TotalFreed = 0;
-static std::mutex g_AllocMutex;
 
-inline void* operator new(std::size_t size) {
-    void* ptr = std::malloc(size);
-    if (!ptr) throw std::bad_alloc();
-    { std::lock_guard<std::mutex> lock(g_AllocMutex); ++g_TotalAllocated; }
-    return ptr;
-}
-inline void* operator new[](std::size_t size) {
-    void* ptr = std::malloc(size);
-    if (!ptr) throw std::bad_alloc();
-    { std::lock_guard<std::mutex> lock(g_AllocMutex); ++g_TotalAllocated; }
-    return ptr;
-}
+namespace media_proc
+{
+    enum class MemoryTag : uint8_t {
+        Other,      // Anything outside a tagged scope: setup, parsing, the main thread
+        Decoder,    // Heap allocations made while a decoder node runs
+        Processor,  // Heap allocations of the blur nodes, e.g. async row buffers and kernels
+        Encoder,    // Heap allocations made while an encoder node runs
+        Pool,       // Blocks backing BufferPool and the frame pool, whoever asked for them
+        FFmpeg,     // av_malloc and friends, whichever node called into libav*
+        Count
+    };
 
-inline void operator delete(void* ptr) noexcept {
-    if (ptr) { std::lock_guard<std::mutex> lock(g_AllocMutex); ++g_TotalFreed; std::free(ptr); }
-}
-inline void operator delete[](void* ptr) noexcept {
-    if (ptr) { std::lock_guard<std::mutex> lock(g_AllocMutex); ++g_TotalFreed; std::free(ptr); }
-}
+    const char* memoryTagName(MemoryTag tag);
 
-inline void operator delete(void* ptr, std::size_t) noexcept {
-    if (ptr) { std::lock_guard<std::mutex> lock(g_AllocMutex); ++g_TotalFreed; std::free(ptr); }
-}
-inline void operator delete[](void* ptr, std::size_t) noexcept {
-    if (ptr) { std::lock_guard<std::mutex> lock(g_AllocMutex); ++g_TotalFreed; std::free(ptr); }
+    struct MemoryUsage {
+        int64_t current = 0;        // Live bytes
+        int64_t peak = 0;           // Highest live bytes since the last resetPeak()
+        uint64_t allocated = 0;     // Bytes allocated in total
+        uint64_t allocations = 0;
+        uint64_t frees = 0;
+    };
+
+    // All state is constant-initialized, operator new can run before main() and after it returns
+    class MemoryProfiler {
+    public:
+        static constexpr size_t TagCount = (size_t)MemoryTag::Count;
+
+        // Counted on the calling thread's counters without a lock
+        static void recordAlloc(MemoryTag tag, size_t bytes);
+        static void recordFree(MemoryTag tag, size_t bytes);
+
+        // Tag charged for the calling thread's operator new; returns the previous one
+        static MemoryTag setThreadTag(MemoryTag tag);
+        static MemoryTag threadTag();
+
+        // Live bytes are exact. Peaks are tracked on totals that each thread updates every
+        // FlushBytes of change, so they may miss a short spike of up to FlushBytes per thread.
+        static constexpr int64_t FlushBytes = 64 << 10;
+        static MemoryUsage usage(MemoryTag tag);
+        static MemoryUsage total();
+        static void resetPeak();
+
+        // One row per tag that saw an allocation, then the totals
+        static void report(std::ostream &out, const std::string &title);
+
+        // Prints a report after every encoded frame, with the peaks of that frame alone
+        static void setFrameReports(bool enabled);
+        static void frameDone();
+    };
+
+    class MemoryTagScope {
+    public:
+        explicit MemoryTagScope(MemoryTag tag) : m_Previous(MemoryProfiler::setThreadTag(tag)) { }
+        ~MemoryTagScope() { MemoryProfiler::setThreadTag(m_Previous); }
+
+        MemoryTagScope(const MemoryTagScope&) = delete;
+        MemoryTagScope& operator=(const MemoryTagScope&) = delete;
+
+    private:
+        MemoryTag m_Previous;
+    };
 }
 
-struct LeakChecker {
-    ~LeakChecker() {
-        std::lock_guard<std::mutex> lock(g_AllocMutex);
-        std::cerr << "[Memory Usage Summary]\n"
-                  << "  Total allocated: " << g_TotalAllocated << " times\n"
-                  << "  Total freed:     " << g_TotalFreed << " times\n"
-                  << "  Net allocated:   " << (g_TotalAllocated - g_TotalFreed) << " times\n";
-    }
-};
+#define MEMORY_CONCAT_INNER(a, b) a##b
+#define MEMORY_CONCAT(a, b) MEMORY_CONCAT_INNER(a, b)
+
+#define MEMORY_TAG_SCOPE(tag) media_proc::MemoryTagScope MEMORY_CONCAT(memoryTag, __LINE__)(media_proc::MemoryTag::tag)
+#define MEMORY_RECORD_ALLOC(tag, bytes) media_proc::MemoryProfiler::recordAlloc(media_proc::MemoryTag::tag, bytes)
+#define MEMORY_RECORD_FREE(tag, bytes) media_proc::MemoryProfiler::recordFree(media_proc::MemoryTag::tag, bytes)
+#define MEMORY_FRAME_DONE() media_proc::MemoryProfiler::frameDone()
 
-inline LeakChecker g_LeakChecker;
+#else
 
+#define MEMORY_TAG_SCOPE(tag) ((void)0)
+#define MEMORY_RECORD_ALLOC(tag, bytes) ((void)0)
+#define MEMORY_RECORD_FREE(tag, bytes) ((void)0)
+#define MEMORY_FRAME_DONE() ((void)0)
 
 #endif //!TRACK_MEMORY
 
@@ -0,0 +1,226 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <map>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <ostream>
+#include <iomanip>
+#include <functional>
+
+
+namespace media_proc
+{
+    // Recording is one relaxed atomic add per value, cheap enough to stay on in production.
+    // Series live as long as the process, so hot paths look them up once and keep the reference.
+
+    class Counter {
+    public:
+        void add(uint64_t value = 1) { m_Value.fetch_add(value, std::memory_order_relaxed); }
+        uint64_t value() const { return m_Value.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<uint64_t> m_Value{0};
+    };
+
+    class Gauge {
+    public:
+        void set(int64_t value) { m_Value.store(value, std::memory_order_relaxed); }
+        void add(int64_t value) { m_Value.fetch_add(value, std::memory_order_relaxed); }
+        int64_t value() const { return m_Value.load(std::memory_order_relaxed); }
+
+    private:
+        std::atomic<int64_t> m_Value{0};
+    };
+
+    // Fixed buckets in seconds; the sum is kept in nanoseconds so it stays an integer atomic
+    class Histogram {
+    public:
+        explicit Histogram(std::vector<double> bounds) : m_Bounds(std::move(bounds)), m_Buckets(m_Bounds.size() + 1) { }
+
+        // 0.5 ms to 10 s, wide enough for a tile band and for a 16K frame through the GPU
+        static std::vector<double> latencyBounds() {
+            return { 0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0 };
+        }
+
+        void observeNs(int64_t ns) {
+            double seconds = ns * 1e-9;
+            size_t bucket = 0;
+            while (bucket < m_Bounds.size() && seconds > m_Bounds[bucket]) ++bucket;
+            m_Buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+            m_SumNs.fetch_add((uint64_t)std::max<int64_t>(ns, 0), std::memory_order_relaxed);
+        }
+
+        const std::vector<double>& bounds() const { return m_Bounds; }
+        uint64_t bucketCount(size_t bucket) const { return m_Buckets[bucket].load(std::memory_order_relaxed); }
+        double sumSeconds() const { return m_SumNs.load(std::memory_order_relaxed) * 1e-9; }
+
+    private:
+        std::vector<double> m_Bounds;
+        std::vector<std::atomic<uint64_t>> m_Buckets;
+        std::atomic<uint64_t> m_SumNs{0};
+    };
+
+    class MetricsRegistry {
+    public:
+        static MetricsRegistry& global() {
+            static MetricsRegistry registry;
+            return registry;
+        }
+
+        // `labels` is the Prometheus label list without braces, e.g. label("node", "decoder").
+        // Asking again for a name and labels returns the same series.
+        Counter& counter(const std::string &name, const std::string &help, const std::string &labels = "") {
+            return *series(name, help, "counter", labels).counter;
+        }
+        Gauge& gauge(const std::string &name, const std::string &help, const std::string &labels = "") {
+            return *series(name, help, "gauge", labels).gauge;
+        }
+        Histogram& histogram(const std::string &name, const std::string &help, const std::string &labels = "",
+                             const std::vector<double> &bounds = Histogram::latencyBounds()) {
+            Series &entry = series(name, help, "histogram", labels, &bounds);
+            return *entry.histogram;
+        }
+
+        // Gauge computed when the metrics are written, for values owned elsewhere (pool sizes, queue depths).
+        // Callbacks of the same name and labels, such as the queues between the same stages of several
+        // lanes, are written as one series holding their sum.
+        // Returns an id for removeCallback(); remove it before whatever `read` looks at goes away.
+        size_t addCallback(const std::string &name, const std::string &help, const std::string &labels, std::function<double()> read) {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            Family &family = this->family(name, help, "gauge");
+            family.callbacks.push_back({ ++m_NextCallback, labels, std::move(read) });
+            return m_NextCallback;
+        }
+
+        void removeCallback(size_t id) {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            for (auto &[name, family] : m_Families) {
+                auto &callbacks = family.callbacks;
+                callbacks.erase(std::remove_if(callbacks.begin(), callbacks.end(), [id](const Callback &c) { return c.id == id; }), callbacks.end());
+            }
+        }
+
+        static std::string label(const std::string &key, const std::string &value) {
+            std::string escaped;
+            for (char c : value) {
+                if (c == '\\' || c == '"') escaped += '\\';
+                if (c == '\n') { escaped += "\\n"; continue; }
+                escaped += c;
+            }
+            return key + "=\"" + escaped + "\"";
+        }
+
+        // Prometheus text exposition format 0.0.4
+        void writePrometheus(std::ostream &out) {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            std::ios state(nullptr);
+            state.copyfmt(out);
+            out << std::setprecision(12);
+
+            for (const auto &[name, family] : m_Families) {
+                if (family.series.empty() && family.callbacks.empty()) continue;
+                out << "# HELP " << name << " " << family.help << "\n";
+                out << "# TYPE " << name << " " << family.type << "\n";
+
+                for (const auto &[labels, entry] : family.series) {
+                    if (entry.counter) out << name << braces(labels) << " " << entry.counter->value() << "\n";
+                    else if (entry.gauge) out << name << braces(labels) << " " << entry.gauge->value() << "\n";
+                    else if (entry.histogram) writeHistogram(out, name, labels, *entry.histogram);
+                }
+                std::vector<std::pair<std::string, double>> values;
+                for (const Callback &callback : family.callbacks) {
+                    auto it = std::find_if(values.begin(), values.end(), [&](const auto &value) { return value.first == callback.labels; });
+                    if (it == values.end()) values.emplace_back(callback.labels, callback.read());
+                    else it->second += callback.read();
+                }
+                for (const auto &[labels, value] : values) out << name << braces(labels) << " " << value << "\n";
+            }
+            out.copyfmt(state);
+        }
+
+    private:
+        struct Series {
+            std::unique_ptr<Counter> counter;
+            std::unique_ptr<Gauge> gauge;
+            std::unique_ptr<Histogram> histogram;
+        };
+
+        struct Callback {
+            size_t id;
+            std::string labels;
+            std::function<double()> read;
+        };
+
+        struct Family {
+            std::string help, type;
+            std::map<std::string, Series> series;
+            std::vector<Callback> callbacks;
+        };
+
+        Family& family(const std::string &name, const std::string &help, const char* type) {
+            Family &family = m_Families[name];
+            if (family.type.empty()) {
+                family.help = help;
+                family.type = type;
+            }
+            else if (family.type != type) throw std::runtime_error("Metric " + name + " registered as " + family.type + " and " + type);
+            return family;
+        }
+
+        Series& series(const std::string &name, const std::string &help, const char* type, const std::string &labels,
+                       const std::vector<double>* bounds = nullptr) {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            Series &entry = family(name, help, type).series[labels];
+            if (!entry.counter && !entry.gauge && !entry.histogram) {
+                if (bounds) entry.histogram = std::make_unique<Histogram>(*bounds);
+                else if (std::string(type) == "counter") entry.counter = std::make_unique<Counter>();
+                else entry.gauge = std::make_unique<Gauge>();
+            }
+            return entry;
+        }
+
+        static std::string braces(const std::string &labels) { return labels.empty() ? "" : "{" + labels + "}"; }
+
+        static void writeHistogram(std::ostream &out, const std::string &name, const std::string &labels, const Histogram &histogram) {
+            std::string prefix = labels.empty() ? "" : labels + ",";
+            uint64_t cumulative = 0;
+            for (size_t bucket = 0; bucket < histogram.bounds().size(); ++bucket) {
+                cumulative += histogram.bucketCount(bucket);
+                out << name << "_bucket{" << prefix << "le=\"" << histogram.bounds()[bucket] << "\"} " << cumulative << "\n";
+            }
+            cumulative += histogram.bucketCount(histogram.bounds().size());
+            out << name << "_bucket{" << prefix << "le=\"+Inf\"} " << cumulative << "\n";
+            out << name << "_sum" << braces(labels) << " " << histogram.sumSeconds() << "\n";
+            out << name << "_count" << braces(labels) << " " << cumulative << "\n";
+        }
+
+    private:
+        std::mutex m_Mutex;
+        std::map<std::string, Family> m_Families;
+        size_t m_NextCallback = 0;
+    };
+
+    // Callback gauge that is removed again when the owner of the measured value goes away
+    class ScopedMetric {
+    public:
+        ScopedMetric(const std::string &name, const std::string &help, const std::string &labels, std::function<double()> read)
+            : m_Id(MetricsRegistry::global().addCallback(name, help, labels, std::move(read))) { }
+        ~ScopedMetric() { MetricsRegistry::global().removeCallback(m_Id); }
+
+        ScopedMetric(const ScopedMetric&) = delete;
+        ScopedMetric& operator=(const ScopedMetric&) = delete;
+
+    private:
+        size_t m_Id;
+    };
+}
+
+
+#endif //!METRICS_H
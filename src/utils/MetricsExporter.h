@@ -0,0 +1,174 @@
+#ifndef METRICS_EXPORTER_H
+#define METRICS_EXPORTER_H
+
+#include "Metrics.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <condition_variable>
+
+#ifdef LINUX
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+
+namespace media_proc
+{
+    // Publishes MetricsRegistry::global() while a job runs: rewrites a file in the Prometheus text
+    // format every interval (for node_exporter's textfile collector or a sidecar), and/or answers
+    // scrapes on a local HTTP port. Both run on their own thread, never on the pipeline's.
+    class MetricsExporter {
+    public:
+        MetricsExporter() = default;
+        MetricsExporter(const MetricsExporter&) = delete;
+        MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+        ~MetricsExporter() { stop(); }
+
+        // The file is written next to `path` and renamed over it, so readers never see half a scrape
+        void startFile(const std::string &path, std::chrono::milliseconds interval) {
+            m_FilePath = path;
+            if (!writeFile()) throw std::runtime_error("Cannot write metrics file " + path);
+
+            m_FileThread = std::thread([this, interval]() {
+                std::unique_lock<std::mutex> lock(m_StopMutex);
+                while (!m_WakeUp.wait_for(lock, interval, [this]() { return m_Stop.load(); })) {
+                    lock.unlock();
+                    writeFile();
+                    lock.lock();
+                }
+            });
+        }
+
+        // Serves GET /metrics on 127.0.0.1:port, Linux only
+        void startHttp(int port) {
+        #ifdef LINUX
+            m_Socket = socket(AF_INET, SOCK_STREAM, 0);
+            if (m_Socket < 0) throw std::runtime_error("Cannot create metrics socket");
+
+            int reuse = 1;
+            setsockopt(m_Socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+            sockaddr_in address{};
+            address.sin_family = AF_INET;
+            address.sin_port = htons((uint16_t)port);
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (bind(m_Socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(m_Socket, 8) < 0) {
+                close(m_Socket);
+                m_Socket = -1;
+                throw std::runtime_error("Cannot listen for metrics on port " + std::to_string(port));
+            }
+
+            m_HttpThread = std::thread([this]() { serve(); });
+        #else
+            throw std::runtime_error("The metrics endpoint is only available on Linux, use a metrics file");
+        #endif
+        }
+
+        // Final write of the file, so short jobs leave their totals behind
+        void stop() {
+            {
+                std::lock_guard<std::mutex> lock(m_StopMutex);
+                if (m_Stop.exchange(true)) return;
+            }
+            m_WakeUp.notify_all();
+            if (m_FileThread.joinable()) {
+                m_FileThread.join();
+                writeFile();
+            }
+            if (m_HttpThread.joinable()) m_HttpThread.join();
+        #ifdef LINUX
+            if (m_Socket >= 0) close(m_Socket);
+            m_Socket = -1;
+        #endif
+        }
+
+    private:
+        bool writeFile() {
+            if (m_FilePath.empty()) return true;
+            std::string temp = m_FilePath + ".tmp";
+            {
+                std::ofstream out(temp, std::ios::trunc);
+                if (!out) return false;
+                MetricsRegistry::global().writePrometheus(out);
+                if (!out) return false;
+            }
+            return std::rename(temp.c_str(), m_FilePath.c_str()) == 0;
+        }
+
+    #ifdef LINUX
+        // One request per connection: read the request head, answer, close
+        void serve() {
+            while (!m_Stop.load()) {
+                pollfd listener{ m_Socket, POLLIN, 0 };
+                if (poll(&listener, 1, 200) <= 0) continue;
+
+                int client = accept(m_Socket, nullptr, nullptr);
+                if (client < 0) continue;
+
+                // A client that connects and sends nothing must not hold up the scrapes after it, nor stop()
+                timeval timeout{ 1, 0 };
+                setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+                setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+                // Only the request line matters: read until its end, a full buffer or the timeout
+                std::string head;
+                char request[1024];
+                while (head.find('\n') == std::string::npos && head.size() < sizeof(request) && !m_Stop.load()) {
+                    ssize_t received = recv(client, request, sizeof(request), 0);
+                    if (received <= 0) break;
+                    head.append(request, (size_t)received);
+                }
+
+                std::ostringstream body;
+                std::string status = "200 OK";
+                if (isMetricsRequest(head)) MetricsRegistry::global().writePrometheus(body);
+                else status = "404 Not Found";
+
+                std::string content = body.str();
+                std::string response = "HTTP/1.1 " + status + "\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: "
+                                     + std::to_string(content.size()) + "\r\nConnection: close\r\n\r\n" + content;
+                for (size_t sent = 0; sent < response.size();) {
+                    ssize_t count = send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+                    if (count <= 0) break;
+                    sent += (size_t)count;
+                }
+                close(client);
+            }
+        }
+
+        // GET of /metrics or /, with or without a query string
+        static bool isMetricsRequest(const std::string &head) {
+            if (head.rfind("GET ", 0) != 0) return false;
+            size_t end = head.find_first_of(" ?\r\n", 4);
+            if (end == std::string::npos) return false;
+            std::string path = head.substr(4, end - 4);
+            return path == "/metrics" || path == "/";
+        }
+
+        int m_Socket = -1;
+    #endif
+
+    private:
+        std::string m_FilePath;
+        std::thread m_FileThread, m_HttpThread;
+
+        std::atomic<bool> m_Stop{false};
+        std::mutex m_StopMutex;
+        std::condition_variable m_WakeUp;
+    };
+}
+
+
+#endif //!METRICS_EXPORTER_H
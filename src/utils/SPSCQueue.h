@@ -0,0 +1,105 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <cstddef>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+
+namespace media_proc
+{
+    // Bounded lock-free single-producer/single-consumer ring buffer.
+    // push() blocks while the ring is full (backpressure), pop() blocks while it is empty.
+    // The producer calls close() once it has nothing more to send; the consumer drains
+    // the remaining items and then pop() returns false. abort() releases both ends at once.
+    template<typename T>
+    class SPSCQueue {
+    public:
+        explicit SPSCQueue(size_t capacity) : m_Slots(capacity + 1) { }
+
+        SPSCQueue(const SPSCQueue&) = delete;
+        SPSCQueue& operator=(const SPSCQueue&) = delete;
+
+        bool tryPush(T &value) {
+            size_t tail = m_Tail.load(std::memory_order_relaxed);
+            size_t nextTail = increment(tail);
+            if (nextTail == m_Head.load(std::memory_order_acquire)) return false;
+
+            m_Slots[tail] = std::move(value);
+            m_Tail.store(nextTail, std::memory_order_release);
+            return true;
+        }
+
+        bool tryPop(T &value) {
+            size_t head = m_Head.load(std::memory_order_relaxed);
+            if (head == m_Tail.load(std::memory_order_acquire)) return false;
+
+            value = std::move(m_Slots[head]);
+            m_Head.store(increment(head), std::memory_order_release);
+            return true;
+        }
+
+        // Returns false if the queue was aborted before the value could be stored
+        bool push(T value) {
+            for (unsigned int spins = 0; !tryPush(value); ++spins) {
+                if (m_Aborted.load(std::memory_order_acquire)) return false;
+                backoff(spins);
+            }
+            return true;
+        }
+
+        // Returns false once the queue is closed and drained, or aborted
+        bool pop(T &value) {
+            for (unsigned int spins = 0; !tryPop(value); ++spins) {
+                if (m_Aborted.load(std::memory_order_acquire)) return false;
+                if (m_Closed.load(std::memory_order_acquire)) return tryPop(value);
+                backoff(spins);
+            }
+            return true;
+        }
+
+        void close() { m_Closed.store(true, std::memory_order_release); }
+        void abort() { m_Aborted.store(true, std::memory_order_release); }
+
+        bool isAborted() const { return m_Aborted.load(std::memory_order_acquire); }
+        size_t capacity() const { return m_Slots.size() - 1; }
+
+        // Items queued right now; a snapshot for monitoring while both ends keep moving
+        size_t size() const {
+            size_t head = m_Head.load(std::memory_order_acquire);
+            size_t tail = m_Tail.load(std::memory_order_acquire);
+            return tail >= head ? tail - head : tail + m_Slots.size() - head;
+        }
+
+    private:
+        size_t increment(size_t index) const { return index + 1 == m_Slots.size() ? 0 : index + 1; }
+
+        // Spin briefly, then yield, then sleep, so a stage stalled behind a slow
+        // neighbour does not burn the core the slow neighbour could be using
+        static void backoff(unsigned int spins) {
+            if (spins < 64) {
+            #if defined(__x86_64__) || defined(_M_X64)
+                _mm_pause();
+            #endif
+            }
+            else if (spins < 128) std::this_thread::yield();
+            else std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+
+    private:
+        std::vector<T> m_Slots;
+        alignas(64) std::atomic<size_t> m_Head{0};
+        alignas(64) std::atomic<size_t> m_Tail{0};
+        alignas(64) std::atomic<bool> m_Closed{false};
+        std::atomic<bool> m_Aborted{false};
+    };
+}
+
+
+#endif //!SPSC_QUEUE_H
@@ -0,0 +1,190 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Spans written into per-thread ring buffers and saved as a Chrome trace-event file, which
+// chrome://tracing and ui.perfetto.dev open directly. Recording is off until Tracer::start().
+// Building with DISABLE_TRACING (premake5 --no-tracing) turns every TRACE_* macro into nothing,
+// including the evaluation of its arguments.
+
+#ifndef DISABLE_TRACING
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+namespace media_proc
+{
+    // Names must outlive the tracer: string literals or static strings such as isaName()
+    struct TraceEvent {
+        const char* name = nullptr;
+        const char* argName = nullptr;   // Optional integer argument shown with the span
+        int64_t arg = 0;
+        int64_t startNs = 0;
+        int64_t durationNs = 0;
+    };
+
+    // Events of one thread. Only the owning thread writes; when the ring is full the oldest
+    // events are overwritten, so a long run keeps its most recent history.
+    class TraceBuffer {
+    public:
+        static constexpr size_t Capacity = 1 << 16;
+
+        explicit TraceBuffer(uint32_t threadId) : m_ThreadId(threadId), m_Events(Capacity) { }
+
+        void push(const TraceEvent &event) {
+            uint64_t index = m_Written.load(std::memory_order_relaxed);
+            m_Events[index & (Capacity - 1)] = event;
+            m_Written.store(index + 1, std::memory_order_release);
+        }
+
+        uint32_t threadId() const { return m_ThreadId; }
+        uint64_t written() const { return m_Written.load(std::memory_order_acquire); }
+
+        // Oldest surviving event first
+        template<typename F>
+        void forEach(F fn) const {
+            uint64_t written = this->written();
+            uint64_t first = written > Capacity ? written - Capacity : 0;
+            for (uint64_t i = first; i < written; ++i) fn(m_Events[i & (Capacity - 1)]);
+        }
+
+        std::string threadName;
+
+    private:
+        uint32_t m_ThreadId;
+        std::vector<TraceEvent> m_Events;
+        std::atomic<uint64_t> m_Written{0};
+    };
+
+    class Tracer {
+    public:
+        static Tracer& global() {
+            static Tracer tracer;
+            return tracer;
+        }
+
+        void start() { m_Enabled.store(true, std::memory_order_release); }
+        void stop() { m_Enabled.store(false, std::memory_order_release); }
+        bool enabled() const { return m_Enabled.load(std::memory_order_relaxed); }
+
+        int64_t now() const {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_Epoch).count();
+        }
+
+        // The calling thread's buffer, registered on first use. Buffers are kept after their thread
+        // exits, so spans of short-lived threads (std::async, concurrent pipeline stages) survive.
+        TraceBuffer& threadBuffer() {
+            thread_local TraceBuffer* t_Buffer = nullptr;
+            if (!t_Buffer) {
+                std::lock_guard<std::mutex> lock(m_Mutex);
+                m_Buffers.push_back(std::make_unique<TraceBuffer>((uint32_t)m_Buffers.size() + 1));
+                t_Buffer = m_Buffers.back().get();
+            }
+            return *t_Buffer;
+        }
+
+        void record(const TraceEvent &event) { threadBuffer().push(event); }
+
+        // Label of the calling thread's track in the trace viewer; ignored before start()
+        void setThreadName(const std::string &name) {
+            if (!enabled()) return;
+            TraceBuffer &buffer = threadBuffer();
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            buffer.threadName = name;
+        }
+
+        // Call once the traced work has finished: threads still recording may leave torn events
+        void writeChromeJson(std::ostream &out) {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            std::ios state(nullptr);
+            state.copyfmt(out);
+            out << std::fixed << std::setprecision(3); // Microseconds with nanosecond resolution
+            out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+            out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"img_blur\"}}";
+
+            uint64_t dropped = 0;
+            for (const auto &buffer : m_Buffers) {
+                uint32_t tid = buffer->threadId();
+                if (!buffer->threadName.empty()) {
+                    out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+                        << ",\"args\":{\"name\":\"" << buffer->threadName << "\"}}";
+                }
+                if (buffer->written() > TraceBuffer::Capacity) dropped += buffer->written() - TraceBuffer::Capacity;
+
+                buffer->forEach([&](const TraceEvent &event) {
+                    out << ",\n{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+                        << ",\"ts\":" << event.startNs / 1000.0 << ",\"dur\":" << event.durationNs / 1000.0;
+                    if (event.argName) out << ",\"args\":{\"" << event.argName << "\":" << event.arg << "}";
+                    out << "}";
+                });
+            }
+            out << "\n],\"otherData\":{\"dropped_events\":" << dropped << "}}\n";
+            out.copyfmt(state);
+        }
+
+        bool save(const std::string &path) {
+            std::ofstream out(path);
+            if (!out) return false;
+            writeChromeJson(out);
+            return (bool)out;
+        }
+
+    private:
+        Tracer() : m_Epoch(std::chrono::steady_clock::now()) { }
+
+        std::atomic<bool> m_Enabled{false};
+        std::chrono::steady_clock::time_point m_Epoch;
+        std::mutex m_Mutex;
+        std::vector<std::unique_ptr<TraceBuffer>> m_Buffers;
+    };
+
+    // Records [construction, destruction) as one complete event. Spans of a thread nest by time,
+    // so a span opened inside another shows up below it in the viewer.
+    class TraceSpan {
+    public:
+        explicit TraceSpan(const char* name, const char* argName = nullptr, int64_t arg = 0) {
+            if (!Tracer::global().enabled()) return;
+            m_Event.name = name;
+            m_Event.argName = argName;
+            m_Event.arg = arg;
+            m_Event.startNs = Tracer::global().now();
+        }
+
+        ~TraceSpan() {
+            if (!m_Event.name) return;
+            m_Event.durationNs = Tracer::global().now() - m_Event.startNs;
+            Tracer::global().record(m_Event);
+        }
+
+        TraceSpan(const TraceSpan&) = delete;
+        TraceSpan& operator=(const TraceSpan&) = delete;
+
+    private:
+        TraceEvent m_Event;
+    };
+}
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#define TRACE_SPAN(name) media_proc::TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(name)
+#define TRACE_SPAN_ARG(name, argName, arg) media_proc::TraceSpan TRACE_CONCAT(traceSpan, __LINE__)(name, argName, (int64_t)(arg))
+#define TRACE_THREAD_NAME(name) media_proc::Tracer::global().setThreadName(name)
+
+#else
+
+#define TRACE_SPAN(name) ((void)0)
+#define TRACE_SPAN_ARG(name, argName, arg) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+
+#endif //!DISABLE_TRACING
+
+#endif //!TRACE_H